@@ -5,6 +5,11 @@
  * * create time:2018  1 12
  * */
 
+#ifndef _CONST_VAR_H_
+#define _CONST_VAR_H_
+
+#include "inner/head.h"
+
 namespace pepper
 {
 static const size_t SEC_PER_MIN = 60;
@@ -15,4 +20,9 @@ static const size_t MAX_UINT8 = 0xFF;
 static const size_t MAX_UINT16 = 0xFFFF;
 static const size_t MAX_UINT32 = 0xFFFFFFFF;
 
+/// 并发容器里面用来隔开读写端，避免伪共享
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
 }  // namespace pepper
+
+#endif
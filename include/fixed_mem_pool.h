@@ -15,7 +15,10 @@
 
 namespace pepper
 {
-template <typename T, size_t ALIGN = alignof(size_t)>
+/// USED_BITMAP == false 的时候每个节点额外有一个16字节的双向链表节点，用来串起在用的节点做遍历
+/// USED_BITMAP == true 的时候换成每个节点一位的位图，申请回收只改一位，遍历按地址顺序扫位图
+/// 空闲链表存在空闲节点自己的内存里面，所以节点大小至少是sizeof(size_t)，节点很小很多的时候能省很多内存
+template <typename T, size_t ALIGN = alignof(size_t), bool USED_BITMAP = false>
 class FixedMemPool
 {
     static_assert(IsPowOfTwo<ALIGN>::value, "ALIGN must be pow of 2");
@@ -45,9 +48,7 @@ public:
 public:
     static size_t calc_need_size(size_t max_node_num_, size_t node_size_)
     {
-        // LinkNode需要额外申请多一个节点作为头节点
-        return align_bytes(sizeof(MemHeader) + (max_node_num_ + 1) * sizeof(LinkNode)) +
-               max_node_num_ * align_bytes(node_size_);
+        return value_offset(max_node_num_) + max_node_num_ * real_node_size(node_size_);
     }
 
     static size_t calc_need_size(size_t max_node_num_) { return calc_need_size(max_node_num_, sizeof(T)); }
@@ -107,7 +108,7 @@ private:
         size_t used_num;
         /// 已经使用了的原始节点数
         size_t raw_used_num;
-        /// 双向链表头节点位置
+        /// 双向链表头节点位置，USED_BITMAP的时候是位图的位置
         size_t link_head_offset;
         /// 真正数据的开始位置
         size_t value_offset;
@@ -127,26 +128,49 @@ private:
     const T *get_value(size_t index_) const;
     T *get_value(size_t index_);
 
+    // 位图
+    const uint64_t *get_bitmap() const;
+    uint64_t *get_bitmap();
+    // 空闲节点里面存的下一个空闲节点的下标，节点不一定按size_t对齐，用memcpy读写
+    size_t get_reclaim_next(size_t index_) const;
+    void set_reclaim_next(size_t index_, size_t next_);
+
     static size_t align_bytes(size_t bytes_) { return (bytes_ + ALIGN - 1) & (~(ALIGN - 1)); }
+    static size_t real_node_size(size_t node_size_)
+    {
+        if constexpr (USED_BITMAP)
+            return align_bytes(node_size_ < sizeof(size_t) ? sizeof(size_t) : node_size_);
+        else
+            return align_bytes(node_size_);
+    }
+    static size_t value_offset(size_t max_node_num_)
+    {
+        // LinkNode需要额外申请多一个节点作为头节点
+        if constexpr (USED_BITMAP)
+            return align_bytes(sizeof(MemHeader) + (max_node_num_ + 63) / 64 * sizeof(uint64_t));
+        else
+            return align_bytes(sizeof(MemHeader) + (max_node_num_ + 1) * sizeof(LinkNode));
+    }
 
 private:
     FixedMemPool(const FixedMemPool &) = delete;
     FixedMemPool &operator=(const FixedMemPool &) = delete;
-    static const size_t HEADER_MAGIC_NUM = 0x9E370001;
+    static const size_t HEADER_MAGIC_NUM = USED_BITMAP ? 0x9E370002 : 0x9E370001;
     static const size_t VERSION = 1;
 
 private:
     MemHeader *m_header = nullptr;
 };
 
-template <typename T, size_t ALIGN>
-bool FixedMemPool<T, ALIGN>::init(void *mem_, size_t size_, size_t max_node_num_, bool check_)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+bool FixedMemPool<T, ALIGN, USED_BITMAP>::init(void *mem_, size_t size_, size_t max_node_num_, bool check_)
 {
     return init(mem_, size_, max_node_num_, sizeof(T), check_);
 }
 
-template <typename T, size_t ALIGN>
-bool FixedMemPool<T, ALIGN>::init(void *mem_, size_t size_, size_t max_node_num_, size_t node_size_, bool check_)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+bool FixedMemPool<T, ALIGN, USED_BITMAP>::init(void *mem_, size_t size_, size_t max_node_num_, size_t node_size_,
+                                               bool check_)
 {
     if (nullptr == mem_ || node_size_ < sizeof(T))
         return false;
@@ -155,7 +179,7 @@ bool FixedMemPool<T, ALIGN>::init(void *mem_, size_t size_, size_t max_node_num_
     if (real_need_size < size_)
         return false;
 
-    size_t real_node_size = align_bytes(node_size_);
+    size_t real_node_size = FixedMemPool::real_node_size(node_size_);
 
     m_header = reinterpret_cast<MemHeader *>(mem_);
     if (!check_)
@@ -168,13 +192,34 @@ bool FixedMemPool<T, ALIGN>::init(void *mem_, size_t size_, size_t max_node_num_
     return true;
 }
 
-template <typename T, size_t ALIGN>
-T *FixedMemPool<T, ALIGN>::alloc(bool zero)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+T *FixedMemPool<T, ALIGN, USED_BITMAP>::alloc(bool zero)
 {
     if (full())
         return nullptr;
 
     size_t index = 0;
+    if constexpr (USED_BITMAP)
+    {
+        if (m_header->reclaim_list != 0)
+        {
+            index = m_header->reclaim_list;
+            m_header->reclaim_list = get_reclaim_next(index);
+        }
+        else
+        {
+            assert(m_header->raw_used_num < m_header->max_num);
+            index = ++(m_header->raw_used_num);
+        }
+        get_bitmap()[(index - 1) / 64] |= uint64_t(1) << ((index - 1) % 64);
+        ++(m_header->used_num);
+
+        T *p = get_value(index);
+        if (zero)
+            memset(p, 0, m_header->t_size);
+        return p;
+    }
+
     LinkNode *empty_node = nullptr;
     // 先从回收队列里面找，没有再去找一个新鲜的
     if (m_header->reclaim_list != 0)
@@ -211,8 +256,8 @@ T *FixedMemPool<T, ALIGN>::alloc(bool zero)
     return p;
 }
 
-template <typename T, size_t ALIGN>
-bool FixedMemPool<T, ALIGN>::free(const T *p_)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+bool FixedMemPool<T, ALIGN, USED_BITMAP>::free(const T *p_)
 {
     if (empty())
         return false;
@@ -224,6 +269,20 @@ bool FixedMemPool<T, ALIGN>::free(const T *p_)
     // 进一步检查节点是否在使用，要考虑重复free的场景
     if (index > m_header->raw_used_num)
         return false;
+
+    if constexpr (USED_BITMAP)
+    {
+        uint64_t &word = get_bitmap()[(index - 1) / 64];
+        uint64_t bit = uint64_t(1) << ((index - 1) % 64);
+        if ((word & bit) == 0)
+            return false;
+        word &= ~bit;
+        set_reclaim_next(index, m_header->reclaim_list);
+        m_header->reclaim_list = index;
+        --(m_header->used_num);
+        return true;
+    }
+
     // 可以判断prev是否是大于max_num
     LinkNode *del_node = get_link(index);
     if (del_node->prev > m_header->max_num)
@@ -243,76 +302,81 @@ bool FixedMemPool<T, ALIGN>::free(const T *p_)
     return true;
 }
 
-template <typename T, size_t ALIGN>
-void FixedMemPool<T, ALIGN>::clear()
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+void FixedMemPool<T, ALIGN, USED_BITMAP>::clear()
 {
     init(m_header, m_header->mem_size, m_header->max_num, m_header->t_size, false);
 }
 
-template <typename T, size_t ALIGN>
-bool FixedMemPool<T, ALIGN>::full() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+bool FixedMemPool<T, ALIGN, USED_BITMAP>::full() const
 {
     return m_header->used_num >= m_header->max_num;
 }
 
-template <typename T, size_t ALIGN>
-bool FixedMemPool<T, ALIGN>::empty() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+bool FixedMemPool<T, ALIGN, USED_BITMAP>::empty() const
 {
     return m_header->used_num == 0;
 }
 
-template <typename T, size_t ALIGN>
-const typename FixedMemPool<T, ALIGN>::Iterator FixedMemPool<T, ALIGN>::begin() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator FixedMemPool<T, ALIGN, USED_BITMAP>::begin() const
 {
+    if constexpr (USED_BITMAP)
+    {
+        size_t bit = find_next_bit(get_bitmap(), 0, m_header->raw_used_num);
+        return Iterator(this, bit < m_header->raw_used_num ? bit + 1 : 0);
+    }
     const LinkNode *head_node = get_link(0);
     return Iterator(this, head_node->next);
 }
 
-template <typename T, size_t ALIGN>
-typename FixedMemPool<T, ALIGN>::Iterator FixedMemPool<T, ALIGN>::begin()
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator FixedMemPool<T, ALIGN, USED_BITMAP>::begin()
 {
-    const LinkNode *head_node = get_link(0);
-    return Iterator(this, head_node->next);
+    return Iterator(this, static_cast<const FixedMemPool *>(this)->begin().m_index);
 }
 
-template <typename T, size_t ALIGN>
-const typename FixedMemPool<T, ALIGN>::Iterator FixedMemPool<T, ALIGN>::end() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator FixedMemPool<T, ALIGN, USED_BITMAP>::end() const
 {
     return Iterator(this, 0);
 }
 
-template <typename T, size_t ALIGN>
-typename FixedMemPool<T, ALIGN>::Iterator FixedMemPool<T, ALIGN>::end()
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator FixedMemPool<T, ALIGN, USED_BITMAP>::end()
 {
     return Iterator(this, 0);
 }
 
-template <typename T, size_t ALIGN>
-size_t FixedMemPool<T, ALIGN>::mem_utilization() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+size_t FixedMemPool<T, ALIGN, USED_BITMAP>::mem_utilization() const
 {
-    return m_header->used_num * (m_header->t_size + sizeof(LinkNode)) * 100 / m_header->mem_size;
+    size_t extra_size = USED_BITMAP ? 0 : sizeof(LinkNode);
+    return m_header->used_num * (m_header->t_size + extra_size) * 100 / m_header->mem_size;
 }
 
-template <typename T, size_t ALIGN>
-size_t FixedMemPool<T, ALIGN>::capacity() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+size_t FixedMemPool<T, ALIGN, USED_BITMAP>::capacity() const
 {
     return m_header->max_num;
 }
 
-template <typename T, size_t ALIGN>
-size_t FixedMemPool<T, ALIGN>::size() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+size_t FixedMemPool<T, ALIGN, USED_BITMAP>::size() const
 {
     return m_header->used_num;
 }
 
-template <typename T, size_t ALIGN>
-size_t FixedMemPool<T, ALIGN>::node_size() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+size_t FixedMemPool<T, ALIGN, USED_BITMAP>::node_size() const
 {
     return m_header->t_size;
 }
 
-template <typename T, size_t ALIGN>
-size_t FixedMemPool<T, ALIGN>::ptr_2_int(const T *p_) const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+size_t FixedMemPool<T, ALIGN, USED_BITMAP>::ptr_2_int(const T *p_) const
 {
     const uint8_t *start_mem = reinterpret_cast<const uint8_t *>(m_header);
     if (reinterpret_cast<const uint8_t *>(p_) < start_mem + m_header->value_offset)
@@ -323,32 +387,33 @@ size_t FixedMemPool<T, ALIGN>::ptr_2_int(const T *p_) const
     return (offset / m_header->t_size) + 1;
 }
 
-template <typename T, size_t ALIGN>
-const T *FixedMemPool<T, ALIGN>::int_2_ptr(size_t index_) const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const T *FixedMemPool<T, ALIGN, USED_BITMAP>::int_2_ptr(size_t index_) const
 {
     return get_value(index_);
 }
 
-template <typename T, size_t ALIGN>
-T *FixedMemPool<T, ALIGN>::int_2_ptr(size_t index_)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+T *FixedMemPool<T, ALIGN, USED_BITMAP>::int_2_ptr(size_t index_)
 {
     return get_value(index_);
 }
 
-template <typename T, size_t ALIGN>
-const typename FixedMemPool<T, ALIGN>::Iterator FixedMemPool<T, ALIGN>::int_2_iter(size_t index_) const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator FixedMemPool<T, ALIGN, USED_BITMAP>::int_2_iter(
+    size_t index_) const
 {
     return Iterator(this, index_);
 }
 
-template <typename T, size_t ALIGN>
-typename FixedMemPool<T, ALIGN>::Iterator FixedMemPool<T, ALIGN>::int_2_iter(size_t index_)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator FixedMemPool<T, ALIGN, USED_BITMAP>::int_2_iter(size_t index_)
 {
     return Iterator(this, index_);
 }
 
-template <typename T, size_t ALIGN>
-void FixedMemPool<T, ALIGN>::init_header(size_t size_, size_t max_node_num_, size_t node_size_)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+void FixedMemPool<T, ALIGN, USED_BITMAP>::init_header(size_t size_, size_t max_node_num_, size_t node_size_)
 {
     assert(m_header);
     m_header->version = VERSION;
@@ -358,32 +423,65 @@ void FixedMemPool<T, ALIGN>::init_header(size_t size_, size_t max_node_num_, siz
     m_header->used_num = 0;
     m_header->raw_used_num = 0;
     m_header->link_head_offset = sizeof(MemHeader);
-    m_header->value_offset = align_bytes(sizeof(MemHeader) + (m_header->max_num + 1) * sizeof(LinkNode));
+    m_header->value_offset = value_offset(max_node_num_);
     m_header->reclaim_list = 0;
     m_header->magic_num = HEADER_MAGIC_NUM;
+    if constexpr (USED_BITMAP)
+    {
+        memset(get_bitmap(), 0, m_header->value_offset - m_header->link_head_offset);
+        return;
+    }
     LinkNode *head_node = get_link(0);
     head_node->prev = 0;
     head_node->next = 0;
 }
 
-template <typename T, size_t ALIGN>
-const typename FixedMemPool<T, ALIGN>::LinkNode *FixedMemPool<T, ALIGN>::get_link(size_t index_) const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const typename FixedMemPool<T, ALIGN, USED_BITMAP>::LinkNode *FixedMemPool<T, ALIGN, USED_BITMAP>::get_link(
+    size_t index_) const
 {
     assert(index_ <= m_header->max_num);
     size_t offset = m_header->link_head_offset + index_ * sizeof(LinkNode);
     return reinterpret_cast<const LinkNode *>(reinterpret_cast<const uint8_t *>(m_header) + offset);
 }
 
-template <typename T, size_t ALIGN>
-typename FixedMemPool<T, ALIGN>::LinkNode *FixedMemPool<T, ALIGN>::get_link(size_t index_)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+typename FixedMemPool<T, ALIGN, USED_BITMAP>::LinkNode *FixedMemPool<T, ALIGN, USED_BITMAP>::get_link(size_t index_)
 {
     assert(index_ <= m_header->max_num);
     size_t offset = m_header->link_head_offset + index_ * sizeof(LinkNode);
     return reinterpret_cast<LinkNode *>(reinterpret_cast<uint8_t *>(m_header) + offset);
 }
 
-template <typename T, size_t ALIGN>
-const T *FixedMemPool<T, ALIGN>::get_value(size_t index_) const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const uint64_t *FixedMemPool<T, ALIGN, USED_BITMAP>::get_bitmap() const
+{
+    return reinterpret_cast<const uint64_t *>(
+        reinterpret_cast<const uint8_t *>(m_header) + m_header->link_head_offset);
+}
+
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+uint64_t *FixedMemPool<T, ALIGN, USED_BITMAP>::get_bitmap()
+{
+    return reinterpret_cast<uint64_t *>(reinterpret_cast<uint8_t *>(m_header) + m_header->link_head_offset);
+}
+
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+size_t FixedMemPool<T, ALIGN, USED_BITMAP>::get_reclaim_next(size_t index_) const
+{
+    size_t next = 0;
+    memcpy(&next, get_value(index_), sizeof(next));
+    return next;
+}
+
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+void FixedMemPool<T, ALIGN, USED_BITMAP>::set_reclaim_next(size_t index_, size_t next_)
+{
+    memcpy(static_cast<void *>(get_value(index_)), &next_, sizeof(next_));
+}
+
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const T *FixedMemPool<T, ALIGN, USED_BITMAP>::get_value(size_t index_) const
 {
     assert(index_ > 0);
     assert(index_ <= m_header->max_num);
@@ -391,8 +489,8 @@ const T *FixedMemPool<T, ALIGN>::get_value(size_t index_) const
     return reinterpret_cast<const T *>(reinterpret_cast<const uint8_t *>(m_header) + offset);
 }
 
-template <typename T, size_t ALIGN>
-T *FixedMemPool<T, ALIGN>::get_value(size_t index_)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+T *FixedMemPool<T, ALIGN, USED_BITMAP>::get_value(size_t index_)
 {
     assert(index_ > 0);
     assert(index_ <= m_header->max_num);
@@ -400,70 +498,86 @@ T *FixedMemPool<T, ALIGN>::get_value(size_t index_)
     return reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(m_header) + offset);
 }
 
-template <typename T, size_t ALIGN>
-const T &FixedMemPool<T, ALIGN>::Iterator::operator*() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const T &FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator*() const
 {
     return *(operator->());
 }
 
-template <typename T, size_t ALIGN>
-T &FixedMemPool<T, ALIGN>::Iterator::operator*()
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+T &FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator*()
 {
     return *(operator->());
 }
 
-template <typename T, size_t ALIGN>
-const T *FixedMemPool<T, ALIGN>::Iterator::operator->() const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+const T *FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator->() const
 {
     return m_pool->get_value(m_index);
 }
 
-template <typename T, size_t ALIGN>
-T *FixedMemPool<T, ALIGN>::Iterator::operator->()
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+T *FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator->()
 {
     return const_cast<FixedMemPool *>(m_pool)->get_value(m_index);
 }
 
-template <typename T, size_t ALIGN>
-bool FixedMemPool<T, ALIGN>::Iterator::operator==(const Iterator &right_) const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+bool FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator==(const Iterator &right_) const
 {
     return (m_pool == right_.m_pool) && (m_index == right_.m_index);
 }
 
-template <typename T, size_t ALIGN>
-bool FixedMemPool<T, ALIGN>::Iterator::operator!=(const Iterator &right_) const
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+bool FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator!=(const Iterator &right_) const
 {
     return (m_pool != right_.m_pool) || (m_index != right_.m_index);
 }
 
-template <typename T, size_t ALIGN>
-typename FixedMemPool<T, ALIGN>::Iterator &FixedMemPool<T, ALIGN>::Iterator::operator++()
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator &FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator++()
 {
+    if constexpr (USED_BITMAP)
+    {
+        // 下标是从1开始的，m_index刚好就是下一个节点的位
+        size_t raw_used_num = m_pool->m_header->raw_used_num;
+        size_t bit = find_next_bit(m_pool->get_bitmap(), m_index, raw_used_num);
+        m_index = bit < raw_used_num ? bit + 1 : 0;
+        return (*this);
+    }
     const LinkNode *node = m_pool->get_link(m_index);
     assert(node->prev <= m_pool->m_header->max_num);
     m_index = node->next;
     return (*this);
 }
 
-template <typename T, size_t ALIGN>
-typename FixedMemPool<T, ALIGN>::Iterator FixedMemPool<T, ALIGN>::Iterator::operator++(int)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator++(int)
 {
     Iterator temp = (*this);
     ++(*this);
     return temp;
 }
 
-template <typename T, size_t ALIGN>
-typename FixedMemPool<T, ALIGN>::Iterator &FixedMemPool<T, ALIGN>::Iterator::operator--()
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator &FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator--()
 {
+    if constexpr (USED_BITMAP)
+    {
+        // end()往前是最后一个节点
+        size_t end = m_index == 0 ? m_pool->m_header->raw_used_num : m_index - 1;
+        size_t bit = find_prev_bit(m_pool->get_bitmap(), end);
+        m_index = bit < end ? bit + 1 : 0;
+        return (*this);
+    }
     const LinkNode *node = m_pool->get_link(m_index);
     assert(node->prev <= m_pool->m_header->max_num);
     m_index = node->prev;
     return (*this);
 }
 
-template <typename T, size_t ALIGN>
-typename FixedMemPool<T, ALIGN>::Iterator FixedMemPool<T, ALIGN>::Iterator::operator--(int)
+template <typename T, size_t ALIGN, bool USED_BITMAP>
+typename FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator FixedMemPool<T, ALIGN, USED_BITMAP>::Iterator::operator--(int)
 {
     Iterator temp = (*this);
     --(*this);
@@ -8,6 +8,7 @@
 #ifndef _FIXED_RING_BUF_H_
 #define _FIXED_RING_BUF_H_
 
+#include <sys/uio.h>
 #include "inner/buf_data.h"
 
 namespace pepper
@@ -38,6 +39,18 @@ public:
     T &back(size_t index_ = 0);
     /// 获取队尾第一个元素
     const T &back(size_t index_ = 0) const;
+    /// 批量入队，最多入队num_个，返回真正入队的个数，回绕的时候最多两次memcpy
+    size_t push_bulk(const T *values_, size_t num_);
+    /// 批量出队，最多出队num_个，返回真正出队的个数，回绕的时候最多两次memcpy
+    size_t pop_bulk(T *values_, size_t num_);
+    /// 获取已经入队的数据所在的连续内存段，最多两段，返回段数，iov_len是字节数，可以直接给writev用
+    size_t readable_spans(struct iovec spans_[2]) const;
+    /// 获取空闲的连续内存段，最多两段，返回段数，iov_len是字节数，写完之后调用commit入队
+    size_t writable_spans(struct iovec spans_[2]);
+    /// 队头弹出num_个，一般是readable_spans处理完之后调用，返回真正弹出的个数
+    size_t pop_n(size_t num_);
+    /// 把writable_spans里面从头开始写好的num_个元素入队，超过空闲个数返回false
+    bool commit(size_t num_);
 
 private:
     using Data = inner::FixedRingBufData<T, MAX_SIZE>;
@@ -92,7 +105,7 @@ bool FixedRingBuf<T, MAX_SIZE>::push(const T &value_, bool over_write_)
 
     Data::m_buf[Data::get_end()] = value_;
     assert(Data::get_max_num() > 0);
-    Data::set_end((Data::get_end() + 1) % Data::get_max_num());
+    Data::set_end(Data::wrap(Data::get_end() + 1));
     Data::incr_used_num();
     return true;
 }
@@ -103,7 +116,7 @@ void FixedRingBuf<T, MAX_SIZE>::pop()
     if (empty() == false)
     {
         assert(Data::get_max_num() > 0);
-        Data::set_start((Data::get_start() + 1) % Data::get_max_num());
+        Data::set_start(Data::wrap(Data::get_start() + 1));
         Data::decr_used_num();
     }
 }
@@ -113,7 +126,7 @@ T &FixedRingBuf<T, MAX_SIZE>::front(size_t index_)
 {
     assert(index_ < Data::get_used_num());
     assert(Data::get_max_num() > 0);
-    return Data::m_buf[(Data::get_start() + index_) % Data::get_max_num()];
+    return Data::m_buf[Data::wrap(Data::get_start() + index_)];
 }
 
 template <typename T, size_t MAX_SIZE>
@@ -127,7 +140,7 @@ T &FixedRingBuf<T, MAX_SIZE>::back(size_t index_)
 {
     assert(index_ < Data::get_used_num());
     assert(Data::get_max_num() > 0);
-    return Data::m_buf[(Data::get_end() + Data::get_max_num() - 1 - index_) % Data::get_max_num()];
+    return Data::m_buf[Data::wrap(Data::get_end() + Data::get_max_num() - 1 - index_)];
 }
 
 template <typename T, size_t MAX_SIZE>
@@ -136,6 +149,97 @@ const T &FixedRingBuf<T, MAX_SIZE>::back(size_t index_) const
     return const_cast<FixedRingBuf<T, MAX_SIZE> *>(this)->back(index_);
 }
 
+template <typename T, size_t MAX_SIZE>
+size_t FixedRingBuf<T, MAX_SIZE>::push_bulk(const T *values_, size_t num_)
+{
+    struct iovec spans[2];
+    size_t span_num = writable_spans(spans);
+    size_t num = 0;
+    for (size_t i = 0; i < span_num && num < num_; ++i)
+    {
+        size_t copy_num = std::min(num_ - num, spans[i].iov_len / sizeof(T));
+        std::memcpy(spans[i].iov_base, values_ + num, copy_num * sizeof(T));
+        num += copy_num;
+    }
+    commit(num);
+    return num;
+}
+
+template <typename T, size_t MAX_SIZE>
+size_t FixedRingBuf<T, MAX_SIZE>::pop_bulk(T *values_, size_t num_)
+{
+    struct iovec spans[2];
+    size_t span_num = readable_spans(spans);
+    size_t num = 0;
+    for (size_t i = 0; i < span_num && num < num_; ++i)
+    {
+        size_t copy_num = std::min(num_ - num, spans[i].iov_len / sizeof(T));
+        std::memcpy(values_ + num, spans[i].iov_base, copy_num * sizeof(T));
+        num += copy_num;
+    }
+    return pop_n(num);
+}
+
+template <typename T, size_t MAX_SIZE>
+size_t FixedRingBuf<T, MAX_SIZE>::readable_spans(struct iovec spans_[2]) const
+{
+    if (Data::get_used_num() == 0)
+        return 0;
+
+    size_t first_num = std::min<size_t>(Data::get_used_num(), Data::get_max_num() - Data::get_start());
+    spans_[0].iov_base = const_cast<T *>(Data::m_buf + Data::get_start());
+    spans_[0].iov_len = first_num * sizeof(T);
+    if (first_num == Data::get_used_num())
+        return 1;
+
+    spans_[1].iov_base = const_cast<T *>(Data::m_buf);
+    spans_[1].iov_len = (Data::get_used_num() - first_num) * sizeof(T);
+    return 2;
+}
+
+template <typename T, size_t MAX_SIZE>
+size_t FixedRingBuf<T, MAX_SIZE>::writable_spans(struct iovec spans_[2])
+{
+    size_t free_num = Data::get_max_num() - Data::get_used_num();
+    if (free_num == 0)
+        return 0;
+
+    size_t first_num = std::min<size_t>(free_num, Data::get_max_num() - Data::get_end());
+    spans_[0].iov_base = Data::m_buf + Data::get_end();
+    spans_[0].iov_len = first_num * sizeof(T);
+    if (first_num == free_num)
+        return 1;
+
+    spans_[1].iov_base = Data::m_buf;
+    spans_[1].iov_len = (free_num - first_num) * sizeof(T);
+    return 2;
+}
+
+template <typename T, size_t MAX_SIZE>
+size_t FixedRingBuf<T, MAX_SIZE>::pop_n(size_t num_)
+{
+    size_t num = std::min<size_t>(num_, Data::get_used_num());
+    if (num == 0)
+        return 0;
+
+    Data::set_start(Data::wrap(Data::get_start() + num));
+    Data::set_used_num(Data::get_used_num() - num);
+    return num;
+}
+
+template <typename T, size_t MAX_SIZE>
+bool FixedRingBuf<T, MAX_SIZE>::commit(size_t num_)
+{
+    if (num_ > Data::get_max_num() - Data::get_used_num())
+        return false;
+    if (num_ == 0)
+        return true;
+
+    Data::set_end(Data::wrap(Data::get_end() + num_));
+    Data::set_used_num(Data::get_used_num() + num_);
+    return true;
+}
+
 }  // namespace pepper
 
 #endif
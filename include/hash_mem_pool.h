@@ -10,6 +10,7 @@
 #define _HASH_MEM_POOL_H_
 
 #include <sys/types.h>
+#include <algorithm>
 #include <cassert>
 #include "fixed_mem_pool.h"
 
@@ -68,6 +69,9 @@ public:
     /// 查找节点
     const Iterator find(const KEY& key_) const;
     Iterator find(const KEY& key_);
+    /// 批量查找，refs_[i]是keys_[i]的引用值，找不到是0，可以用deref拿到节点，返回找到的个数
+    /// 每组先算完哈希预取桶头，再预取链上第一个节点，最后才比较key，多个key的缓存缺失可以重叠起来
+    size_t find_batch(const KEY* keys_, size_t num_, size_t* refs_) const;
     /// 获取节点，如果没有可以选择插入
     Iterator get_or_insert(const KEY& key_);
     /// 删除节点
@@ -87,6 +91,11 @@ public:
 private:
     size_t bucket_index(const KEY& key_) const;
     size_t find_ref(const KEY& key_) const;
+    /// 从ref_开始沿着链找
+    size_t find_in_chain(size_t ref_, const KEY& key_) const;
+
+    /// 一组批量查找的个数
+    static constexpr size_t FIND_BATCH_GROUP = 16;
 
 private:
     struct HashHeader
@@ -260,8 +269,13 @@ size_t HashMemPool<KEY, VALUE, HASH>::bucket_index(const KEY& key_) const
 template <typename KEY, typename VALUE, typename HASH>
 size_t HashMemPool<KEY, VALUE, HASH>::find_ref(const KEY& key_) const
 {
-    size_t index = bucket_index(key_);
-    for (size_t ref = m_buckets[index]; ref != 0;)
+    return find_in_chain(m_buckets[bucket_index(key_)], key_);
+}
+
+template <typename KEY, typename VALUE, typename HASH>
+size_t HashMemPool<KEY, VALUE, HASH>::find_in_chain(size_t ref_, const KEY& key_) const
+{
+    for (size_t ref = ref_; ref != 0;)
     {
         auto node = static_cast<const HashNode*>(m_pool.int_2_ptr(ref));
         if (node->first == key_)
@@ -271,6 +285,39 @@ size_t HashMemPool<KEY, VALUE, HASH>::find_ref(const KEY& key_) const
     return 0;
 }
 
+template <typename KEY, typename VALUE, typename HASH>
+size_t HashMemPool<KEY, VALUE, HASH>::find_batch(const KEY* keys_, size_t num_, size_t* refs_) const
+{
+    size_t found = 0;
+    size_t heads[FIND_BATCH_GROUP];
+    for (size_t start = 0; start < num_; start += FIND_BATCH_GROUP)
+    {
+        size_t group_num = std::min(FIND_BATCH_GROUP, num_ - start);
+        const KEY* keys = keys_ + start;
+        // 第一轮只算哈希，预取桶头
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            heads[i] = bucket_index(keys[i]);
+            prefetch_read(m_buckets + heads[i]);
+        }
+        // 第二轮读桶头，预取第一个节点
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            heads[i] = m_buckets[heads[i]];
+            if (heads[i] != 0)
+                prefetch_read(m_pool.int_2_ptr(heads[i]));
+        }
+        // 第三轮走链
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            refs_[start + i] = find_in_chain(heads[i], keys[i]);
+            if (refs_[start + i] != 0)
+                ++found;
+        }
+    }
+    return found;
+}
+
 template <typename KEY, typename VALUE, typename HASH>
 bool HashMemPool<KEY, VALUE, HASH>::erase(const KEY& key_)
 {
@@ -8,6 +8,7 @@
 #ifndef _BASE_MEM_LRU_MAP_H_
 #define _BASE_MEM_LRU_MAP_H_
 
+#include <cassert>
 #include <functional>
 #include <iterator>
 
@@ -53,6 +54,11 @@ public:
         Iterator operator--(int);
     };
 
+    /// 透明查找的key类型，HASH和IS_EQUAL都有is_transparent才可以用
+    template <typename K>
+    using TransparentKey = std::enable_if_t<BaseType::IS_TRANSPARENT && !std::is_same_v<K, KeyType> &&
+                                            !std::is_same_v<K, ValueType> && !std::is_same_v<K, Iterator>>;
+
 public:
     /// 清空列表
     void clear();
@@ -80,6 +86,31 @@ public:
     Iterator active(const KeyType& key_);
     /// 淘汰掉几个
     size_t disuse(size_t num_, const DisuseCallback& call_back_ = nullptr);
+    /// 开了撤销日志的时候，把上次没做完的insert、erase、active撤销掉，返回true表示撤销了
+    /// 动态大小的在init(..., check_ = true)里面已经调过了，固定大小的挂上来之后自己调，不调的话下一次修改之前也会撤销
+    bool recover();
+
+    /// 用别的类型的key查找和删除
+    template <typename K, typename = TransparentKey<K>>
+    const Iterator find(const K& key_) const;
+    template <typename K, typename = TransparentKey<K>>
+    Iterator find(const K& key_);
+    template <typename K, typename = TransparentKey<K>>
+    bool exist(const K& key_) const;
+    template <typename K, typename = TransparentKey<K>>
+    void erase(const K& key_);
+
+    /// 算key的哈希值，留着给下面的*_hashed接口用，hash_必须是key_hash(key_)的结果
+    template <typename K>
+    size_t key_hash(const K& key_) const;
+    std::pair<Iterator, bool> insert_hashed(const ValueType& value_, size_t hash_, bool force_ = false,
+                                            const DisuseCallback& call_back_ = nullptr);
+    template <typename K>
+    const Iterator find_hashed(const K& key_, size_t hash_) const;
+    template <typename K>
+    Iterator find_hashed(const K& key_, size_t hash_);
+    template <typename K>
+    void erase_hashed(const K& key_, size_t hash_);
 
     /// 迭代器
     const Iterator begin() const;
@@ -93,6 +124,8 @@ public:
 private:
     const ValueType& deref(IntType index_) const;
     ValueType& deref(IntType index_);
+    /// 从active链上摘下来
+    void unlink(IntType index_);
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -131,9 +164,18 @@ template <typename POLICY>
 std::pair<typename BaseMemLRUMap<POLICY>::Iterator, bool> BaseMemLRUMap<POLICY>::insert(
     const ValueType& value_, bool force_, const DisuseCallback& call_back_)
 {
+    return insert_hashed(value_, BaseType::key_hash(BaseType::key_of_value(value_)), force_, call_back_);
+}
+
+template <typename POLICY>
+std::pair<typename BaseMemLRUMap<POLICY>::Iterator, bool> BaseMemLRUMap<POLICY>::insert_hashed(
+    const ValueType& value_, size_t hash_, bool force_, const DisuseCallback& call_back_)
+{
+    // 开了日志的时候先撤销上次没做完的修改再判断满没满，淘汰是单独的一次修改，和插入放在一起日志记不下
+    recover();
     if (BaseType::full())
     {
-        auto iter = find(BaseType::key_of_value(value_));
+        auto iter = find_hashed(BaseType::key_of_value(value_), hash_);
         if (iter != end())
             return std::make_pair(iter, false);
 
@@ -141,17 +183,18 @@ std::pair<typename BaseMemLRUMap<POLICY>::Iterator, bool> BaseMemLRUMap<POLICY>:
             return std::make_pair(end(), false);
     }
 
-    // 需要看看有没有存在
-    auto result_pair = BaseType::insert(value_);
+    // 需要看看有没有存在，哈希表和active链一起算一次修改，上面淘汰的那个已经单独提交了
+    auto guard = BaseType::journal_guard();
+    auto result_pair = BaseType::insert_hashed(value_, hash_);
     if (result_pair.second)
     {
         IntType index = result_pair.first;
         // 新插入的挂到active链头
-        LinkNode& head = BaseType::active_link(0);
-        BaseType::active_link(head.next).prev = index;
-        BaseType::active_link(index).prev = 0;
-        BaseType::active_link(index).next = head.next;
-        head.next = index;
+        IntType first = BaseType::active_link(0).next;
+        BaseType::set_active_prev(first, index);
+        BaseType::set_active_prev(index, 0);
+        BaseType::set_active_next(index, first);
+        BaseType::set_active_next(0, index);
     }
 
     return std::make_pair(Iterator(this, result_pair.first), result_pair.second);
@@ -179,43 +222,108 @@ template <typename POLICY>
 void BaseMemLRUMap<POLICY>::erase(const Iterator& it_)
 {
     assert(it_.m_set == this);
-    erase(*it_);
+    erase(BaseType::key_of_value(*it_));
 }
 
 template <typename POLICY>
 void BaseMemLRUMap<POLICY>::erase(const KeyType& key_)
 {
-    IntType index = BaseType::erase(key_);
-    if (index > 0)
+    auto guard = BaseType::journal_guard();
+    unlink(BaseType::erase(key_));
+}
+
+template <typename POLICY>
+template <typename K, typename>
+const typename BaseMemLRUMap<POLICY>::Iterator BaseMemLRUMap<POLICY>::find(const K& key_) const
+{
+    return Iterator(this, BaseType::find_index(key_));
+}
+
+template <typename POLICY>
+template <typename K, typename>
+typename BaseMemLRUMap<POLICY>::Iterator BaseMemLRUMap<POLICY>::find(const K& key_)
+{
+    return Iterator(this, BaseType::find_index(key_));
+}
+
+template <typename POLICY>
+template <typename K, typename>
+bool BaseMemLRUMap<POLICY>::exist(const K& key_) const
+{
+    return BaseType::find_index(key_) != 0;
+}
+
+template <typename POLICY>
+template <typename K, typename>
+void BaseMemLRUMap<POLICY>::erase(const K& key_)
+{
+    auto guard = BaseType::journal_guard();
+    unlink(BaseType::erase(key_));
+}
+
+template <typename POLICY>
+template <typename K>
+size_t BaseMemLRUMap<POLICY>::key_hash(const K& key_) const
+{
+    return BaseType::key_hash(key_);
+}
+
+template <typename POLICY>
+template <typename K>
+const typename BaseMemLRUMap<POLICY>::Iterator BaseMemLRUMap<POLICY>::find_hashed(const K& key_, size_t hash_) const
+{
+    return Iterator(this, BaseType::find_index_hashed(key_, hash_));
+}
+
+template <typename POLICY>
+template <typename K>
+typename BaseMemLRUMap<POLICY>::Iterator BaseMemLRUMap<POLICY>::find_hashed(const K& key_, size_t hash_)
+{
+    return Iterator(this, BaseType::find_index_hashed(key_, hash_));
+}
+
+template <typename POLICY>
+template <typename K>
+void BaseMemLRUMap<POLICY>::erase_hashed(const K& key_, size_t hash_)
+{
+    auto guard = BaseType::journal_guard();
+    unlink(BaseType::erase_hashed(key_, hash_));
+}
+
+template <typename POLICY>
+void BaseMemLRUMap<POLICY>::unlink(IntType index_)
+{
+    if (index_ > 0)
     {
-        IntType next_index = BaseType::active_link(index).next;
-        IntType prev_index = BaseType::active_link(index).prev;
-        BaseType::active_link(prev_index).next = next_index;
-        BaseType::active_link(next_index).prev = prev_index;
+        IntType next_index = BaseType::active_link(index_).next;
+        IntType prev_index = BaseType::active_link(index_).prev;
+        BaseType::set_active_next(prev_index, next_index);
+        BaseType::set_active_prev(next_index, prev_index);
 
-        BaseType::active_link(index).next = 0;
-        BaseType::active_link(index).prev = 0;
+        BaseType::set_active_next(index_, 0);
+        BaseType::set_active_prev(index_, 0);
     }
 }
 
 template <typename POLICY>
 typename BaseMemLRUMap<POLICY>::Iterator BaseMemLRUMap<POLICY>::active(const KeyType& key_)
 {
+    auto guard = BaseType::journal_guard();
     IntType index = BaseType::find_index(key_);
     if (index != 0)
     {
         // 先摘除
         IntType next_index = BaseType::active_link(index).next;
         IntType prev_index = BaseType::active_link(index).prev;
-        BaseType::active_link(prev_index).next = next_index;
-        BaseType::active_link(next_index).prev = prev_index;
+        BaseType::set_active_next(prev_index, next_index);
+        BaseType::set_active_prev(next_index, prev_index);
 
         // 插入到active链的头部
-        LinkNode& head = BaseType::active_link(0);
-        BaseType::active_link(head.next).prev = index;
-        BaseType::active_link(index).prev = 0;
-        BaseType::active_link(index).next = head.next;
-        head.next = index;
+        IntType first = BaseType::active_link(0).next;
+        BaseType::set_active_prev(first, index);
+        BaseType::set_active_prev(index, 0);
+        BaseType::set_active_next(index, first);
+        BaseType::set_active_next(0, index);
     }
 
     return Iterator(this, index);
@@ -235,6 +343,12 @@ size_t BaseMemLRUMap<POLICY>::disuse(size_t num_, const DisuseCallback& call_bac
     return num_;
 }
 
+template <typename POLICY>
+bool BaseMemLRUMap<POLICY>::recover()
+{
+    return BaseType::recover();
+}
+
 template <typename POLICY>
 const typename BaseMemLRUMap<POLICY>::Iterator BaseMemLRUMap<POLICY>::begin() const
 {
@@ -9,14 +9,49 @@
 #define _BUF_DATA_H_
 
 #include <algorithm>
+#include <atomic>
+#include <new>
 #include <type_traits>
+#include "const_var.h"
 #include "inner/head.h"
+#include "utils/mirror_mem.h"
 #include "utils/traits_utils.h"
 
 namespace pepper
 {
 namespace inner
 {
+/// 环形下标取模，容量是2的幂的时候用位与代替除法
+template <size_t MAX_SIZE, bool = IsPowOfTwo<MAX_SIZE>::value>
+struct RingIndex
+{
+    static constexpr size_t wrap(size_t pos_) { return pos_ % MAX_SIZE; }
+};
+
+template <size_t MAX_SIZE>
+struct RingIndex<MAX_SIZE, true>
+{
+    static constexpr size_t wrap(size_t pos_) { return pos_ & (MAX_SIZE - 1); }
+};
+
+/// init指定大小的版本，mask_不是0的时候表示容量是2的幂
+inline size_t ring_wrap(size_t pos_, size_t max_, size_t mask_)
+{
+    return mask_ != 0 ? (pos_ & mask_) : (pos_ % max_);
+}
+
+/// 容量是2的幂的时候返回容量-1，否则返回0，每个进程init的时候从共享内存里面的容量算出来，头部不用多存一个字段
+inline size_t ring_mask(size_t max_)
+{
+    return max_ > 1 && (max_ & (max_ - 1)) == 0 ? max_ - 1 : 0;
+}
+
+/// 挂上去的时候容量要么是整块内存放得下的个数，要么是init的时候要求2的幂向下取整过的
+inline bool ring_max_match(size_t head_max_, size_t mem_max_)
+{
+    return head_max_ == mem_max_ || (head_max_ != 0 && head_max_ == floor_pow_of_two(mem_max_));
+}
+
 template <typename T, size_t MAX_SIZE = 0, typename = void>
 struct FixedRingBufData;
 
@@ -30,6 +65,7 @@ protected:
     IntType constexpr get_end() const { return m_end; }
     IntType constexpr get_used_num() const { return m_used_num; }
     IntType constexpr get_max_num() const { return MAX_SIZE; }
+    IntType constexpr wrap(size_t pos_) const { return RingIndex<MAX_SIZE>::wrap(pos_); }
 
     inline void set_start(IntType start_) { m_start = start_; }
     inline void set_end(IntType end_) { m_end = end_; }
@@ -53,6 +89,7 @@ protected:
     IntType constexpr get_end() const { return m_head->m_end; }
     IntType constexpr get_used_num() const { return m_head->m_used_num; }
     IntType constexpr get_max_num() const { return m_head->m_max_num; }
+    IntType wrap(size_t pos_) const { return ring_wrap(pos_, m_head->m_max_num, m_mask); }
 
     inline void set_start(IntType start_) { m_head->m_start = start_; }
     inline void set_end(IntType end_) { m_head->m_end = end_; }
@@ -69,19 +106,23 @@ protected:
     };
     BuffHead *m_head = nullptr;
     T *m_buf = nullptr;
+    /// 进程自己的，容量是2的幂的时候是max_num - 1，否则是0
+    IntType m_mask = 0;
 
 public:
     static size_t need_mem_size(size_t size_) { return sizeof(BuffHead) + sizeof(T) * size_; }
 
-    bool init(void *mem_, size_t mem_size_, bool check_ = false)
+    /// pow_of_two_ == true 的时候容量向下取整到2的幂，下标计算用位与代替取模
+    bool init(void *mem_, size_t mem_size_, bool check_ = false, bool pow_of_two_ = false)
     {
         if (!mem_ || mem_size_ < sizeof(BuffHead))
             return false;
 
         m_head = reinterpret_cast<BuffHead *>(mem_);
+        size_t max_num = (mem_size_ - sizeof(BuffHead)) / sizeof(T);
         if (check_)
         {
-            if (m_head->m_max_num != (mem_size_ - sizeof(BuffHead)) / sizeof(T))
+            if (!ring_max_match(m_head->m_max_num, max_num))
                 return false;
         }
         else
@@ -89,8 +130,9 @@ public:
             m_head->m_start = 0;
             m_head->m_end = 0;
             m_head->m_used_num = 0;
-            m_head->m_max_num = (mem_size_ - sizeof(BuffHead)) / sizeof(T);
+            m_head->m_max_num = pow_of_two_ ? floor_pow_of_two(max_num) : max_num;
         }
+        m_mask = ring_mask(m_head->m_max_num);
         m_buf = reinterpret_cast<T *>(reinterpret_cast<uint8_t *>(mem_) + sizeof(BuffHead));
         return true;
     }
@@ -114,6 +156,7 @@ protected:
     IntType constexpr get_item_num() const { return m_item_num; }
     IntType constexpr get_used_size() const { return m_used_size; }
     IntType constexpr get_max_size() const { return MAX_SIZE; }
+    IntType constexpr wrap(size_t pos_) const { return RingIndex<MAX_SIZE>::wrap(pos_); }
 
     inline void set_start(IntType start_) { m_start = start_; }
     inline void set_end(IntType end_) { m_end = end_; }
@@ -142,12 +185,15 @@ protected:
     };
     BuffHead *m_head = nullptr;
     uint8_t *m_buf = nullptr;
+    /// 进程自己的，容量是2的幂的时候是max_size - 1，否则是0
+    IntType m_mask = 0;
 
     IntType constexpr get_start() const { return m_head->m_start; }
     IntType constexpr get_end() const { return m_head->m_end; }
     IntType constexpr get_item_num() const { return m_head->m_item_num; }
     IntType constexpr get_used_size() const { return m_head->m_used_size; }
     IntType constexpr get_max_size() const { return m_head->m_max_size; }
+    IntType wrap(size_t pos_) const { return ring_wrap(pos_, m_head->m_max_size, m_mask); }
 
     inline void set_start(IntType start_) { m_head->m_start = start_; }
     inline void set_end(IntType end_) { m_head->m_end = end_; }
@@ -161,16 +207,17 @@ protected:
     inline void decr_used_size(IntType decr_size_) { m_head->m_used_size -= decr_size_; }
 
 public:
-    /// 调用者提供队列的内存
-    bool init(void *mem_, size_t mem_size_, bool check_ = false)
+    /// 调用者提供队列的内存，pow_of_two_ == true 的时候容量向下取整到2的幂，下标计算用位与代替取模
+    bool init(void *mem_, size_t mem_size_, bool check_ = false, bool pow_of_two_ = false)
     {
         if (!mem_ || mem_size_ < sizeof(BuffHead))
             return false;
 
         m_head = reinterpret_cast<BuffHead *>(mem_);
+        size_t max_size = mem_size_ - sizeof(BuffHead);
         if (check_)
         {
-            if (m_head->m_max_size != (mem_size_ - sizeof(BuffHead)) || m_head->m_used_size > m_head->m_max_size)
+            if (!ring_max_match(m_head->m_max_size, max_size) || m_head->m_used_size > m_head->m_max_size)
                 return false;
         }
         else
@@ -179,14 +226,307 @@ public:
             m_head->m_end = 0;
             m_head->m_used_size = 0;
             m_head->m_item_num = 0;
-            m_head->m_max_size = mem_size_ - sizeof(BuffHead);
+            m_head->m_max_size = pow_of_two_ ? floor_pow_of_two(max_size) : max_size;
         }
+        m_mask = ring_mask(m_head->m_max_size);
 
         m_buf = reinterpret_cast<uint8_t *>(mem_) + sizeof(BuffHead);
         return true;
     }
 };
 
+/// 单生产者单消费者的不定长队列数据，读写位置都是不回绕的累计字节数，取模得到下标
+/// 写端和读端的数据分别放在不同的cache line上，避免伪共享
+struct SPSCRingBufHead
+{
+    /// 只有生产者写的cache line
+    struct alignas(CACHE_LINE_SIZE) ProducerHead
+    {
+        /// 已经写入的累计字节数
+        std::atomic<size_t> m_tail{0};
+        /// 已经写入的数据包个数
+        std::atomic<size_t> m_push_num{0};
+        /// 生产者看到的读位置缓存，只有空间不够的时候才去读消费者的cache line
+        size_t m_cached_head = 0;
+    };
+
+    /// 只有消费者写的cache line
+    struct alignas(CACHE_LINE_SIZE) ConsumerHead
+    {
+        /// 已经读出的累计字节数
+        std::atomic<size_t> m_head{0};
+        /// 已经读出的数据包个数
+        std::atomic<size_t> m_pop_num{0};
+        /// 消费者看到的写位置缓存，只有看起来是空的时候才去读生产者的cache line
+        mutable size_t m_cached_tail = 0;
+    };
+
+    static_assert(std::atomic<size_t>::is_always_lock_free, "atomic size_t must be lock free for shared memory");
+};
+
+template <size_t MAX_SIZE>
+struct SPSCUnfixedRingBufData
+{
+protected:
+    using IntType = typename FixIntType<MAX_SIZE>::IntType;
+    using ProducerHead = SPSCRingBufHead::ProducerHead;
+    using ConsumerHead = SPSCRingBufHead::ConsumerHead;
+
+    ProducerHead m_producer;
+    ConsumerHead m_consumer;
+    alignas(CACHE_LINE_SIZE) uint8_t m_buf[MAX_SIZE] = {0};
+
+    ProducerHead &producer() { return m_producer; }
+    const ProducerHead &producer() const { return m_producer; }
+    ConsumerHead &consumer() { return m_consumer; }
+    const ConsumerHead &consumer() const { return m_consumer; }
+    IntType constexpr get_max_size() const { return MAX_SIZE; }
+    IntType constexpr wrap(size_t pos_) const { return RingIndex<MAX_SIZE>::wrap(pos_); }
+};
+
+template <>
+struct SPSCUnfixedRingBufData<0>
+{
+protected:
+    using IntType = size_t;
+    using ProducerHead = SPSCRingBufHead::ProducerHead;
+    using ConsumerHead = SPSCRingBufHead::ConsumerHead;
+
+    struct BuffHead
+    {
+        ProducerHead m_producer;
+        ConsumerHead m_consumer;
+        /// 初始化之后只读，单独放一个cache line
+        alignas(CACHE_LINE_SIZE) IntType m_max_size = 0;
+    };
+    BuffHead *m_head = nullptr;
+    uint8_t *m_buf = nullptr;
+    /// 进程自己的，容量是2的幂的时候是max_size - 1，否则是0
+    IntType m_mask = 0;
+
+    ProducerHead &producer() { return m_head->m_producer; }
+    const ProducerHead &producer() const { return m_head->m_producer; }
+    ConsumerHead &consumer() { return m_head->m_consumer; }
+    const ConsumerHead &consumer() const { return m_head->m_consumer; }
+    IntType get_max_size() const { return m_head->m_max_size; }
+    IntType wrap(size_t pos_) const { return ring_wrap(pos_, m_head->m_max_size, m_mask); }
+
+public:
+    /// size_是容量，一个数据包加上头部最多是容量的一半，见SPSCUnfixedRingBuf::reserve
+    static size_t need_mem_size(size_t size_) { return sizeof(BuffHead) + size_; }
+
+    /// 调用者提供队列的内存，跨进程使用的时候，一个进程check_ == false初始化，另外一个进程check_ == true挂上去
+    /// pow_of_two_ == true 的时候容量向下取整到2的幂，下标计算用位与代替取模
+    bool init(void *mem_, size_t mem_size_, bool check_ = false, bool pow_of_two_ = false)
+    {
+        if (!mem_ || mem_size_ <= sizeof(BuffHead))
+            return false;
+
+        BuffHead *head = reinterpret_cast<BuffHead *>(mem_);
+        size_t max_size = mem_size_ - sizeof(BuffHead);
+        if (check_)
+        {
+            size_t head_pos = head->m_consumer.m_head.load(std::memory_order_acquire);
+            size_t tail_pos = head->m_producer.m_tail.load(std::memory_order_acquire);
+            if (!ring_max_match(head->m_max_size, max_size) || tail_pos - head_pos > head->m_max_size)
+                return false;
+        }
+        else
+        {
+            new (head) BuffHead();
+            head->m_max_size = pow_of_two_ ? floor_pow_of_two(max_size) : max_size;
+        }
+
+        m_head = head;
+        m_mask = ring_mask(head->m_max_size);
+        m_buf = reinterpret_cast<uint8_t *>(mem_) + sizeof(BuffHead);
+        return true;
+    }
+};
+
+/// 多生产者多消费者的定长队列数据，每个槽位带一个序号，序号表示这个槽位当前能被第几次入队或者出队使用
+/// 入队位置和出队位置都是不回绕的累计个数，分别放在不同的cache line上
+template <typename T>
+struct MPMCRingBufSlot
+{
+    std::atomic<size_t> m_seq{0};
+    T m_value;
+};
+
+struct alignas(CACHE_LINE_SIZE) MPMCRingBufPos
+{
+    std::atomic<size_t> m_pos{0};
+};
+
+template <typename T, size_t MAX_SIZE = 0, typename = void>
+struct MPMCFixedRingBufData;
+
+template <typename T, size_t MAX_SIZE>
+struct MPMCFixedRingBufData<T, MAX_SIZE, std::enable_if_t<std::is_trivially_copyable_v<T>>>
+{
+protected:
+    using IntType = size_t;
+    using Slot = MPMCRingBufSlot<T>;
+
+    MPMCFixedRingBufData()
+    {
+        for (size_t i = 0; i < MAX_SIZE; ++i)
+            m_slots[i].m_seq.store(i, std::memory_order_relaxed);
+    }
+
+    std::atomic<size_t> &enqueue_pos() { return m_enqueue.m_pos; }
+    const std::atomic<size_t> &enqueue_pos() const { return m_enqueue.m_pos; }
+    std::atomic<size_t> &dequeue_pos() { return m_dequeue.m_pos; }
+    const std::atomic<size_t> &dequeue_pos() const { return m_dequeue.m_pos; }
+    Slot &slot(size_t index_) { return m_slots[index_]; }
+    IntType constexpr get_max_num() const { return MAX_SIZE; }
+    IntType constexpr wrap(size_t pos_) const { return RingIndex<MAX_SIZE>::wrap(pos_); }
+
+    MPMCRingBufPos m_enqueue;
+    MPMCRingBufPos m_dequeue;
+    alignas(CACHE_LINE_SIZE) Slot m_slots[MAX_SIZE];
+};
+
+template <typename T>
+struct MPMCFixedRingBufData<T, 0, std::enable_if_t<std::is_trivially_copyable_v<T>>>
+{
+protected:
+    using IntType = size_t;
+    using Slot = MPMCRingBufSlot<T>;
+
+    struct BuffHead
+    {
+        MPMCRingBufPos m_enqueue;
+        MPMCRingBufPos m_dequeue;
+        /// 初始化之后只读，单独放一个cache line
+        alignas(CACHE_LINE_SIZE) IntType m_max_num = 0;
+    };
+    BuffHead *m_head = nullptr;
+    Slot *m_slots = nullptr;
+    /// 进程自己的，容量是2的幂的时候是max_num - 1，否则是0
+    IntType m_mask = 0;
+
+    std::atomic<size_t> &enqueue_pos() { return m_head->m_enqueue.m_pos; }
+    const std::atomic<size_t> &enqueue_pos() const { return m_head->m_enqueue.m_pos; }
+    std::atomic<size_t> &dequeue_pos() { return m_head->m_dequeue.m_pos; }
+    const std::atomic<size_t> &dequeue_pos() const { return m_head->m_dequeue.m_pos; }
+    Slot &slot(size_t index_) { return m_slots[index_]; }
+    IntType get_max_num() const { return m_head->m_max_num; }
+    IntType wrap(size_t pos_) const { return ring_wrap(pos_, m_head->m_max_num, m_mask); }
+
+public:
+    static size_t need_mem_size(size_t size_) { return sizeof(BuffHead) + sizeof(Slot) * size_; }
+
+    /// 调用者提供队列的内存，多个进程共用的时候，一个进程check_ == false初始化，其他进程check_ == true挂上去
+    /// pow_of_two_ == true 的时候容量向下取整到2的幂，下标计算用位与代替取模
+    bool init(void *mem_, size_t mem_size_, bool check_ = false, bool pow_of_two_ = false)
+    {
+        if (!mem_ || mem_size_ < sizeof(BuffHead) + sizeof(Slot))
+            return false;
+
+        BuffHead *head = reinterpret_cast<BuffHead *>(mem_);
+        Slot *slots = reinterpret_cast<Slot *>(reinterpret_cast<uint8_t *>(mem_) + sizeof(BuffHead));
+        size_t max_num = (mem_size_ - sizeof(BuffHead)) / sizeof(Slot);
+        if (check_)
+        {
+            if (!ring_max_match(head->m_max_num, max_num))
+                return false;
+        }
+        else
+        {
+            new (head) BuffHead();
+            max_num = pow_of_two_ ? floor_pow_of_two(max_num) : max_num;
+            head->m_max_num = max_num;
+            for (size_t i = 0; i < max_num; ++i)
+                new (&(slots[i].m_seq)) std::atomic<size_t>(i);
+        }
+
+        m_head = head;
+        m_slots = slots;
+        m_mask = ring_mask(head->m_max_num);
+        return true;
+    }
+};
+
+/// 队列的等待通知头，和队列放在同一块共享内存上
+/// m_seq是futex等待的字，m_waiters记录有多少个消费者在睡眠，没有人睡眠的时候生产者不需要系统调用
+struct alignas(CACHE_LINE_SIZE) RingBufEvent
+{
+    std::atomic<uint32_t> m_seq{0};
+    std::atomic<uint32_t> m_waiters{0};
+};
+
+/// 数据区映射了两次，元素跨过尾部在虚拟地址上也是连续的，所以不需要填充节点
+struct MirrorRingBufData
+{
+protected:
+    using IntType = size_t;
+
+    struct BuffHead
+    {
+        IntType m_start = 0;
+        IntType m_end = 0;
+        IntType m_used_size = 0;
+        IntType m_item_num = 0;
+        IntType m_max_size = 0;
+    };
+    MirrorMem m_mem;
+    BuffHead *m_head = nullptr;
+    uint8_t *m_buf = nullptr;
+
+    IntType get_start() const { return m_head->m_start; }
+    IntType get_end() const { return m_head->m_end; }
+    IntType get_item_num() const { return m_head->m_item_num; }
+    IntType get_used_size() const { return m_head->m_used_size; }
+    IntType get_max_size() const { return m_head->m_max_size; }
+    /// pos_一定小于两倍的max_size，减一次就够了
+    IntType wrap(size_t pos_) const { return pos_ >= m_head->m_max_size ? pos_ - m_head->m_max_size : pos_; }
+
+    inline void set_start(IntType start_) { m_head->m_start = start_; }
+    inline void set_end(IntType end_) { m_head->m_end = end_; }
+    inline void set_item_num(IntType item_num_) { m_head->m_item_num = item_num_; }
+    inline void set_used_size(IntType used_size_) { m_head->m_used_size = used_size_; }
+
+    inline void incr_item_num() { ++m_head->m_item_num; }
+    inline void decr_item_num() { --m_head->m_item_num; }
+    inline void incr_used_size(IntType used_size_) { m_head->m_used_size += used_size_; }
+    inline void decr_used_size(IntType used_size_) { m_head->m_used_size -= used_size_; }
+
+public:
+    /// 创建队列，size_会向上取整到页大小
+    bool init(size_t size_, const char *name_ = "pepper_mirror_ring")
+    {
+        if (!m_mem.create(sizeof(BuffHead), size_, name_))
+            return false;
+
+        m_head = new (m_mem.head()) BuffHead();
+        m_head->m_max_size = m_mem.size();
+        m_buf = m_mem.data();
+        return true;
+    }
+
+    /// 通过别的进程传过来的fd挂到同一个队列上
+    bool attach(int fd_)
+    {
+        if (!m_mem.attach(fd_, sizeof(BuffHead)))
+            return false;
+
+        m_head = reinterpret_cast<BuffHead *>(m_mem.head());
+        m_buf = m_mem.data();
+        if (m_head->m_max_size != m_mem.size() || m_head->m_used_size > m_head->m_max_size)
+        {
+            m_mem.destroy();
+            m_head = nullptr;
+            m_buf = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    /// 底层memfd，用来传给别的进程
+    int fd() const { return m_mem.fd(); }
+};
+
 }  // namespace inner
 }  // namespace pepper
 
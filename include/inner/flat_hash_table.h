@@ -0,0 +1,698 @@
+/*
+ * * file name: flat_hash_table.h
+ * * description:
+ * *     开放寻址的哈希表，接口和MemHashTable一样，MemMap和MemSet可以二选一
+ * *     每个槽位一个控制字节，16个一组，用SSE2一次比较一组，没有SSE2的时候逐个字节比较
+ * *     数据直接放在槽位里面，找到控制字节之后只需要再访问一次数据
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _FLAT_HASH_TABLE_H_
+#define _FLAT_HASH_TABLE_H_
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "../base_struct.h"
+#include "../utils/traits_utils.h"
+#include "flat_hash_table_policy.h"
+#include "head.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace pepper
+{
+namespace inner
+{
+/// 一组控制字节的匹配结果，第i位是1表示第i个槽位匹配
+struct FlatGroup
+{
+    explicit FlatGroup(const int8_t* ctrl_) : m_ctrl(ctrl_) {}
+
+    /// 在用并且哈希的低7位一样的槽位
+    uint32_t match(int8_t h2_) const
+    {
+#ifdef __SSE2__
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2_), ctrl)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < FLAT_GROUP_WIDTH; ++i)
+            mask |= static_cast<uint32_t>(m_ctrl[i] == h2_) << i;
+        return mask;
+#endif
+    }
+
+    /// 空槽位
+    uint32_t match_empty() const { return match(FLAT_CTRL_EMPTY); }
+
+    /// 在用的槽位，控制字节最高位是1
+    uint32_t match_full() const
+    {
+#ifdef __SSE2__
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(m_ctrl))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < FLAT_GROUP_WIDTH; ++i)
+            mask |= static_cast<uint32_t>(m_ctrl[i] < 0) << i;
+        return mask;
+#endif
+    }
+
+    /// 空的或者删除了的槽位，可以放新数据
+    uint32_t match_free() const { return ~match_full() & ((1u << FLAT_GROUP_WIDTH) - 1); }
+
+private:
+    const int8_t* m_ctrl;
+};
+
+template <typename POLICY>
+struct FlatHashTable : public POLICY
+{
+    using BaseType = POLICY;
+    using IntType = typename BaseType::IntType;
+    using KeyType = typename BaseType::KeyType;
+    using ValueType = typename BaseType::NodeType;
+
+    class Iterator
+    {
+        friend struct FlatHashTable;
+        const FlatHashTable* m_table = nullptr;
+        IntType m_index = 0;
+        Iterator(const FlatHashTable* table_, IntType index_) : m_table(table_), m_index(index_) {}
+
+    public:
+        using difference_type = std::ptrdiff_t;
+        using value_type = ValueType;
+        using pointer = ValueType*;
+        using reference = ValueType&;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+        const ValueType& operator*() const;
+        ValueType& operator*();
+        const ValueType* operator->() const;
+        ValueType* operator->();
+        bool operator==(const Iterator& right_) const;
+        bool operator!=(const Iterator& right_) const;
+        Iterator& operator++();
+        Iterator operator++(int);
+    };
+
+    /// 透明查找的key类型，和MemHashTable一样
+    template <typename K>
+    using TransparentKey = std::enable_if_t<BaseType::IS_TRANSPARENT && !std::is_same_v<K, KeyType> &&
+                                            !std::is_same_v<K, ValueType> && !std::is_same_v<K, Iterator>>;
+
+    /// 清空列表
+    void clear();
+    /// 列表是否空
+    bool empty() const;
+    /// 列表是否满了
+    bool full() const;
+    /// 当前已经用的个数
+    size_t size() const;
+    /// 列表最大容量
+    size_t capacity() const;
+    /// 插入一个元素，如果存在则返回失败
+    std::pair<Iterator, bool> insert(const ValueType& value_);
+    std::pair<IntType, bool> insert2(const ValueType& value_);
+    /// 找到节点
+    const Iterator find(const KeyType& key_) const;
+    Iterator find(const KeyType& key_);
+    IntType find_index(const KeyType& key_) const;
+    /// 是否存在
+    bool exist(const KeyType& value_) const;
+    /// 删除一个，根据迭代器
+    IntType erase(const Iterator& it_);
+    /// 删除一个，根据值
+    IntType erase(const KeyType& value_);
+
+    /// 用别的类型的key查找和删除
+    template <typename K, typename = TransparentKey<K>>
+    const Iterator find(const K& key_) const;
+    template <typename K, typename = TransparentKey<K>>
+    Iterator find(const K& key_);
+    template <typename K, typename = TransparentKey<K>>
+    IntType find_index(const K& key_) const;
+    template <typename K, typename = TransparentKey<K>>
+    bool exist(const K& key_) const;
+    template <typename K, typename = TransparentKey<K>>
+    IntType erase(const K& key_);
+
+    /// 算key的哈希值，就是HASH的结果，打散是在表里面做的
+    template <typename K>
+    size_t key_hash(const K& key_) const;
+    /// 调用者已经有哈希值了，hash_必须是key_hash(key_)的结果
+    template <typename K>
+    const Iterator find_hashed(const K& key_, size_t hash_) const;
+    template <typename K>
+    Iterator find_hashed(const K& key_, size_t hash_);
+    template <typename K>
+    IntType find_index_hashed(const K& key_, size_t hash_) const;
+    std::pair<Iterator, bool> insert_hashed(const ValueType& value_, size_t hash_);
+    std::pair<IntType, bool> insert2_hashed(const ValueType& value_, size_t hash_);
+    template <typename K>
+    IntType erase_hashed(const K& key_, size_t hash_);
+
+    /// 批量导入，和MemHashTable::build一样，数据本来就直接放在槽位里面，check_unique_ == false的时候省掉查找
+    template <typename ITER>
+    size_t build(ITER first_, ITER last_, bool check_unique_ = true);
+
+    /// 整理碎片，开放寻址没有空闲链，碎片是删除留下的DELETED槽位，把在用的节点重新放一遍就清掉了
+    /// sort_by_bucket_ 只是为了和MemHashTable的接口一致，返回搬动了的节点数
+    size_t compact(bool sort_by_bucket_ = false);
+
+    /// 按槽位顺序遍历，一次看一组控制字节跳过空槽位，和MemHashTable::for_each一样遍历过程中不能插入和删除
+    template <typename FUNC>
+    void for_each(FUNC&& func_);
+    template <typename FUNC>
+    void for_each(FUNC&& func_) const;
+
+    /// 批量查找，keys_[i]的结果放到indices_[i]或者iters_[i]，返回找到的个数
+    /// 每组先算完哈希预取控制字节，再预取第一个匹配的槽位，最后才比较key
+    size_t find_batch(const KeyType* keys_, size_t num_, IntType* indices_) const;
+    size_t find_batch(const KeyType* keys_, size_t num_, Iterator* iters_);
+    /// 迭代器
+    const Iterator begin() const;
+    const Iterator end() const;
+    Iterator begin();
+    Iterator end();
+
+    /// 下标从1开始，0表示没有，和MemHashTable一样
+    const ValueType& deref(IntType index_) const;
+    ValueType& deref(IntType index_);
+
+    const KeyType& key_of_value(const KeyType& key_) const { return key_; }
+    using SecondType = std::conditional_t<std::is_same_v<ValueType, KeyType>, bool, typename BaseType::SecondType>;
+    const KeyType& key_of_value(const Pair<KeyType, SecondType>& pair_) const { return pair_.first; }
+
+private:
+    /// 高位用来选组，低7位放到控制字节里面
+    template <typename K>
+    size_t hash_of(const K& key_) const
+    {
+        return mix_hash(BaseType::hash()(key_));
+    }
+    static int8_t h2_of(size_t hash_) { return static_cast<int8_t>(0x80 | (hash_ & 0x7f)); }
+    /// 一组批量查找的个数
+    static constexpr size_t FIND_BATCH_GROUP = 16;
+    /// 哈希值对应的第一个组
+    size_t first_group(size_t hash_) const { return (hash_ >> 7) & (BaseType::group_num() - 1); }
+
+    /// 找到了返回槽位下标+1，找不到返回0
+    template <typename K>
+    IntType find_index_impl(size_t hash_, const K& key_) const;
+    /// 删除找到的槽位
+    IntType erase_slot(IntType index_);
+    /// 探测序列上第一个可以放数据的槽位
+    size_t find_free_slot(size_t hash_) const;
+    /// 从slot_开始（包括slot_）往后第一个在用的槽位，返回下标+1，没有返回0
+    IntType find_next_full(size_t slot_) const;
+    template <typename TABLE, typename FUNC>
+    static void for_each_impl(TABLE& table_, FUNC&& func_);
+};
+
+template <typename POLICY>
+void FlatHashTable<POLICY>::clear()
+{
+    BaseType::clear();
+}
+
+template <typename POLICY>
+bool FlatHashTable<POLICY>::empty() const
+{
+    return BaseType::used() == 0 && BaseType::max_num() > 0;
+}
+
+template <typename POLICY>
+bool FlatHashTable<POLICY>::full() const
+{
+    return BaseType::used() == BaseType::max_num();
+}
+
+template <typename POLICY>
+size_t FlatHashTable<POLICY>::size() const
+{
+    return BaseType::used();
+}
+
+template <typename POLICY>
+size_t FlatHashTable<POLICY>::capacity() const
+{
+    return BaseType::max_num();
+}
+
+template <typename POLICY>
+std::pair<typename FlatHashTable<POLICY>::Iterator, bool> FlatHashTable<POLICY>::insert(const ValueType& value_)
+{
+    return insert_hashed(value_, key_hash(key_of_value(value_)));
+}
+
+template <typename POLICY>
+std::pair<typename FlatHashTable<POLICY>::IntType, bool> FlatHashTable<POLICY>::insert2(const ValueType& value_)
+{
+    return insert2_hashed(value_, key_hash(key_of_value(value_)));
+}
+
+template <typename POLICY>
+std::pair<typename FlatHashTable<POLICY>::Iterator, bool> FlatHashTable<POLICY>::insert_hashed(const ValueType& value_,
+                                                                                              size_t hash_)
+{
+    auto result = insert2_hashed(value_, hash_);
+    return std::make_pair(Iterator(this, result.first), result.second);
+}
+
+template <typename POLICY>
+std::pair<typename FlatHashTable<POLICY>::IntType, bool> FlatHashTable<POLICY>::insert2_hashed(const ValueType& value_,
+                                                                                              size_t hash_)
+{
+    assert(hash_ == key_hash(key_of_value(value_)));
+    size_t hash = mix_hash(hash_);
+    IntType index = find_index_impl(hash, key_of_value(value_));
+    if (index != 0)
+        return std::make_pair(index, false);
+    if (full())
+        return std::make_pair(0, false);
+
+    // 最多用7/8的槽位，一定能找到空位
+    size_t slot = find_free_slot(hash);
+    *BaseType::ctrl(slot) = h2_of(hash);
+    BaseType::incr_used();
+    BaseType::copy_value(slot, value_);
+    return std::make_pair(static_cast<IntType>(slot + 1), true);
+}
+
+template <typename POLICY>
+const typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::find(const KeyType& key_) const
+{
+    return Iterator(this, find_index(key_));
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::find(const KeyType& key_)
+{
+    return Iterator(this, find_index(key_));
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::find_index(const KeyType& key_) const
+{
+    return find_index_impl(hash_of(key_), key_);
+}
+
+template <typename POLICY>
+template <typename K, typename>
+const typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::find(const K& key_) const
+{
+    return Iterator(this, find_index(key_));
+}
+
+template <typename POLICY>
+template <typename K, typename>
+typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::find(const K& key_)
+{
+    return Iterator(this, find_index(key_));
+}
+
+template <typename POLICY>
+template <typename K, typename>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::find_index(const K& key_) const
+{
+    return find_index_impl(hash_of(key_), key_);
+}
+
+template <typename POLICY>
+template <typename K, typename>
+bool FlatHashTable<POLICY>::exist(const K& key_) const
+{
+    return find_index(key_) != 0;
+}
+
+template <typename POLICY>
+template <typename K, typename>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::erase(const K& key_)
+{
+    if (BaseType::used() == 0)
+        return 0;
+    return erase_slot(find_index(key_));
+}
+
+template <typename POLICY>
+template <typename K>
+size_t FlatHashTable<POLICY>::key_hash(const K& key_) const
+{
+    return BaseType::hash()(key_);
+}
+
+template <typename POLICY>
+template <typename K>
+const typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::find_hashed(const K& key_, size_t hash_) const
+{
+    return Iterator(this, find_index_hashed(key_, hash_));
+}
+
+template <typename POLICY>
+template <typename K>
+typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::find_hashed(const K& key_, size_t hash_)
+{
+    return Iterator(this, find_index_hashed(key_, hash_));
+}
+
+template <typename POLICY>
+template <typename K>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::find_index_hashed(const K& key_, size_t hash_) const
+{
+    assert(hash_ == key_hash(key_));
+    return find_index_impl(mix_hash(hash_), key_);
+}
+
+template <typename POLICY>
+template <typename K>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::erase_hashed(const K& key_, size_t hash_)
+{
+    if (BaseType::used() == 0)
+        return 0;
+    return erase_slot(find_index_hashed(key_, hash_));
+}
+
+template <typename POLICY>
+template <typename K>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::find_index_impl(size_t hash_, const K& key_) const
+{
+    auto&& equal = POLICY::is_equal();
+    int8_t h2 = h2_of(hash_);
+    size_t group_mask = BaseType::group_num() - 1;
+    size_t group_index = first_group(hash_);
+    // 三角数步长，组数是2的幂的时候每个组刚好探测一次
+    for (size_t i = 1; i <= BaseType::group_num(); ++i)
+    {
+        size_t first_slot = group_index * FLAT_GROUP_WIDTH;
+        FlatGroup group(BaseType::ctrl(first_slot));
+        for (uint32_t mask = group.match(h2); mask != 0; mask &= mask - 1)
+        {
+            size_t slot = first_slot + __builtin_ctz(mask);
+            if (equal(key_of_value(BaseType::value(slot)), key_))
+                return static_cast<IntType>(slot + 1);
+        }
+        // 有空槽位说明插入的时候不会越过这一组
+        if (group.match_empty() != 0)
+            return 0;
+        group_index = (group_index + i) & group_mask;
+    }
+    return 0;
+}
+
+template <typename POLICY>
+template <typename ITER>
+size_t FlatHashTable<POLICY>::build(ITER first_, ITER last_, bool check_unique_)
+{
+    size_t inserted = 0;
+    for (; first_ != last_ && !full(); ++first_)
+    {
+        if (check_unique_)
+        {
+            inserted += insert2(*first_).second ? 1 : 0;
+            continue;
+        }
+        size_t hash = hash_of(key_of_value(*first_));
+        size_t slot = find_free_slot(hash);
+        *BaseType::ctrl(slot) = h2_of(hash);
+        BaseType::incr_used();
+        BaseType::copy_value(slot, *first_);
+        ++inserted;
+    }
+    return inserted;
+}
+
+template <typename POLICY>
+size_t FlatHashTable<POLICY>::compact(bool sort_by_bucket_)
+{
+    size_t used = BaseType::used();
+    std::vector<uint8_t> values(sizeof(ValueType) * used);
+    std::vector<size_t> old_slots;
+    old_slots.reserve(used);
+    for (IntType index = find_next_full(0); index != 0; index = find_next_full(index))
+    {
+        memcpy(values.data() + sizeof(ValueType) * old_slots.size(),
+               static_cast<const void*>(&BaseType::value(index - 1)), sizeof(ValueType));
+        old_slots.push_back(index - 1);
+    }
+    assert(old_slots.size() == used);
+
+    BaseType::clear();
+    size_t moved = 0;
+    for (size_t i = 0; i < used; ++i)
+    {
+        const ValueType& value = *reinterpret_cast<const ValueType*>(values.data() + sizeof(ValueType) * i);
+        size_t hash = hash_of(key_of_value(value));
+        size_t slot = find_free_slot(hash);
+        *BaseType::ctrl(slot) = h2_of(hash);
+        BaseType::incr_used();
+        memcpy(static_cast<void*>(&BaseType::value(slot)), &value, sizeof(ValueType));
+        moved += slot != old_slots[i] ? 1 : 0;
+    }
+    return moved;
+}
+
+template <typename POLICY>
+size_t FlatHashTable<POLICY>::find_batch(const KeyType* keys_, size_t num_, IntType* indices_) const
+{
+    size_t found = 0;
+    size_t hashes[FIND_BATCH_GROUP];
+    for (size_t start = 0; start < num_; start += FIND_BATCH_GROUP)
+    {
+        size_t group_num = std::min(FIND_BATCH_GROUP, num_ - start);
+        const KeyType* keys = keys_ + start;
+        // 第一轮只算哈希，预取第一组控制字节
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            hashes[i] = hash_of(keys[i]);
+            prefetch_read(BaseType::ctrl(first_group(hashes[i]) * FLAT_GROUP_WIDTH));
+        }
+        // 第二轮匹配控制字节，预取第一个候选槽位的数据
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            size_t first_slot = first_group(hashes[i]) * FLAT_GROUP_WIDTH;
+            uint32_t mask = FlatGroup(BaseType::ctrl(first_slot)).match(h2_of(hashes[i]));
+            if (mask != 0)
+                prefetch_read(&BaseType::value(first_slot + __builtin_ctz(mask)));
+        }
+        // 第三轮正常探测
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            indices_[start + i] = find_index_impl(hashes[i], keys[i]);
+            if (indices_[start + i] != 0)
+                ++found;
+        }
+    }
+    return found;
+}
+
+template <typename POLICY>
+size_t FlatHashTable<POLICY>::find_batch(const KeyType* keys_, size_t num_, Iterator* iters_)
+{
+    size_t found = 0;
+    IntType indices[FIND_BATCH_GROUP];
+    for (size_t start = 0; start < num_; start += FIND_BATCH_GROUP)
+    {
+        size_t group_num = std::min(FIND_BATCH_GROUP, num_ - start);
+        found += find_batch(keys_ + start, group_num, indices);
+        for (size_t i = 0; i < group_num; ++i)
+            iters_[start + i] = Iterator(this, indices[i]);
+    }
+    return found;
+}
+
+template <typename POLICY>
+size_t FlatHashTable<POLICY>::find_free_slot(size_t hash_) const
+{
+    size_t group_mask = BaseType::group_num() - 1;
+    size_t group_index = first_group(hash_);
+    for (size_t i = 1; i <= BaseType::group_num(); ++i)
+    {
+        size_t first_slot = group_index * FLAT_GROUP_WIDTH;
+        uint32_t mask = FlatGroup(BaseType::ctrl(first_slot)).match_free();
+        if (mask != 0)
+            return first_slot + __builtin_ctz(mask);
+        group_index = (group_index + i) & group_mask;
+    }
+    assert(false);
+    return 0;
+}
+
+template <typename POLICY>
+bool FlatHashTable<POLICY>::exist(const KeyType& value_) const
+{
+    return find_index(value_) != 0;
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::erase(const Iterator& it_)
+{
+    assert(it_.m_table == this);
+    if (it_.m_index > 0)
+        return erase(key_of_value(BaseType::value(it_.m_index - 1)));
+    return 0;
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::erase(const KeyType& value_)
+{
+    if (BaseType::used() == 0)
+        return 0;
+
+    return erase_slot(find_index(value_));
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::erase_slot(IntType index_)
+{
+    if (index_ == 0)
+        return 0;
+
+    // 组里面还有空槽位，说明从来没有探测越过这一组，可以直接标成空的，否则只能标成删除
+    size_t slot = index_ - 1;
+    FlatGroup group(BaseType::ctrl(slot / FLAT_GROUP_WIDTH * FLAT_GROUP_WIDTH));
+    *BaseType::ctrl(slot) = group.match_empty() != 0 ? FLAT_CTRL_EMPTY : FLAT_CTRL_DELETED;
+    BaseType::decr_used();
+    return index_;
+}
+
+template <typename POLICY>
+template <typename FUNC>
+void FlatHashTable<POLICY>::for_each(FUNC&& func_)
+{
+    for_each_impl(*this, std::forward<FUNC>(func_));
+}
+
+template <typename POLICY>
+template <typename FUNC>
+void FlatHashTable<POLICY>::for_each(FUNC&& func_) const
+{
+    for_each_impl(*this, std::forward<FUNC>(func_));
+}
+
+template <typename POLICY>
+template <typename TABLE, typename FUNC>
+void FlatHashTable<POLICY>::for_each_impl(TABLE& table_, FUNC&& func_)
+{
+    size_t slot_num = table_.group_num() * FLAT_GROUP_WIDTH;
+    for (size_t first_slot = 0; first_slot < slot_num; first_slot += FLAT_GROUP_WIDTH)
+    {
+        for (uint32_t mask = FlatGroup(table_.ctrl(first_slot)).match_full(); mask != 0; mask &= mask - 1)
+            func_(table_.value(first_slot + __builtin_ctz(mask)));
+    }
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::IntType FlatHashTable<POLICY>::find_next_full(size_t slot_) const
+{
+    size_t slot_num = BaseType::group_num() * FLAT_GROUP_WIDTH;
+    while (slot_ < slot_num)
+    {
+        size_t first_slot = slot_ / FLAT_GROUP_WIDTH * FLAT_GROUP_WIDTH;
+        uint32_t mask = FlatGroup(BaseType::ctrl(first_slot)).match_full() >> (slot_ - first_slot);
+        if (mask != 0)
+            return static_cast<IntType>(slot_ + __builtin_ctz(mask) + 1);
+        slot_ = first_slot + FLAT_GROUP_WIDTH;
+    }
+    return 0;
+}
+
+template <typename POLICY>
+const typename FlatHashTable<POLICY>::ValueType& FlatHashTable<POLICY>::deref(IntType index_) const
+{
+    return BaseType::value(index_ - 1);
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::ValueType& FlatHashTable<POLICY>::deref(IntType index_)
+{
+    return BaseType::value(index_ - 1);
+}
+
+template <typename POLICY>
+const typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::begin() const
+{
+    return Iterator(this, find_next_full(0));
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::begin()
+{
+    return Iterator(this, find_next_full(0));
+}
+
+template <typename POLICY>
+const typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::end() const
+{
+    return Iterator(this, 0);
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::end()
+{
+    return Iterator(this, 0);
+}
+
+template <typename POLICY>
+const typename FlatHashTable<POLICY>::ValueType& FlatHashTable<POLICY>::Iterator::operator*() const
+{
+    return m_table->value(m_index - 1);
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::ValueType& FlatHashTable<POLICY>::Iterator::operator*()
+{
+    return const_cast<FlatHashTable*>(m_table)->value(m_index - 1);
+}
+
+template <typename POLICY>
+const typename FlatHashTable<POLICY>::ValueType* FlatHashTable<POLICY>::Iterator::operator->() const
+{
+    return &(operator*());
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::ValueType* FlatHashTable<POLICY>::Iterator::operator->()
+{
+    return &(operator*());
+}
+
+template <typename POLICY>
+bool FlatHashTable<POLICY>::Iterator::operator==(const Iterator& right_) const
+{
+    return (m_table == right_.m_table) && (m_index == right_.m_index);
+}
+
+template <typename POLICY>
+bool FlatHashTable<POLICY>::Iterator::operator!=(const Iterator& right_) const
+{
+    return (m_table != right_.m_table) || (m_index != right_.m_index);
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::Iterator& FlatHashTable<POLICY>::Iterator::operator++()
+{
+    // 槽位数组是连续的，往后扫控制字节就行，不用重新算哈希
+    m_index = m_table->find_next_full(m_index);
+    return (*this);
+}
+
+template <typename POLICY>
+typename FlatHashTable<POLICY>::Iterator FlatHashTable<POLICY>::Iterator::operator++(int)
+{
+    Iterator temp = (*this);
+    ++(*this);
+    return temp;
+}
+
+}  // namespace inner
+}  // namespace pepper
+
+#endif
@@ -0,0 +1,217 @@
+/*
+ * * file name: flat_hash_table_policy.h
+ * * description: 开放寻址哈希表的内存布局，每个槽位一个控制字节，数据直接放在槽位数组里面
+ * *              控制字节按16个一组，查找的时候一次比较一整组
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _FLAT_HASH_TABLE_POLICY_H_
+#define _FLAT_HASH_TABLE_POLICY_H_
+
+#include "../base_struct.h"
+#include "../utils/traits_utils.h"
+#include "policy.h"
+
+namespace pepper
+{
+namespace inner
+{
+/// 控制字节的取值，最高位是1表示槽位在用，低7位是哈希的低7位
+/// 空槽位是0，这样全部清0的内存就是一个空表
+enum FlatCtrl : int8_t
+{
+    FLAT_CTRL_EMPTY = 0,
+    FLAT_CTRL_DELETED = 1,
+};
+
+/// 一组的槽位数，和SSE2一个寄存器的字节数一样，定下来之后共享内存的布局就不会随编译选项变化
+static constexpr size_t FLAT_GROUP_WIDTH = 16;
+
+/// 最多用到7/8的槽位，保证探测的时候总能碰到空槽位
+inline constexpr size_t flat_group_num(size_t max_num_)
+{
+    return ceil_pow_of_two((max_num_ * 8 / 7 + FLAT_GROUP_WIDTH) / FLAT_GROUP_WIDTH);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename HASH = std::hash<KEY>,
+          typename IS_EQUAL = IsEqual<KEY>>
+struct FlatHashTablePolicy : public BasePolicy<KEY, HASH, IS_EQUAL>
+{
+protected:
+    using BaseType = BasePolicy<KEY, HASH, IS_EQUAL>;
+    /// 下标是槽位的下标，槽位数比MAX_SIZE多
+    using IntType = typename FixIntType<flat_group_num(MAX_SIZE) * FLAT_GROUP_WIDTH>::IntType;
+    using KeyType = KEY;
+    using SecondType = VALUE;
+    using NodeType = std::conditional_t<std::is_same_v<SecondType, void>, KeyType, Pair<KeyType, SecondType>>;
+    using RealNodeType = std::conditional_t<std::is_trivially_copyable_v<NodeType>, NodeType, char>;
+
+    void clear()
+    {
+        m_used = 0;
+        // todo 处理析构函数
+        memset(m_ctrl, FLAT_CTRL_EMPTY, sizeof(m_ctrl));
+    }
+
+    IntType constexpr used() const { return m_used; }
+    IntType constexpr max_num() const { return MAX_SIZE; }
+    size_t constexpr group_num() const { return GROUP_NUM; }
+
+    int8_t* ctrl(size_t index_) { return m_ctrl + index_; }
+    const int8_t* ctrl(size_t index_) const { return m_ctrl + index_; }
+
+    inline IntType incr_used() { return ++m_used; }
+    inline IntType decr_used() { return --m_used; }
+
+    NodeType& value(size_t index_) { return reinterpret_cast<NodeType&>(m_value[index_offset(index_)]); }
+    const NodeType& value(size_t index_) const
+    {
+        return reinterpret_cast<const NodeType&>(m_value[index_offset(index_)]);
+    }
+
+    template <typename T = NodeType>
+    inline std::enable_if_t<std::is_trivially_copyable_v<T>> copy_value(size_t index_, const T& node_value_)
+    {
+        value(index_) = node_value_;
+    }
+
+    // use placement new to construct the node if is not trivially copyable
+    template <typename T = NodeType>
+    inline std::enable_if_t<!std::is_trivially_copyable_v<T>> copy_value(size_t index_, const T& node_value_)
+    {
+        new (&(value(index_))) T(node_value_);
+    }
+
+private:
+    static constexpr size_t GROUP_NUM = flat_group_num(MAX_SIZE);
+    static constexpr size_t SLOT_NUM = GROUP_NUM * FLAT_GROUP_WIDTH;
+    static constexpr size_t index_offset(size_t index_) { return index_ * sizeof(NodeType) / sizeof(RealNodeType); }
+
+    /// 使用了多少个节点
+    IntType m_used = 0;
+    alignas(FLAT_GROUP_WIDTH) int8_t m_ctrl[SLOT_NUM] = {0};
+    RealNodeType m_value[index_offset(SLOT_NUM)];
+
+public:
+    // not impliment
+    static size_t need_mem_size(size_t max_num_, size_t buckets_num_);
+    bool init(void* mem_, size_t mem_size_, size_t max_num_, size_t buckets_num_, bool check_ = false);
+};
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+struct FlatHashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL> : public BasePolicy<KEY, HASH, IS_EQUAL>
+{
+protected:
+    using BaseType = BasePolicy<KEY, HASH, IS_EQUAL>;
+    using IntType = std::size_t;
+    using KeyType = KEY;
+    using SecondType = VALUE;
+    using NodeType = std::conditional_t<std::is_same_v<SecondType, void>, KeyType, Pair<KeyType, SecondType>>;
+    using RealNodeType = std::conditional_t<std::is_trivially_copyable_v<NodeType>, NodeType, char>;
+
+    void clear()
+    {
+        if (!m_head)
+            return;
+        m_head->m_used = 0;
+        // todo 处理析构函数
+        memset(m_ctrl, FLAT_CTRL_EMPTY, m_head->m_group_num * FLAT_GROUP_WIDTH);
+    }
+
+    IntType constexpr used() const { return m_head->m_used; }
+    IntType constexpr max_num() const { return m_head->m_max_num; }
+    size_t constexpr group_num() const { return m_head->m_group_num; }
+
+    int8_t* ctrl(size_t index_) { return m_ctrl + index_; }
+    const int8_t* ctrl(size_t index_) const { return m_ctrl + index_; }
+
+    inline IntType incr_used() { return ++(m_head->m_used); }
+    inline IntType decr_used() { return --(m_head->m_used); }
+
+    NodeType& value(size_t index_) { return reinterpret_cast<NodeType&>(m_value[index_offset(index_)]); }
+    const NodeType& value(size_t index_) const
+    {
+        return reinterpret_cast<const NodeType&>(m_value[index_offset(index_)]);
+    }
+
+    template <typename T = NodeType>
+    inline std::enable_if_t<std::is_trivially_copyable_v<T>> copy_value(size_t index_, const T& node_value_)
+    {
+        value(index_) = node_value_;
+    }
+
+    // use placement new to construct the node if is not trivially copyable
+    template <typename T = NodeType>
+    inline std::enable_if_t<!std::is_trivially_copyable_v<T>> copy_value(size_t index_, const T& node_value_)
+    {
+        new (&(value(index_))) T(node_value_);
+    }
+
+public:
+    /// buckets_num_ 只是为了和HashTablePolicy的接口保持一致，槽位数是根据max_num_算出来的
+    static size_t need_mem_size(size_t max_num_, size_t buckets_num_)
+    {
+        size_t slot_num = flat_group_num(max_num_) * FLAT_GROUP_WIDTH;
+        return ctrl_offset() + value_offset(slot_num) + sizeof(RealNodeType) * index_offset(slot_num);
+    }
+
+    bool init(void* mem_, size_t mem_size_, size_t max_num_, size_t buckets_num_, bool check_ = false)
+    {
+        if (!mem_ || need_mem_size(max_num_, buckets_num_) != mem_size_)
+            return false;
+        size_t group_num = flat_group_num(max_num_);
+        auto tmp_head = reinterpret_cast<Head*>(mem_);
+        if (check_)
+        {
+            if (tmp_head->m_mem_size != mem_size_ || tmp_head->m_max_num != max_num_ ||
+                tmp_head->m_group_num != group_num || tmp_head->m_used > max_num_)
+                return false;
+        }
+        else
+        {
+            memset(mem_, 0, mem_size_);
+            tmp_head->m_max_num = max_num_;
+            tmp_head->m_group_num = group_num;
+            tmp_head->m_mem_size = mem_size_;
+        }
+        m_head = tmp_head;
+        m_ctrl = reinterpret_cast<int8_t*>(reinterpret_cast<uint8_t*>(mem_) + ctrl_offset());
+        m_value = reinterpret_cast<RealNodeType*>(reinterpret_cast<uint8_t*>(mem_) + ctrl_offset() +
+                                                  value_offset(group_num * FLAT_GROUP_WIDTH));
+        return true;
+    }
+
+private:
+    static constexpr size_t index_offset(size_t index_) { return index_ * sizeof(NodeType) / sizeof(RealNodeType); }
+    /// 控制字节按组对齐，数据按自己的类型对齐
+    static constexpr size_t ctrl_offset()
+    {
+        return (sizeof(Head) + FLAT_GROUP_WIDTH - 1) / FLAT_GROUP_WIDTH * FLAT_GROUP_WIDTH;
+    }
+    static constexpr size_t value_offset(size_t slot_num_)
+    {
+        return (slot_num_ + alignof(NodeType) - 1) / alignof(NodeType) * alignof(NodeType);
+    }
+
+    struct Head
+    {
+        /// 使用了多少个节点
+        IntType m_used = 0;
+        /// 最大节点数
+        IntType m_max_num = 0;
+        /// 控制字节的组数，2的幂
+        IntType m_group_num = 0;
+        /// 总内存大小
+        IntType m_mem_size = 0;
+    };
+
+    Head* m_head = nullptr;
+    int8_t* m_ctrl = nullptr;
+    RealNodeType* m_value = nullptr;
+};
+
+}  // namespace inner
+}  // namespace pepper
+
+#endif
@@ -10,22 +10,146 @@
 
 #include "../base_struct.h"
 #include "policy.h"
+#include "undo_journal.h"
 
 namespace pepper
 {
 namespace inner
 {
+/// 缓存哈希值的时候，桶链的下标和哈希值放在一起，比较key之前先比较哈希值，不用去访问value数组
+template <typename IntType>
+struct HashLink
+{
+    IntType m_next = 0;
+    uint32_t m_hash = 0;
+};
+
+template <typename IntType>
+inline IntType& link_next(IntType& link_)
+{
+    return link_;
+}
+
+template <typename IntType>
+inline const IntType& link_next(const IntType& link_)
+{
+    return link_;
+}
+
+template <typename IntType>
+inline IntType& link_next(HashLink<IntType>& link_)
+{
+    return link_.m_next;
+}
+
+template <typename IntType>
+inline const IntType& link_next(const HashLink<IntType>& link_)
+{
+    return link_.m_next;
+}
+
+/// 缓存的哈希值只有32位，高位折叠进来，保证算桶的时候用的是同一个值
+template <typename HashType>
+inline constexpr HashType fold_hash(size_t hash_)
+{
+    if constexpr (sizeof(HashType) < sizeof(size_t))
+        return static_cast<HashType>(hash_ ^ (hash_ >> 32));
+    else
+        return hash_;
+}
+
+/// 槽位在用的位图，每个字管64个槽位，不用走空闲链就知道一个槽位是不是空的
+static constexpr size_t LIVE_WORD_BITS = 64;
+
+inline constexpr size_t live_words(size_t num_)
+{
+    return (num_ + LIVE_WORD_BITS - 1) / LIVE_WORD_BITS;
+}
+
+/// 固定大小的位图放在基类里面，LIVE_BITMAP == false 的时候是空的，不占内存
+template <bool LIVE_BITMAP, size_t NUM>
+struct LiveBitmapHolder
+{
+};
+
+template <size_t NUM>
+struct LiveBitmapHolder<true, NUM>
+{
+    /// 第i位是1表示第i个槽位在用
+    uint64_t m_live[live_words(NUM)] = {};
+};
+
+/// 哈希值到桶下标的几种算法，每个算法提供桶数量的修正和取桶下标
+/// 取模，桶数量用素数，std::hash对整数是原样返回的，用素数才能分散开
+struct ModBucket
+{
+    template <size_t NUM>
+    static constexpr size_t static_buckets_num()
+    {
+        return NearByPrime<NUM>::PRIME;
+    }
+    static constexpr size_t buckets_num(size_t num_) { return num_; }
+    static constexpr size_t bucket(size_t hash_, size_t buckets_num_) { return hash_ % buckets_num_; }
+};
+
+/// 桶数量向上取整到2的幂，哈希值打散之后用掩码取低位，没有除法
+struct Pow2Bucket
+{
+    template <size_t NUM>
+    static constexpr size_t static_buckets_num()
+    {
+        return ceil_pow_of_two(NUM);
+    }
+    static constexpr size_t buckets_num(size_t num_) { return ceil_pow_of_two(num_); }
+    static constexpr size_t bucket(size_t hash_, size_t buckets_num_) { return mix_hash(hash_) & (buckets_num_ - 1); }
+};
+
+/// Lemire的fast range，打散之后的64位哈希值乘以桶数量取高64位，桶数量随意，没有除法
+struct FastRangeBucket
+{
+    template <size_t NUM>
+    static constexpr size_t static_buckets_num()
+    {
+        return NUM;
+    }
+    static constexpr size_t buckets_num(size_t num_) { return num_; }
+    static constexpr size_t bucket(size_t hash_, size_t buckets_num_)
+    {
+        return static_cast<size_t>((static_cast<unsigned __int128>(mix_hash(hash_)) * buckets_num_) >> 64);
+    }
+};
+
+/// CACHE_HASH == true 的时候每个节点在next旁边存一份32位的哈希值
+/// BUCKET 是取桶下标的算法，ModBucket、Pow2Bucket、FastRangeBucket
+/// JOURNAL == true 的时候头部带一个撤销日志，插入删除改下标都先记旧值，见undo_journal.h
+/// LIVE_BITMAP == true 的时候多一个槽位在用的位图，for_each和compact直接扫位图，不开的时候走桶链
 template <typename KEY, typename VALUE, size_t MAX_SIZE, typename HASH = std::hash<KEY>,
-          typename IS_EQUAL = IsEqual<KEY>>
-struct HashTablePolicy : public BasePolicy<KEY, HASH, IS_EQUAL>
+          typename IS_EQUAL = IsEqual<KEY>, bool CACHE_HASH = false, typename BUCKET = ModBucket,
+          bool JOURNAL = false, bool LIVE_BITMAP = false>
+struct HashTablePolicy : public BasePolicy<KEY, HASH, IS_EQUAL>,
+                         public JournalHolder<JOURNAL>,
+                         public LiveBitmapHolder<LIVE_BITMAP, MAX_SIZE>
 {
 protected:
     using BaseType = BasePolicy<KEY, HASH, IS_EQUAL>;
-    using IntType = typename FixIntType<MAX_SIZE>::IntType;
     using KeyType = KEY;
     using SecondType = VALUE;
     using NodeType = std::conditional_t<std::is_same_v<SecondType, void>, KeyType, Pair<KeyType, SecondType>>;
+    // 取模的时候找一个比max_size小素数会好一点，Pow2Bucket向上取整，桶数量可能比MAX_SIZE大
+    static constexpr size_t BUCKETS_SIZE =
+        (sizeof(NodeType) > 4 && MAX_SIZE <= 40) || (sizeof(NodeType) <= 4 && MAX_SIZE <= 50)
+            ? 1
+            : BUCKET::template static_buckets_num<MAX_SIZE>();
+    /// 下标类型要放得下桶数量
+    using IntType = typename FixIntType<(MAX_SIZE > BUCKETS_SIZE ? MAX_SIZE : BUCKETS_SIZE)>::IntType;
     using RealNodeType = std::conditional_t<std::is_trivially_copyable_v<NodeType>, NodeType, char>;
+    static constexpr bool IS_CACHE_HASH = CACHE_HASH;
+    static constexpr bool IS_LIVE_BITMAP = LIVE_BITMAP;
+    using HashType = std::conditional_t<CACHE_HASH, uint32_t, size_t>;
+    using LinkType = std::conditional_t<CACHE_HASH, HashLink<IntType>, IntType>;
+    using JournalType = JournalHolder<JOURNAL>;
+    using JournalType::journal_set;
+    using LiveType = LiveBitmapHolder<LIVE_BITMAP, MAX_SIZE>;
 
     void clear()
     {
@@ -34,7 +158,9 @@ protected:
         m_free_index = 0;
         // todo 处理析构函数
         memset(m_buckets, 0, sizeof(m_buckets));
-        memset(m_next, 0, sizeof(m_next));
+        memset(static_cast<void*>(m_next), 0, sizeof(m_next));
+        if constexpr (LIVE_BITMAP)
+            memset(LiveType::m_live, 0, sizeof(LiveType::m_live));
     }
 
     IntType constexpr used() const { return m_used; }
@@ -45,18 +171,61 @@ protected:
 
     IntType& buckets(size_t index_) { return m_buckets[index_]; }
     const IntType& buckets(size_t index_) const { return m_buckets[index_]; }
-    IntType& next(size_t index_) { return m_next[index_]; }
-    const IntType& next(size_t index_) const { return m_next[index_]; }
+    IntType& next(size_t index_) { return link_next(m_next[index_]); }
+    const IntType& next(size_t index_) const { return link_next(m_next[index_]); }
+    /// 只有CACHE_HASH == true 的时候能用
+    HashType& hash_tag(size_t index_) { return m_next[index_].m_hash; }
+    const HashType& hash_tag(size_t index_) const { return m_next[index_].m_hash; }
+
+    /// 插入删除改链的时候走这两个，开了日志会先记旧值
+    void set_next(size_t index_, IntType next_) { journal_set(next(index_), next_); }
+    void set_bucket(size_t index_, IntType first_) { journal_set(m_buckets[index_], first_); }
+
+    /// is_live和live_word只有LIVE_BITMAP == true 的时候能用，不开的时候set_live、reset_live什么都不做
+    bool is_live(size_t index_) const { return (live_word(index_ / LIVE_WORD_BITS) >> (index_ % LIVE_WORD_BITS)) & 1; }
+    void set_live(size_t index_)
+    {
+        if constexpr (LIVE_BITMAP)
+        {
+            uint64_t& word = LiveType::m_live[index_ / LIVE_WORD_BITS];
+            journal_set(word, word | (uint64_t(1) << (index_ % LIVE_WORD_BITS)));
+        }
+    }
+    void reset_live(size_t index_)
+    {
+        if constexpr (LIVE_BITMAP)
+        {
+            uint64_t& word = LiveType::m_live[index_ / LIVE_WORD_BITS];
+            journal_set(word, word & ~(uint64_t(1) << (index_ % LIVE_WORD_BITS)));
+        }
+    }
+    uint64_t live_word(size_t word_) const { return LiveType::m_live[word_]; }
 
-    inline void set_used(IntType used_) { m_used = used_; }
-    inline IntType incr_used() { return ++m_used; }
-    inline IntType decr_used() { return --m_used; }
+    inline void set_used(IntType used_) { journal_set(m_used, used_); }
+    inline IntType incr_used()
+    {
+        journal_set(m_used, m_used + 1);
+        return m_used;
+    }
+    inline IntType decr_used()
+    {
+        journal_set(m_used, m_used - 1);
+        return m_used;
+    }
 
-    inline void set_raw_used(IntType raw_used_) { m_raw_used = raw_used_; }
-    inline IntType incr_raw_used() { return ++m_raw_used; }
-    inline IntType decr_raw_used() { return --m_raw_used; }
+    inline void set_raw_used(IntType raw_used_) { journal_set(m_raw_used, raw_used_); }
+    inline IntType incr_raw_used()
+    {
+        journal_set(m_raw_used, m_raw_used + 1);
+        return m_raw_used;
+    }
+    inline IntType decr_raw_used()
+    {
+        journal_set(m_raw_used, m_raw_used - 1);
+        return m_raw_used;
+    }
 
-    inline void set_free_index(IntType free_index_) { m_free_index = free_index_; }
+    inline void set_free_index(IntType free_index_) { journal_set(m_free_index, free_index_); }
 
     NodeType& value(size_t index_) { return m_value[index_offset(index_)]; }
     const NodeType& value(size_t index_) const { return m_value[index_offset(index_)]; }
@@ -74,26 +243,22 @@ protected:
         new (&(value(index_))) T(node_value_);
     }
 
-    IntType get_bucket_index(const KeyType& key_) const
+    template <typename K>
+    HashType hash_of(const K& key_) const
     {
-        return get_bucket_index_impl(key_, SizeIdentity<BUCKETS_SIZE>());
+        return fold_hash<HashType>(BaseType::hash()(key_));
     }
+    IntType bucket_of_hash(HashType hash_) const { return bucket_of_hash_impl(hash_, SizeIdentity<BUCKETS_SIZE>()); }
+    IntType get_bucket_index(const KeyType& key_) const { return bucket_of_hash(hash_of(key_)); }
 
 private:
-    static constexpr size_t fix_bucket_size()
-    {
-        return (sizeof(NodeType) > 4 && MAX_SIZE <= 40) || (sizeof(NodeType) <= 4 && MAX_SIZE <= 50)
-                   ? 1
-                   : NearByPrime<MAX_SIZE>::PRIME;
-    }
-
     template <size_t SIZE_OF_BUCKETS>
-    IntType constexpr get_bucket_index_impl(const KeyType& key_, SizeIdentity<SIZE_OF_BUCKETS>) const
+    IntType constexpr bucket_of_hash_impl(HashType hash_, SizeIdentity<SIZE_OF_BUCKETS>) const
     {
-        return BaseType::hash()(key_) % SIZE_OF_BUCKETS;
+        return BUCKET::bucket(hash_, SIZE_OF_BUCKETS);
     }
 
-    IntType constexpr get_bucket_index_impl(const KeyType& key_, SizeIdentity<1>) const { return 0; }
+    IntType constexpr bucket_of_hash_impl(HashType hash_, SizeIdentity<1>) const { return 0; }
 
     static constexpr IntType index_offset(IntType index_) { return index_ * sizeof(NodeType) / sizeof(RealNodeType); }
     /// 使用了多少个节点
@@ -102,11 +267,9 @@ private:
     IntType m_raw_used = 0;
     /// 空闲链头个节点，m_next的下标，从1开始，0 表示没有
     IntType m_free_index = 0;
-    // 找一个比max_size小素数会好一点
-    static constexpr size_t BUCKETS_SIZE = fix_bucket_size();
     IntType m_buckets[BUCKETS_SIZE] = {0};
     /// 存储链表下标，每一个和value数组一一对应，为了字节对齐
-    IntType m_next[MAX_SIZE] = {0};
+    LinkType m_next[MAX_SIZE] = {};
     static constexpr size_t REAL_NODE_SIZE = index_offset(MAX_SIZE);
     RealNodeType m_value[REAL_NODE_SIZE];
 
@@ -116,8 +279,10 @@ public:
     bool init(void* mem_, size_t mem_size_, size_t max_num_, size_t buckets_num_, bool check_ = false);
 };
 
-template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
-struct HashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL> : public BasePolicy<KEY, HASH, IS_EQUAL>
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL, bool CACHE_HASH, typename BUCKET,
+          bool JOURNAL, bool LIVE_BITMAP>
+struct HashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL, CACHE_HASH, BUCKET, JOURNAL, LIVE_BITMAP>
+    : public BasePolicy<KEY, HASH, IS_EQUAL>
 {
 protected:
     using BaseType = BasePolicy<KEY, HASH, IS_EQUAL>;
@@ -126,6 +291,19 @@ protected:
     using SecondType = VALUE;
     using NodeType = std::conditional_t<std::is_same_v<SecondType, void>, KeyType, Pair<KeyType, SecondType>>;
     using RealNodeType = std::conditional_t<std::is_trivially_copyable_v<NodeType>, NodeType, char>;
+    static constexpr bool IS_CACHE_HASH = CACHE_HASH;
+    static constexpr bool IS_LIVE_BITMAP = LIVE_BITMAP;
+    using HashType = std::conditional_t<CACHE_HASH, uint32_t, size_t>;
+    using LinkType = std::conditional_t<CACHE_HASH, HashLink<IntType>, IntType>;
+
+    /// 日志放在头部，挂上来的时候init里面会撤销没做完的修改
+    typename JournalHolder<JOURNAL>::Guard journal_guard() { return m_head->journal_guard(); }
+    template <typename T, typename V>
+    void journal_set(T& field_, V value_)
+    {
+        m_head->journal_set(field_, value_);
+    }
+    bool journal_recover() { return m_head->journal_recover(); }
 
     void clear()
     {
@@ -136,7 +314,9 @@ protected:
         m_head->m_free_index = 0;
         // todo 处理析构函数
         memset(m_buckets, 0, sizeof(IntType) * m_head->m_buckets_num);
-        memset(m_next, 0, sizeof(IntType) * m_head->m_max_num);
+        memset(static_cast<void*>(m_next), 0, sizeof(LinkType) * m_head->m_max_num);
+        if constexpr (LIVE_BITMAP)
+            memset(m_live, 0, live_size(m_head->m_max_num));
     }
 
     IntType constexpr used() const { return m_head->m_used; }
@@ -146,18 +326,61 @@ protected:
     IntType constexpr buckets_num() const { return m_head->m_buckets_num; }
     IntType& buckets(size_t index_) { return m_buckets[index_]; }
     const IntType& buckets(size_t index_) const { return m_buckets[index_]; }
-    IntType& next(size_t index_) { return m_next[index_]; }
-    const IntType& next(size_t index_) const { return m_next[index_]; }
+    IntType& next(size_t index_) { return link_next(m_next[index_]); }
+    const IntType& next(size_t index_) const { return link_next(m_next[index_]); }
+    /// 只有CACHE_HASH == true 的时候能用
+    HashType& hash_tag(size_t index_) { return m_next[index_].m_hash; }
+    const HashType& hash_tag(size_t index_) const { return m_next[index_].m_hash; }
+
+    /// 插入删除改链的时候走这两个，开了日志会先记旧值
+    void set_next(size_t index_, IntType next_) { journal_set(next(index_), next_); }
+    void set_bucket(size_t index_, IntType first_) { journal_set(m_buckets[index_], first_); }
+
+    /// is_live和live_word只有LIVE_BITMAP == true 的时候能用，不开的时候set_live、reset_live什么都不做
+    bool is_live(size_t index_) const { return (m_live[index_ / LIVE_WORD_BITS] >> (index_ % LIVE_WORD_BITS)) & 1; }
+    void set_live(size_t index_)
+    {
+        if constexpr (LIVE_BITMAP)
+        {
+            uint64_t& word = m_live[index_ / LIVE_WORD_BITS];
+            journal_set(word, word | (uint64_t(1) << (index_ % LIVE_WORD_BITS)));
+        }
+    }
+    void reset_live(size_t index_)
+    {
+        if constexpr (LIVE_BITMAP)
+        {
+            uint64_t& word = m_live[index_ / LIVE_WORD_BITS];
+            journal_set(word, word & ~(uint64_t(1) << (index_ % LIVE_WORD_BITS)));
+        }
+    }
+    uint64_t live_word(size_t word_) const { return m_live[word_]; }
 
-    inline void set_used(IntType used_) { m_head->m_used = used_; }
-    inline IntType incr_used() { return ++(m_head->m_used); }
-    inline IntType decr_used() { return --(m_head->m_used); }
+    inline void set_used(IntType used_) { journal_set(m_head->m_used, used_); }
+    inline IntType incr_used()
+    {
+        journal_set(m_head->m_used, m_head->m_used + 1);
+        return m_head->m_used;
+    }
+    inline IntType decr_used()
+    {
+        journal_set(m_head->m_used, m_head->m_used - 1);
+        return m_head->m_used;
+    }
 
-    inline void set_raw_used(IntType raw_used_) { m_head->m_raw_used = raw_used_; }
-    inline IntType incr_raw_used() { return ++(m_head->m_raw_used); }
-    inline IntType decr_raw_used() { return --(m_head->m_raw_used); }
+    inline void set_raw_used(IntType raw_used_) { journal_set(m_head->m_raw_used, raw_used_); }
+    inline IntType incr_raw_used()
+    {
+        journal_set(m_head->m_raw_used, m_head->m_raw_used + 1);
+        return m_head->m_raw_used;
+    }
+    inline IntType decr_raw_used()
+    {
+        journal_set(m_head->m_raw_used, m_head->m_raw_used - 1);
+        return m_head->m_raw_used;
+    }
 
-    inline void set_free_index(IntType free_index_) { m_head->m_free_index = free_index_; }
+    inline void set_free_index(IntType free_index_) { journal_set(m_head->m_free_index, free_index_); }
 
     NodeType& value(size_t index_) { return m_value[index_]; }
     const NodeType& value(size_t index_) const { return m_value[index_]; }
@@ -175,12 +398,20 @@ protected:
         new (&(value(index_))) T(node_value_);
     }
 
-    inline IntType get_bucket_index(const KeyType& key_) const { return BaseType::hash()(key_) % buckets_num(); }
+    template <typename K>
+    HashType hash_of(const K& key_) const
+    {
+        return fold_hash<HashType>(BaseType::hash()(key_));
+    }
+    inline IntType bucket_of_hash(HashType hash_) const { return BUCKET::bucket(hash_, buckets_num()); }
+    inline IntType get_bucket_index(const KeyType& key_) const { return bucket_of_hash(hash_of(key_)); }
 
 public:
+    /// buckets_num_ 会按BUCKET的要求修正，比如Pow2Bucket向上取整到2的幂
     static size_t need_mem_size(size_t max_num_, size_t buckets_num_)
     {
-        return sizeof(Head) + sizeof(IntType) * buckets_num_ + sizeof(IntType) * max_num_ +
+        buckets_num_ = BUCKET::buckets_num(buckets_num_);
+        return sizeof(Head) + sizeof(IntType) * buckets_num_ + sizeof(LinkType) * max_num_ + live_size(max_num_) +
                sizeof(RealNodeType) * (max_num_ * sizeof(NodeType) / sizeof(RealNodeType));
     }
 
@@ -188,12 +419,15 @@ public:
     {
         if (!mem_ || need_mem_size(max_num_, buckets_num_) != mem_size_)
             return false;
+        buckets_num_ = BUCKET::buckets_num(buckets_num_);
         auto tmp_head = reinterpret_cast<Head*>(mem_);
         if (check_)
         {
             if (tmp_head->m_mem_size != mem_size_ || tmp_head->m_max_num != max_num_ ||
                 tmp_head->m_buckets_num != buckets_num_)
                 return false;
+            // 上一个进程改到一半挂了的话先撤销掉
+            tmp_head->journal_recover();
         }
         else
         {
@@ -204,17 +438,23 @@ public:
         }
         m_head = tmp_head;
         m_buckets = reinterpret_cast<IntType*>(reinterpret_cast<uint8_t*>(mem_) + sizeof(Head));
-        m_next = reinterpret_cast<IntType*>(reinterpret_cast<uint8_t*>(mem_) + sizeof(Head) +
-                                            sizeof(IntType) * buckets_num_);
-        m_value = reinterpret_cast<RealNodeType*>(reinterpret_cast<uint8_t*>(mem_) + sizeof(Head) +
-                                                  sizeof(IntType) * buckets_num_ + sizeof(IntType) * max_num_);
+        m_next = reinterpret_cast<LinkType*>(reinterpret_cast<uint8_t*>(mem_) + sizeof(Head) +
+                                             sizeof(IntType) * buckets_num_);
+        uint8_t* live = reinterpret_cast<uint8_t*>(m_next) + sizeof(LinkType) * max_num_;
+        m_live = LIVE_BITMAP ? reinterpret_cast<uint64_t*>(live) : nullptr;
+        m_value = reinterpret_cast<RealNodeType*>(live + live_size(max_num_));
         return true;
     }
 
 private:
     static constexpr IntType index_offset(IntType index_) { return index_ * sizeof(NodeType) / sizeof(RealNodeType); }
+    /// 没开位图的时候不占内存
+    static constexpr size_t live_size(size_t max_num_)
+    {
+        return LIVE_BITMAP ? sizeof(uint64_t) * live_words(max_num_) : 0;
+    }
 
-    struct Head
+    struct Head : public JournalHolder<JOURNAL>
     {
         /// 使用了多少个节点
         IntType m_used = 0;
@@ -232,7 +472,8 @@ private:
 
     Head* m_head = nullptr;
     IntType* m_buckets = nullptr;
-    IntType* m_next = nullptr;
+    LinkType* m_next = nullptr;
+    uint64_t* m_live = nullptr;
     RealNodeType* m_value = nullptr;
 };
 
@@ -16,12 +16,14 @@ namespace pepper
 {
 namespace inner
 {
+/// JOURNAL == true 的时候哈希表和active链的修改都记到哈希表头部的撤销日志里面
 template <typename KEY, typename VALUE, size_t MAX_SIZE, typename HASH = std::hash<KEY>,
-          typename IS_EQUAL = IsEqual<KEY>>
-struct LRUPolicy : private MemHashTable<HashTablePolicy<KEY, VALUE, MAX_SIZE, HASH, IS_EQUAL>>
+          typename IS_EQUAL = IsEqual<KEY>, bool JOURNAL = false>
+struct LRUPolicy
+    : private MemHashTable<HashTablePolicy<KEY, VALUE, MAX_SIZE, HASH, IS_EQUAL, false, ModBucket, JOURNAL>>
 {
 protected:
-    using TableType = MemHashTable<HashTablePolicy<KEY, VALUE, MAX_SIZE, HASH, IS_EQUAL>>;
+    using TableType = MemHashTable<HashTablePolicy<KEY, VALUE, MAX_SIZE, HASH, IS_EQUAL, false, ModBucket, JOURNAL>>;
     // 要多用一个节点，所以要能存下MAX_SIZE + 1
     using IntType = typename FixIntType<MAX_SIZE + 1>::IntType;
     using KeyType = KEY;
@@ -31,15 +33,23 @@ protected:
 
     const LinkNode& active_link(size_t index_) const { return m_active_link[index_]; }
     LinkNode& active_link(size_t index_) { return m_active_link[index_]; }
+    void set_active_prev(size_t index_, IntType prev_) { TableType::journal_set(m_active_link[index_].prev, prev_); }
+    void set_active_next(size_t index_, IntType next_) { TableType::journal_set(m_active_link[index_].next, next_); }
 
     using TableType::capacity;
     using TableType::clear;
     using TableType::deref;
     using TableType::empty;
     using TableType::erase;
+    using TableType::erase_hashed;
     using TableType::find_index;
+    using TableType::find_index_hashed;
     using TableType::full;
+    using TableType::IS_TRANSPARENT;
+    using TableType::journal_guard;
+    using TableType::key_hash;
     using TableType::key_of_value;
+    using TableType::recover;
     using TableType::size;
 
     void clear()
@@ -50,6 +60,10 @@ protected:
     }
 
     std::pair<IntType, bool> insert(const NodeType& value_) { return TableType::insert2(value_); }
+    std::pair<IntType, bool> insert_hashed(const NodeType& value_, size_t hash_)
+    {
+        return TableType::insert2_hashed(value_, hash_);
+    }
 
     static constexpr size_t need_mem_size(size_t max_num_, size_t buckets_num_);
     bool init(void* mem_, size_t mem_size_, size_t max_num_, size_t buckets_num_, bool check_ = false);
@@ -59,11 +73,12 @@ private:
     LinkNode m_active_link[MAX_SIZE + 1];
 };
 
-template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
-struct LRUPolicy<KEY, VALUE, 0, HASH, IS_EQUAL> : MemHashTable<HashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL>>
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL, bool JOURNAL>
+struct LRUPolicy<KEY, VALUE, 0, HASH, IS_EQUAL, JOURNAL>
+    : MemHashTable<HashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL, false, ModBucket, JOURNAL>>
 {
 protected:
-    using TableType = MemHashTable<HashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL>>;
+    using TableType = MemHashTable<HashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL, false, ModBucket, JOURNAL>>;
     using IntType = std::size_t;
     using KeyType = KEY;
     using SecondType = VALUE;
@@ -72,15 +87,23 @@ protected:
 
     const LinkNode& active_link(size_t index_) const { return m_active_link[index_]; }
     LinkNode& active_link(size_t index_) { return m_active_link[index_]; }
+    void set_active_prev(size_t index_, IntType prev_) { TableType::journal_set(m_active_link[index_].prev, prev_); }
+    void set_active_next(size_t index_, IntType next_) { TableType::journal_set(m_active_link[index_].next, next_); }
 
     using TableType::capacity;
     using TableType::clear;
     using TableType::deref;
     using TableType::empty;
     using TableType::erase;
+    using TableType::erase_hashed;
     using TableType::find_index;
+    using TableType::find_index_hashed;
     using TableType::full;
+    using TableType::IS_TRANSPARENT;
+    using TableType::journal_guard;
+    using TableType::key_hash;
     using TableType::key_of_value;
+    using TableType::recover;
     using TableType::size;
 
     void clear()
@@ -94,6 +117,10 @@ protected:
     }
 
     std::pair<IntType, bool> insert(const NodeType& value_) { return TableType::insert2(value_); }
+    std::pair<IntType, bool> insert_hashed(const NodeType& value_, size_t hash_)
+    {
+        return TableType::insert2_hashed(value_, hash_);
+    }
 
     static constexpr size_t need_mem_size(size_t max_num_, size_t buckets_num_)
     {
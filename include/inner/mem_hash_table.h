@@ -10,8 +10,10 @@
 #ifndef _MEM_HASH_TABLE_H_
 #define _MEM_HASH_TABLE_H_
 
+#include <algorithm>
 #include <iterator>
 #include <utility>
+#include <vector>
 #include "../base_struct.h"
 #include "../utils/traits_utils.h"
 #include "head.h"
@@ -27,6 +29,7 @@ struct MemHashTable : public POLICY
     using IntType = typename BaseType::IntType;
     using KeyType = typename BaseType::KeyType;
     using ValueType = typename BaseType::NodeType;
+    using HashType = typename BaseType::HashType;
 
     class Iterator
     {
@@ -54,6 +57,11 @@ struct MemHashTable : public POLICY
         // 不提供operator--函数了，为了省空间用了单向链表，没法做性能很好的前向迭代
     };
 
+    /// 透明查找的key类型，HASH和IS_EQUAL都有is_transparent才可以用，KeyType自己还是走原来的接口
+    template <typename K>
+    using TransparentKey = std::enable_if_t<BaseType::IS_TRANSPARENT && !std::is_same_v<K, KeyType> &&
+                                            !std::is_same_v<K, ValueType> && !std::is_same_v<K, Iterator>>;
+
     /// 清空列表
     void clear();
     /// 列表是否空
@@ -77,6 +85,66 @@ struct MemHashTable : public POLICY
     IntType erase(const Iterator& it_);
     /// 删除一个，根据值
     IntType erase(const KeyType& value_);
+
+    /// 用别的类型的key查找和删除，比如用string_view查char数组的key
+    template <typename K, typename = TransparentKey<K>>
+    const Iterator find(const K& key_) const;
+    template <typename K, typename = TransparentKey<K>>
+    Iterator find(const K& key_);
+    template <typename K, typename = TransparentKey<K>>
+    IntType find_index(const K& key_) const;
+    template <typename K, typename = TransparentKey<K>>
+    bool exist(const K& key_) const;
+    template <typename K, typename = TransparentKey<K>>
+    IntType erase(const K& key_);
+
+    /// 算key的哈希值，就是HASH的结果，可以留下来给下面的*_hashed接口用
+    template <typename K>
+    size_t key_hash(const K& key_) const;
+    /// 调用者已经有哈希值了，hash_必须是key_hash(key_)的结果，不会再算一次
+    template <typename K>
+    const Iterator find_hashed(const K& key_, size_t hash_) const;
+    template <typename K>
+    Iterator find_hashed(const K& key_, size_t hash_);
+    template <typename K>
+    IntType find_index_hashed(const K& key_, size_t hash_) const;
+    std::pair<Iterator, bool> insert_hashed(const ValueType& value_, size_t hash_);
+    std::pair<IntType, bool> insert2_hashed(const ValueType& value_, size_t hash_);
+    template <typename K>
+    IntType erase_hashed(const K& key_, size_t hash_);
+
+    /// 批量查找，keys_[i]的结果放到indices_[i]或者iters_[i]，找不到是0或者end()，返回找到的个数
+    /// 每组先算完哈希预取桶头，再预取链上第一个节点，最后才走链比较，一组里面的缓存缺失可以重叠起来
+    size_t find_batch(const KeyType* keys_, size_t num_, IntType* indices_) const;
+    size_t find_batch(const KeyType* keys_, size_t num_, Iterator* iters_);
+    /// 批量导入，[first_, last_)是随机访问迭代器，解引用得到ValueType，返回实际插入的个数
+    /// 空表的时候先按桶做一次计数排序，同一个桶的节点放在连续的槽位上，m_buckets、m_next、m_value都是顺序写
+    /// check_unique_ == false 的时候调用者保证没有重复的key，可以省掉比较，放不下的会被丢掉
+    /// 表不是空的话退化成一个一个插入
+    template <typename ITER>
+    size_t build(ITER first_, ITER last_, bool check_unique_ = true);
+
+    /// 整理碎片，在用的节点搬到[1, used]，重写桶链，清掉空闲链，返回搬动了的节点数
+    /// sort_by_bucket_ == true 的时候按桶的顺序排，遍历和做快照就是顺序读内存了，否则尽量保持原来的先后顺序
+    /// 节点是按内存拷贝搬的，和共享内存整块搬走是一样的，需要O(used)的临时内存
+    size_t compact(bool sort_by_bucket_ = false);
+
+    /// 开了撤销日志的时候，把上次没做完的插入或者删除撤销掉，返回true表示撤销了
+    /// 动态大小的在init(..., check_ = true)里面已经调过了，固定大小的整个对象放在共享内存里面，挂上来之后自己调
+    /// 没调的话下一次插入或者删除开始之前也会先撤销，但是在那之前读到的可能是改了一半的表
+    /// 只有insert和erase是可以恢复的，clear、build、compact中间挂了还是要重建
+    bool recover();
+
+    /// 不算哈希的快速遍历，func_(ValueType&)或者func_(const ValueType&)，遍历过程中不能插入和删除，适合整表落盘这种场景
+    /// POLICY开了LIVE_BITMAP的时候直接顺序扫[0, raw_used)的槽位，用位图跳过空闲的槽位，也不扫空桶，不开的时候沿着桶链走
+    template <typename FUNC>
+    void for_each(FUNC&& func_);
+    template <typename FUNC>
+    void for_each(FUNC&& func_) const;
+
+    /// 桶的个数和每个桶链上第一个节点的下标，0表示桶是空的，按桶搬数据的时候用
+    size_t bucket_count() const;
+    IntType bucket_first(size_t bucket_) const;
     /// 迭代器
     const Iterator begin() const;
     const Iterator end() const;
@@ -94,8 +162,19 @@ struct MemHashTable : public POLICY
 
 private:
     IntType find_first_used_bucket() const;
-    IntType find_index_impl(IntType bucket_index_, const KeyType& value_) const;
-    IntType insert(IntType bucket_index_, const ValueType& value_);
+    template <typename TABLE, typename FUNC>
+    static void for_each_impl(TABLE& table_, FUNC&& func_);
+    /// 一组批量查找的个数，太大的话预取的数据会在用到之前被挤出去
+    static constexpr size_t FIND_BATCH_GROUP = 16;
+
+    template <typename K>
+    IntType find_index_impl(IntType bucket_index_, HashType hash_, const K& key_) const;
+    /// 从index_开始沿着链找
+    template <typename K>
+    IntType find_in_chain(IntType index_, HashType hash_, const K& key_) const;
+    template <typename K>
+    IntType erase_impl(HashType hash_, const K& key_);
+    IntType insert(IntType bucket_index_, HashType hash_, const ValueType& value_);
 };
 
 template <typename POLICY>
@@ -131,36 +210,48 @@ size_t MemHashTable<POLICY>::capacity() const
 template <typename POLICY>
 std::pair<typename MemHashTable<POLICY>::Iterator, bool> MemHashTable<POLICY>::insert(const ValueType& value_)
 {
-    IntType bucket_index = BaseType::get_bucket_index(key_of_value(value_));
-    IntType index = find_index_impl(bucket_index, key_of_value(value_));
-    if (index != 0)
-        return std::make_pair(Iterator(this, index), false);
-    else
-    {
-        if (full())
-            return std::make_pair(end(), false);
-
-        return std::make_pair(Iterator(this, insert(bucket_index, value_)), true);
-    }
+    return insert_hashed(value_, key_hash(key_of_value(value_)));
 }
 
 template <typename POLICY>
 std::pair<typename MemHashTable<POLICY>::IntType, bool> MemHashTable<POLICY>::insert2(const ValueType& value_)
 {
-    IntType bucket_index = BaseType::get_bucket_index(key_of_value(value_));
-    IntType index = find_index_impl(bucket_index, key_of_value(value_));
+    return insert2_hashed(value_, key_hash(key_of_value(value_)));
+}
+
+template <typename POLICY>
+std::pair<typename MemHashTable<POLICY>::Iterator, bool> MemHashTable<POLICY>::insert_hashed(const ValueType& value_,
+                                                                                            size_t hash_)
+{
+    auto result = insert2_hashed(value_, hash_);
+    if (result.first == 0)
+        return std::make_pair(end(), false);
+    return std::make_pair(Iterator(this, result.first), result.second);
+}
+
+template <typename POLICY>
+std::pair<typename MemHashTable<POLICY>::IntType, bool> MemHashTable<POLICY>::insert2_hashed(const ValueType& value_,
+                                                                                            size_t hash_)
+{
+    assert(hash_ == key_hash(key_of_value(value_)));
+    // 开了日志的时候先撤销上次没做完的修改再查找和判断满没满，插入和拷贝都在这个范围里面
+    auto guard = BaseType::journal_guard();
+    HashType hash = fold_hash<HashType>(hash_);
+    IntType bucket_index = BaseType::bucket_of_hash(hash);
+    IntType index = find_index_impl(bucket_index, hash, key_of_value(value_));
     if (index != 0)
         return std::make_pair(index, false);
     else
     {
         if (full())
             return std::make_pair(0, false);
-        return std::make_pair(insert(bucket_index, value_), true);
+        return std::make_pair(insert(bucket_index, hash, value_), true);
     }
 }
 
 template <typename POLICY>
-typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::insert(IntType bucket_index_, const ValueType& value_)
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::insert(IntType bucket_index_, HashType hash_,
+                                                                    const ValueType& value_)
 {
     IntType empty_index = 0;
     if (BaseType::free_index() == 0)
@@ -179,12 +270,16 @@ typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::insert(IntType buck
     // 挂到桶链上，如果next的值是LAST_INDEX，则表示是该桶链的最后一个节点
     // 其实可以把buckets初始化成LAST_INDEX，这样这里就不用判断了
     // 但是那样defalut的构造函数不能用了，所以还是减轻调用者的负担
-    BaseType::next(empty_index - 1) = BaseType::buckets(bucket_index_);
-    BaseType::buckets(bucket_index_) = empty_index;
+    BaseType::set_next(empty_index - 1, BaseType::buckets(bucket_index_));
+    if constexpr (BaseType::IS_CACHE_HASH)
+        BaseType::hash_tag(empty_index - 1) = hash_;
+    BaseType::set_bucket(bucket_index_, empty_index);
+    BaseType::set_live(empty_index - 1);
 
     BaseType::incr_used();
 
     // 一切操作完了再拷贝数据，最坏情况是某一个数据拷贝失败，但是容器的结构不会破坏
+    // 开了日志的时候拷贝完才提交，拷贝到一半挂了或者拷贝抛了异常，整个插入都会撤销
     BaseType::copy_value(empty_index - 1, value_);
 
     return empty_index;
@@ -205,24 +300,166 @@ typename MemHashTable<POLICY>::Iterator MemHashTable<POLICY>::find(const KeyType
 template <typename POLICY>
 typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::find_index(const KeyType& value_) const
 {
-    return find_index_impl(BaseType::get_bucket_index(value_), value_);
+    HashType hash = BaseType::hash_of(value_);
+    return find_index_impl(BaseType::bucket_of_hash(hash), hash, value_);
+}
+
+template <typename POLICY>
+template <typename K, typename>
+const typename MemHashTable<POLICY>::Iterator MemHashTable<POLICY>::find(const K& key_) const
+{
+    return Iterator(this, find_index(key_));
+}
+
+template <typename POLICY>
+template <typename K, typename>
+typename MemHashTable<POLICY>::Iterator MemHashTable<POLICY>::find(const K& key_)
+{
+    return Iterator(this, find_index(key_));
+}
+
+template <typename POLICY>
+template <typename K, typename>
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::find_index(const K& key_) const
+{
+    return find_index_hashed(key_, key_hash(key_));
+}
+
+template <typename POLICY>
+template <typename K, typename>
+bool MemHashTable<POLICY>::exist(const K& key_) const
+{
+    return find_index(key_) != 0;
+}
+
+template <typename POLICY>
+template <typename K, typename>
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::erase(const K& key_)
+{
+    return erase_impl(BaseType::hash_of(key_), key_);
+}
+
+template <typename POLICY>
+template <typename K>
+size_t MemHashTable<POLICY>::key_hash(const K& key_) const
+{
+    return BaseType::hash()(key_);
+}
+
+template <typename POLICY>
+template <typename K>
+const typename MemHashTable<POLICY>::Iterator MemHashTable<POLICY>::find_hashed(const K& key_, size_t hash_) const
+{
+    return Iterator(this, find_index_hashed(key_, hash_));
+}
+
+template <typename POLICY>
+template <typename K>
+typename MemHashTable<POLICY>::Iterator MemHashTable<POLICY>::find_hashed(const K& key_, size_t hash_)
+{
+    return Iterator(this, find_index_hashed(key_, hash_));
 }
 
 template <typename POLICY>
-typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::find_index_impl(IntType bucket_index_,
-                                                                             const KeyType& value_) const
+template <typename K>
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::find_index_hashed(const K& key_, size_t hash_) const
+{
+    assert(hash_ == key_hash(key_));
+    HashType hash = fold_hash<HashType>(hash_);
+    return find_index_impl(BaseType::bucket_of_hash(hash), hash, key_);
+}
+
+template <typename POLICY>
+template <typename K>
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::erase_hashed(const K& key_, size_t hash_)
+{
+    assert(hash_ == key_hash(key_));
+    return erase_impl(fold_hash<HashType>(hash_), key_);
+}
+
+template <typename POLICY>
+template <typename K>
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::find_index_impl(IntType bucket_index_, HashType hash_,
+                                                                             const K& key_) const
 {
     assert(bucket_index_ >= 0);
     assert(bucket_index_ < BaseType::buckets_num());
+    return find_in_chain(BaseType::buckets(bucket_index_), hash_, key_);
+}
+
+template <typename POLICY>
+template <typename K>
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::find_in_chain(IntType index_, HashType hash_,
+                                                                           const K& key_) const
+{
     auto&& equal = POLICY::is_equal();
-    for (IntType index = BaseType::buckets(bucket_index_); index != 0; index = BaseType::next(index - 1))
+    for (IntType index = index_; index != 0; index = BaseType::next(index - 1))
     {
-        if (equal(key_of_value(BaseType::value(index - 1)), value_))
+        // 有缓存哈希值的时候，大部分不相等的节点在这里就跳过了，不用访问value数组
+        if constexpr (BaseType::IS_CACHE_HASH)
+        {
+            if (BaseType::hash_tag(index - 1) != hash_)
+                continue;
+        }
+        if (equal(key_of_value(BaseType::value(index - 1)), key_))
             return index;
     }
     return 0;
 }
 
+template <typename POLICY>
+size_t MemHashTable<POLICY>::find_batch(const KeyType* keys_, size_t num_, IntType* indices_) const
+{
+    size_t found = 0;
+    HashType hashes[FIND_BATCH_GROUP];
+    IntType heads[FIND_BATCH_GROUP];
+    for (size_t start = 0; start < num_; start += FIND_BATCH_GROUP)
+    {
+        size_t group_num = std::min(FIND_BATCH_GROUP, num_ - start);
+        const KeyType* keys = keys_ + start;
+        // 第一轮只算哈希，预取桶头
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            hashes[i] = BaseType::hash_of(keys[i]);
+            heads[i] = BaseType::bucket_of_hash(hashes[i]);
+            prefetch_read(&BaseType::buckets(heads[i]));
+        }
+        // 第二轮读桶头，预取第一个节点的链和数据
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            heads[i] = BaseType::buckets(heads[i]);
+            if (heads[i] != 0)
+            {
+                prefetch_read(&BaseType::next(heads[i] - 1));
+                prefetch_read(&BaseType::value(heads[i] - 1));
+            }
+        }
+        // 第三轮走链，冲突不多的话这里大部分已经在缓存里面了
+        for (size_t i = 0; i < group_num; ++i)
+        {
+            indices_[start + i] = heads[i] == 0 ? 0 : find_in_chain(heads[i], hashes[i], keys[i]);
+            if (indices_[start + i] != 0)
+                ++found;
+        }
+    }
+    return found;
+}
+
+template <typename POLICY>
+size_t MemHashTable<POLICY>::find_batch(const KeyType* keys_, size_t num_, Iterator* iters_)
+{
+    size_t found = 0;
+    IntType indices[FIND_BATCH_GROUP];
+    for (size_t start = 0; start < num_; start += FIND_BATCH_GROUP)
+    {
+        size_t group_num = std::min(FIND_BATCH_GROUP, num_ - start);
+        found += find_batch(keys_ + start, group_num, indices);
+        for (size_t i = 0; i < group_num; ++i)
+            iters_[start + i] = Iterator(this, indices[i]);
+    }
+    return found;
+}
+
 template <typename POLICY>
 bool MemHashTable<POLICY>::exist(const KeyType& value_) const
 {
@@ -234,17 +471,25 @@ typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::erase(const Iterato
 {
     assert(it_.m_table == this);
     if (it_.m_index > 0)
-        return erase(BaseType::value(it_.m_index - 1));
+        return erase(key_of_value(BaseType::value(it_.m_index - 1)));
     return 0;
 }
 
 template <typename POLICY>
 typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::erase(const KeyType& value_)
 {
+    return erase_impl(BaseType::hash_of(value_), value_);
+}
+
+template <typename POLICY>
+template <typename K>
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::erase_impl(HashType hash_, const K& key_)
+{
+    auto guard = BaseType::journal_guard();
     if (BaseType::used() == 0)
         return 0;
 
-    IntType bucket_index = BaseType::get_bucket_index(value_);
+    IntType bucket_index = BaseType::bucket_of_hash(hash_);
     assert(bucket_index >= 0);
     assert(bucket_index < BaseType::buckets_num());
     if (BaseType::buckets(bucket_index) == 0)
@@ -255,12 +500,18 @@ typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::erase(const KeyType
     for (IntType index = BaseType::buckets(bucket_index); index != 0;
          pre = &(BaseType::next(index - 1)), index = BaseType::next(index - 1))
     {
-        if (equal(key_of_value(BaseType::value(index - 1)), value_))
+        if constexpr (BaseType::IS_CACHE_HASH)
+        {
+            if (BaseType::hash_tag(index - 1) != hash_)
+                continue;
+        }
+        if (equal(key_of_value(BaseType::value(index - 1)), key_))
         {
             assert(BaseType::used() > 0);
-            *pre = BaseType::next(index - 1);
-            BaseType::next(index - 1) = BaseType::free_index();
+            BaseType::journal_set(*pre, BaseType::next(index - 1));
+            BaseType::set_next(index - 1, BaseType::free_index());
             BaseType::set_free_index(index);
+            BaseType::reset_live(index - 1);
             BaseType::decr_used();
             return index;
         }
@@ -281,6 +532,214 @@ typename MemHashTable<POLICY>::ValueType& MemHashTable<POLICY>::deref(IntType in
     return BaseType::value(index_ - 1);
 }
 
+template <typename POLICY>
+template <typename ITER>
+size_t MemHashTable<POLICY>::build(ITER first_, ITER last_, bool check_unique_)
+{
+    size_t num = static_cast<size_t>(last_ - first_);
+    if (BaseType::used() != 0 || BaseType::raw_used() != 0)
+    {
+        size_t inserted = 0;
+        for (; first_ != last_; ++first_)
+            inserted += insert2(*first_).second ? 1 : 0;
+        return inserted;
+    }
+
+    // 先算出每个值的桶，再按桶做计数排序
+    size_t buckets_num = BaseType::buckets_num();
+    std::vector<HashType> hashes(num);
+    std::vector<size_t> bucket_start(buckets_num + 1, 0);
+    for (size_t i = 0; i < num; ++i)
+    {
+        hashes[i] = BaseType::hash_of(key_of_value(first_[i]));
+        ++bucket_start[BaseType::bucket_of_hash(hashes[i]) + 1];
+    }
+    for (size_t i = 0; i < buckets_num; ++i)
+        bucket_start[i + 1] += bucket_start[i];
+    std::vector<size_t> order(num);
+    {
+        std::vector<size_t> bucket_pos(bucket_start.begin(), bucket_start.end() - 1);
+        for (size_t i = 0; i < num; ++i)
+            order[bucket_pos[BaseType::bucket_of_hash(hashes[i])]++] = i;
+    }
+
+    // 按桶的顺序写，每个桶的节点是连续的，查重只要看这个桶已经写了的那一段
+    auto&& equal = POLICY::is_equal();
+    size_t max_num = BaseType::max_num();
+    size_t slot = 0;
+    for (size_t bucket = 0; bucket < buckets_num && slot < max_num; ++bucket)
+    {
+        size_t first_slot = slot;
+        for (size_t i = bucket_start[bucket]; i < bucket_start[bucket + 1] && slot < max_num; ++i)
+        {
+            const ValueType& value = first_[order[i]];
+            bool duplicate = false;
+            for (size_t j = first_slot; check_unique_ && !duplicate && j < slot; ++j)
+                duplicate = equal(key_of_value(BaseType::value(j)), key_of_value(value));
+            if (duplicate)
+                continue;
+
+            BaseType::copy_value(slot, value);
+            BaseType::next(slot) = 0;
+            BaseType::set_live(slot);
+            if constexpr (BaseType::IS_CACHE_HASH)
+                BaseType::hash_tag(slot) = hashes[order[i]];
+            if (slot > first_slot)
+                BaseType::next(slot - 1) = static_cast<IntType>(slot + 1);
+            ++slot;
+        }
+        if (slot > first_slot)
+            BaseType::buckets(bucket) = static_cast<IntType>(first_slot + 1);
+    }
+
+    BaseType::set_used(static_cast<IntType>(slot));
+    BaseType::set_raw_used(static_cast<IntType>(slot));
+    BaseType::set_free_index(0);
+    return slot;
+}
+
+template <typename POLICY>
+size_t MemHashTable<POLICY>::compact(bool sort_by_bucket_)
+{
+    size_t used = BaseType::used();
+    size_t raw_used = BaseType::raw_used();
+    size_t buckets_num = BaseType::buckets_num();
+
+    // order是新的槽位对应的旧槽位，remap是旧的下标对应的新下标，都是从1开始的下标
+    std::vector<IntType> order;
+    order.reserve(used);
+    std::vector<IntType> remap(raw_used + 1, 0);
+    // 没开位图的时候要走一遍桶链才知道哪些槽位在用，先在remap里面标出来
+    if (sort_by_bucket_ || !BaseType::IS_LIVE_BITMAP)
+    {
+        for (size_t bucket = 0; bucket < buckets_num; ++bucket)
+        {
+            for (IntType index = BaseType::buckets(bucket); index != 0; index = BaseType::next(index - 1))
+            {
+                if (sort_by_bucket_)
+                    order.push_back(index);
+                remap[index] = 1;
+            }
+        }
+    }
+    if (!sort_by_bucket_)
+    {
+        for (size_t index = 1; index <= raw_used; ++index)
+        {
+            bool live = false;
+            if constexpr (BaseType::IS_LIVE_BITMAP)
+                live = BaseType::is_live(index - 1);
+            else
+                live = remap[index] != 0;
+            if (live)
+                order.push_back(static_cast<IntType>(index));
+        }
+    }
+    assert(order.size() == used);
+
+    size_t moved = 0;
+    for (size_t i = 0; i < used; ++i)
+    {
+        remap[order[i]] = static_cast<IntType>(i + 1);
+        moved += order[i] != i + 1 ? 1 : 0;
+    }
+    if (moved == 0 && BaseType::raw_used() == used)
+        return 0;
+
+    // 先把节点和链拷出来，再按新的顺序写回去
+    std::vector<uint8_t> values(sizeof(ValueType) * used);
+    std::vector<IntType> nexts(used);
+    std::vector<HashType> hashes(BaseType::IS_CACHE_HASH ? used : 0);
+    for (size_t i = 0; i < used; ++i)
+    {
+        IntType old_slot = order[i] - 1;
+        memcpy(values.data() + sizeof(ValueType) * i, static_cast<const void*>(&BaseType::value(old_slot)),
+               sizeof(ValueType));
+        nexts[i] = remap[BaseType::next(old_slot)];
+        if constexpr (BaseType::IS_CACHE_HASH)
+            hashes[i] = BaseType::hash_tag(old_slot);
+    }
+    for (size_t i = 0; i < used; ++i)
+    {
+        memcpy(static_cast<void*>(&BaseType::value(i)), values.data() + sizeof(ValueType) * i, sizeof(ValueType));
+        BaseType::next(i) = nexts[i];
+        if constexpr (BaseType::IS_CACHE_HASH)
+            BaseType::hash_tag(i) = hashes[i];
+    }
+    for (size_t i = 0; i < used; ++i)
+        BaseType::set_live(i);
+    for (size_t i = used; i < raw_used; ++i)
+    {
+        BaseType::next(i) = 0;
+        BaseType::reset_live(i);
+    }
+    for (size_t bucket = 0; bucket < buckets_num; ++bucket)
+        BaseType::buckets(bucket) = remap[BaseType::buckets(bucket)];
+
+    BaseType::set_raw_used(static_cast<IntType>(used));
+    BaseType::set_free_index(0);
+    return moved;
+}
+
+template <typename POLICY>
+bool MemHashTable<POLICY>::recover()
+{
+    return BaseType::journal_recover();
+}
+
+template <typename POLICY>
+template <typename FUNC>
+void MemHashTable<POLICY>::for_each(FUNC&& func_)
+{
+    for_each_impl(*this, std::forward<FUNC>(func_));
+}
+
+template <typename POLICY>
+template <typename FUNC>
+void MemHashTable<POLICY>::for_each(FUNC&& func_) const
+{
+    for_each_impl(*this, std::forward<FUNC>(func_));
+}
+
+template <typename POLICY>
+template <typename TABLE, typename FUNC>
+void MemHashTable<POLICY>::for_each_impl(TABLE& table_, FUNC&& func_)
+{
+    if constexpr (BaseType::IS_LIVE_BITMAP)
+    {
+        // raw_used后面的位一定是0，按字扫，一次跳过64个空闲槽位
+        size_t words = live_words(table_.raw_used());
+        for (size_t word = 0; word < words; ++word)
+        {
+            for (uint64_t bits = table_.live_word(word); bits != 0; bits &= bits - 1)
+                func_(table_.value(word * LIVE_WORD_BITS + __builtin_ctzll(bits)));
+        }
+    }
+    else
+    {
+        // 没开位图分不出空闲槽位，按桶链走，省掉了迭代器每次++都要算的哈希
+        size_t buckets_num = table_.buckets_num();
+        for (size_t bucket = 0; bucket < buckets_num; ++bucket)
+        {
+            for (IntType index = table_.buckets(bucket); index != 0; index = table_.next(index - 1))
+                func_(table_.value(index - 1));
+        }
+    }
+}
+
+template <typename POLICY>
+size_t MemHashTable<POLICY>::bucket_count() const
+{
+    return BaseType::buckets_num();
+}
+
+template <typename POLICY>
+typename MemHashTable<POLICY>::IntType MemHashTable<POLICY>::bucket_first(size_t bucket_) const
+{
+    assert(bucket_ < BaseType::buckets_num());
+    return BaseType::buckets(bucket_);
+}
+
 template <typename POLICY>
 const typename MemHashTable<POLICY>::Iterator MemHashTable<POLICY>::begin() const
 {
@@ -359,8 +818,12 @@ typename MemHashTable<POLICY>::Iterator& MemHashTable<POLICY>::Iterator::operato
     IntType next_index = m_table->next(m_index - 1);
     if (next_index == 0)
     {
-        // 该链上的最后一个节点，找下一个hash
-        IntType next_bucket = m_table->get_bucket_index(m_table->key_of_value(m_table->value(m_index - 1))) + 1;
+        // 该链上的最后一个节点，找下一个hash，有缓存哈希值的时候不用重新算
+        IntType next_bucket = 0;
+        if constexpr (BaseType::IS_CACHE_HASH)
+            next_bucket = m_table->bucket_of_hash(m_table->hash_tag(m_index - 1)) + 1;
+        else
+            next_bucket = m_table->get_bucket_index(m_table->key_of_value(m_table->value(m_index - 1))) + 1;
         IntType max_bucket_num = m_table->buckets_num();
         while (next_bucket < max_bucket_num)
         {
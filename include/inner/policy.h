@@ -34,6 +34,8 @@ struct Policy : private EBOProxy<HASH>, private EBOProxy<IS_EQUAL>
 {
     using Hasher = EBOProxy<HASH>;
     using IsEqual = EBOProxy<IS_EQUAL>;
+    /// 两个都是透明的才能用别的类型的key查找，只有一个透明的话哈希值和比较可能对不上
+    static constexpr bool IS_TRANSPARENT = IsTransparent<HASH>::value && IsTransparent<IS_EQUAL>::value;
 
     HASH& hash() { return *static_cast<Hasher&>(*this); }
     const HASH& hash() const { return *static_cast<const Hasher&>(*this); }
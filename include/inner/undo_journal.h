@@ -0,0 +1,168 @@
+/*
+ * * file name: undo_journal.h
+ * * description: 共享内存容器的撤销日志，一次修改里面每改一个下标之前先把旧值记下来
+ * *              进程在修改中间挂掉的话，下次挂上来的时候按相反的顺序写回旧值，容器回到修改之前的样子
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _UNDO_JOURNAL_H_
+#define _UNDO_JOURNAL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+namespace pepper
+{
+namespace inner
+{
+/// 只防进程被杀，不防掉电，被杀的进程已经执行了的写都会留在共享内存里面，只要保证编译器不乱序就行
+/// 记的是相对日志自己的偏移，日志和被改的字段在同一块内存里面，整块搬走还是对的
+/// 共享内存里面只有日志本身，正在改哪个日志是线程自己记的，进程挂了不会留下"还在修改中"的状态
+struct UndoJournal
+{
+    /// 一次修改最多记这么多个字段，LRU的插入最多改9个
+    static constexpr size_t MAX_ENTRY_NUM = 16;
+
+    struct Entry
+    {
+        int64_t offset;
+        uint64_t size;
+        uint64_t old_value;
+    };
+
+    class Guard;
+
+    /// 不在Guard的范围里面的话直接写，clear、build这种批量的操作不走日志
+    template <typename T, typename V>
+    void set(T& field_, V value_)
+    {
+        if (s_open == this)
+        {
+            static_assert(sizeof(T) <= sizeof(uint64_t), "UndoJournal can only record fields up to 8 bytes");
+            if (m_num >= MAX_ENTRY_NUM)
+            {
+                // 记不下了接着改的话挂了就恢复不了，release版本也不能带着坏掉的日志跑下去
+                fprintf(stderr, "UndoJournal overflow, more than %zu fields in one modification\n", MAX_ENTRY_NUM);
+                std::abort();
+            }
+            Entry& entry = m_entries[m_num];
+            entry.offset = reinterpret_cast<intptr_t>(&field_) - reinterpret_cast<intptr_t>(this);
+            entry.size = sizeof(T);
+            memcpy(&entry.old_value, &field_, sizeof(T));
+            // 旧值写好了才算一条，这一条算上了才能改字段
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            ++m_num;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+        field_ = static_cast<T>(value_);
+    }
+
+    /// 有没做完的修改就撤销掉，返回true表示撤销了，这个线程自己正在改的时候日志是有效的，什么都不做
+    bool recover()
+    {
+        if (s_open == this)
+            return false;
+        bool undone = m_num > 0;
+        rollback(0);
+        return undone;
+    }
+
+    uint64_t m_num = 0;
+    Entry m_entries[MAX_ENTRY_NUM] = {};
+
+private:
+    /// 按相反的顺序写回旧值，只留下前num_条，写到一半挂了下次从头再撤销一遍结果也一样
+    void rollback(uint64_t num_)
+    {
+        for (uint64_t i = m_num; i > num_; --i)
+        {
+            const Entry& entry = m_entries[i - 1];
+            memcpy(reinterpret_cast<uint8_t*>(this) + entry.offset, &entry.old_value, entry.size);
+        }
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        m_num = num_;
+    }
+
+    /// 这个线程正在改的日志，没有在改是nullptr
+    static inline thread_local UndoJournal* s_open = nullptr;
+};
+
+/// 一次修改的范围，构造的时候开始，析构的时候提交，中间抛了异常先把这一层记的字段撤销掉
+/// 可以嵌套，只有最外面一层真的开始和提交，比如LRU的插入里面套了哈希表的插入
+class UndoJournal::Guard
+{
+public:
+    explicit Guard(UndoJournal& journal_)
+        : m_journal(journal_), m_prev(s_open), m_num(journal_.m_num), m_exceptions(std::uncaught_exceptions())
+    {
+        if (m_prev != &m_journal)
+        {
+            // 最外面一层日志还没清掉，说明上次改的进程改到一半挂了，先撤销掉再改
+            m_journal.recover();
+            m_num = 0;
+            s_open = &m_journal;
+        }
+    }
+    ~Guard()
+    {
+        if (std::uncaught_exceptions() > m_exceptions)
+            m_journal.rollback(m_num);
+        if (m_prev != &m_journal)
+        {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            m_journal.m_num = 0;
+            s_open = m_prev;
+        }
+    }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+private:
+    UndoJournal& m_journal;
+    UndoJournal* m_prev;
+    uint64_t m_num;
+    int m_exceptions;
+};
+
+/// 容器的头部继承这个，JOURNAL == false 的时候是空的，不占内存，写字段就是直接写
+template <bool JOURNAL>
+struct JournalHolder
+{
+    /// 什么都不做，析构函数只是为了不报变量没用的警告
+    struct Guard
+    {
+        ~Guard() {}
+    };
+    Guard journal_guard() { return Guard(); }
+    template <typename T, typename V>
+    void journal_set(T& field_, V value_)
+    {
+        field_ = static_cast<T>(value_);
+    }
+    bool journal_recover() { return false; }
+};
+
+template <>
+struct JournalHolder<true>
+{
+    using Guard = UndoJournal::Guard;
+    Guard journal_guard() { return Guard(m_journal); }
+    template <typename T, typename V>
+    void journal_set(T& field_, V value_)
+    {
+        m_journal.set(field_, value_);
+    }
+    bool journal_recover() { return m_journal.recover(); }
+
+    UndoJournal m_journal;
+};
+
+}  // namespace inner
+}  // namespace pepper
+
+#endif
@@ -14,11 +14,14 @@
 
 namespace pepper
 {
-template <typename KEY, typename VALUE, size_t MAX_SIZE = 0>
-class MemLRUMap : public inner::BaseMemLRUMap<inner::LRUPolicy<KEY, VALUE, MAX_SIZE>>
+/// JOURNAL == true 的时候带撤销日志，insert、erase、active的时候进程挂了，下次挂上来能恢复到修改之前
+template <typename KEY, typename VALUE, size_t MAX_SIZE = 0, bool JOURNAL = false>
+class MemLRUMap
+    : public inner::BaseMemLRUMap<inner::LRUPolicy<KEY, VALUE, MAX_SIZE, std::hash<KEY>, IsEqual<KEY>, JOURNAL>>
 {
 public:
-    using BaseType = inner::BaseMemLRUMap<inner::LRUPolicy<KEY, VALUE, MAX_SIZE>>;
+    using BaseType =
+        inner::BaseMemLRUMap<inner::LRUPolicy<KEY, VALUE, MAX_SIZE, std::hash<KEY>, IsEqual<KEY>, JOURNAL>>;
     using Iterator = typename BaseType::Iterator;
     using DisuseCallback = typename BaseType::DisuseCallback;
     using BaseType::insert;
@@ -29,6 +32,13 @@ public:
     {
         return BaseType::insert({key_, value_}, force_, call_back_);
     }
+
+    /// hash_必须是key_hash(key_)的结果
+    std::pair<Iterator, bool> insert_hashed(const KEY& key_, const VALUE& value_, size_t hash_, bool force_ = false,
+                                            const DisuseCallback& call_back_ = nullptr)
+    {
+        return BaseType::insert_hashed({key_, value_}, hash_, force_, call_back_);
+    }
 };
 
 }  // namespace pepper
@@ -14,8 +14,9 @@
 
 namespace pepper
 {
-template <typename T, size_t MAX_SIZE = 0>
-using MemLRUSet = inner::BaseMemLRUMap<inner::LRUPolicy<T, void, MAX_SIZE>>;
+/// JOURNAL == true 的时候带撤销日志，见MemLRUMap
+template <typename T, size_t MAX_SIZE = 0, bool JOURNAL = false>
+using MemLRUSet = inner::BaseMemLRUMap<inner::LRUPolicy<T, void, MAX_SIZE, std::hash<T>, IsEqual<T>, JOURNAL>>;
 
 }  // namespace pepper
 
@@ -9,6 +9,7 @@
 #define _MEM_MAP_H_
 
 #include "inner/base_specialization.h"
+#include "inner/flat_hash_table.h"
 #include "inner/hash_table_policy.h"
 #include "inner/mem_hash_table.h"
 
@@ -17,11 +18,31 @@ namespace pepper
 template <typename KEY, typename VALUE, size_t MAX_SIZE>
 using BaseMemMap = inner::MemHashTable<inner::HashTablePolicy<KEY, VALUE, MAX_SIZE>>;
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE = 0>
-class MemMap : private BaseMemMap<KEY, VALUE, MAX_SIZE>
+/// 开放寻址的版本，数据直接放在槽位里面
+template <typename KEY, typename VALUE, size_t MAX_SIZE>
+using BaseFlatMemMap = inner::FlatHashTable<inner::FlatHashTablePolicy<KEY, VALUE, MAX_SIZE>>;
+
+/// 每个节点在next旁边缓存一份哈希值，key比较贵的时候用
+template <typename KEY, typename VALUE, size_t MAX_SIZE>
+using BaseHashCachedMemMap =
+    inner::MemHashTable<inner::HashTablePolicy<KEY, VALUE, MAX_SIZE, std::hash<KEY>, IsEqual<KEY>, true>>;
+
+/// 带撤销日志，插入删除的时候进程挂了，下次挂上来能恢复到修改之前，每次修改多几次写
+template <typename KEY, typename VALUE, size_t MAX_SIZE>
+using BaseJournaledMemMap = inner::MemHashTable<
+    inner::HashTablePolicy<KEY, VALUE, MAX_SIZE, std::hash<KEY>, IsEqual<KEY>, false, inner::ModBucket, true>>;
+
+/// 多一个槽位在用的位图，for_each和compact直接扫位图，经常整表遍历的时候用，每个节点多一位
+template <typename KEY, typename VALUE, size_t MAX_SIZE>
+using BaseLiveBitmapMemMap = inner::MemHashTable<
+    inner::HashTablePolicy<KEY, VALUE, MAX_SIZE, std::hash<KEY>, IsEqual<KEY>, false, inner::ModBucket, false, true>>;
+
+/// TABLE 是底层的哈希表，默认是拉链法的MemHashTable，也可以用FlatHashTable
+template <typename KEY, typename VALUE, size_t MAX_SIZE = 0, typename TABLE = BaseMemMap<KEY, VALUE, MAX_SIZE>>
+class MemMap : private TABLE
 {
 public:
-    using BaseType = BaseMemMap<KEY, VALUE, MAX_SIZE>;
+    using BaseType = TABLE;
     using IntType = typename BaseType::IntType;
     using NodeType = typename BaseType::ValueType;
     using Iterator = typename BaseType::Iterator;
@@ -50,6 +71,44 @@ public:
     void erase(const Iterator& it_);
     /// 删除一个，根据值
     void erase(const KEY& key_);
+
+    /// 用别的类型的key查找和删除，底层的HASH和IS_EQUAL都要声明is_transparent
+    template <typename K, typename = typename BaseType::template TransparentKey<K>>
+    const Iterator find(const K& key_) const;
+    template <typename K, typename = typename BaseType::template TransparentKey<K>>
+    Iterator find(const K& key_);
+    template <typename K, typename = typename BaseType::template TransparentKey<K>>
+    bool exist(const K& key_) const;
+    template <typename K, typename = typename BaseType::template TransparentKey<K>>
+    void erase(const K& key_);
+    /// 算key的哈希值，先查再插或者跨多个容器查的时候留着给*_hashed接口用，不用重复算
+    template <typename K>
+    size_t key_hash(const K& key_) const;
+    template <typename K>
+    const Iterator find_hashed(const K& key_, size_t hash_) const;
+    template <typename K>
+    Iterator find_hashed(const K& key_, size_t hash_);
+    std::pair<Iterator, bool> insert_hashed(const KEY& key_, const VALUE& value_, size_t hash_);
+    template <typename K>
+    void erase_hashed(const K& key_, size_t hash_);
+    /// 批量导入，[first_, last_)是随机访问迭代器，元素是NodeType，返回实际插入的个数
+    /// 空表的时候按桶排好序顺序写，比一个一个插入快很多，check_unique_ == false 的时候调用者保证key不重复
+    template <typename ITER>
+    size_t build(ITER first_, ITER last_, bool check_unique_ = true);
+    /// 整理碎片，在用的节点搬到内存的前面，sort_by_bucket_ == true 的时候按桶排序，之前的迭代器都失效了
+    size_t compact(bool sort_by_bucket_ = false);
+    /// TABLE是BaseJournaledMemMap的时候才能用，撤销上次没做完的插入或者删除，返回true表示撤销了
+    /// 动态大小的init(..., check_ = true)里面已经调过了，固定大小的挂上来之后自己调
+    /// 没调的话下一次插入或者删除开始之前也会先撤销，但是在那之前读到的可能是改了一半的表
+    bool recover();
+    /// 不保证顺序的快速遍历，func_(NodeType&)，不算哈希，比迭代器快，遍历过程中不能插入和删除
+    /// LiveBitmapMemMap直接顺序扫节点数组，别的沿着桶链走
+    template <typename FUNC>
+    void for_each(FUNC&& func_);
+    template <typename FUNC>
+    void for_each(FUNC&& func_) const;
+    /// 批量查找，iters_[i]是keys_[i]的结果，找不到是end()，返回找到的个数，key多的时候比一个一个找快
+    size_t find_batch(const KEY* keys_, size_t num_, Iterator* iters_);
     /// 迭代器
     const Iterator begin() const;
     const Iterator end() const;
@@ -57,97 +116,215 @@ public:
     Iterator end();
 };
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-void MemMap<KEY, VALUE, MAX_SIZE>::clear()
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+void MemMap<KEY, VALUE, MAX_SIZE, TABLE>::clear()
 {
     return BaseType::clear();
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-bool MemMap<KEY, VALUE, MAX_SIZE>::empty() const
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+bool MemMap<KEY, VALUE, MAX_SIZE, TABLE>::empty() const
 {
     return BaseType::empty();
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-bool MemMap<KEY, VALUE, MAX_SIZE>::full() const
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+bool MemMap<KEY, VALUE, MAX_SIZE, TABLE>::full() const
 {
     return BaseType::full();
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-size_t MemMap<KEY, VALUE, MAX_SIZE>::size() const
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+size_t MemMap<KEY, VALUE, MAX_SIZE, TABLE>::size() const
 {
     return BaseType::size();
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-size_t MemMap<KEY, VALUE, MAX_SIZE>::capacity() const
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+size_t MemMap<KEY, VALUE, MAX_SIZE, TABLE>::capacity() const
 {
     return BaseType::capacity();
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-std::pair<typename MemMap<KEY, VALUE, MAX_SIZE>::Iterator, bool> MemMap<KEY, VALUE, MAX_SIZE>::insert(
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+std::pair<typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator, bool> MemMap<KEY, VALUE, MAX_SIZE, TABLE>::insert(
     const KEY& key_, const VALUE& value_)
 {
     return BaseType::insert({key_, value_});
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-const typename MemMap<KEY, VALUE, MAX_SIZE>::Iterator MemMap<KEY, VALUE, MAX_SIZE>::find(const KEY& key_) const
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+const typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::find(
+    const KEY& key_) const
 {
     return BaseType::find(key_);
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-typename MemMap<KEY, VALUE, MAX_SIZE>::Iterator MemMap<KEY, VALUE, MAX_SIZE>::find(const KEY& key_)
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::find(const KEY& key_)
 {
     return BaseType::find(key_);
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-bool MemMap<KEY, VALUE, MAX_SIZE>::exist(const KEY& key_) const
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+bool MemMap<KEY, VALUE, MAX_SIZE, TABLE>::exist(const KEY& key_) const
 {
     return BaseType::exist(key_);
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-void MemMap<KEY, VALUE, MAX_SIZE>::erase(const Iterator& it_)
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+void MemMap<KEY, VALUE, MAX_SIZE, TABLE>::erase(const Iterator& it_)
 {
     BaseType::erase(it_);
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-void MemMap<KEY, VALUE, MAX_SIZE>::erase(const KEY& key_)
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+void MemMap<KEY, VALUE, MAX_SIZE, TABLE>::erase(const KEY& key_)
 {
     BaseType::erase(key_);
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-const typename MemMap<KEY, VALUE, MAX_SIZE>::Iterator MemMap<KEY, VALUE, MAX_SIZE>::begin() const
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename ITER>
+size_t MemMap<KEY, VALUE, MAX_SIZE, TABLE>::build(ITER first_, ITER last_, bool check_unique_)
+{
+    return BaseType::build(first_, last_, check_unique_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+size_t MemMap<KEY, VALUE, MAX_SIZE, TABLE>::compact(bool sort_by_bucket_)
+{
+    return BaseType::compact(sort_by_bucket_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+bool MemMap<KEY, VALUE, MAX_SIZE, TABLE>::recover()
+{
+    return BaseType::recover();
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename FUNC>
+void MemMap<KEY, VALUE, MAX_SIZE, TABLE>::for_each(FUNC&& func_)
+{
+    BaseType::for_each(std::forward<FUNC>(func_));
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename FUNC>
+void MemMap<KEY, VALUE, MAX_SIZE, TABLE>::for_each(FUNC&& func_) const
+{
+    BaseType::for_each(std::forward<FUNC>(func_));
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+size_t MemMap<KEY, VALUE, MAX_SIZE, TABLE>::find_batch(const KEY* keys_, size_t num_, Iterator* iters_)
+{
+    return BaseType::find_batch(keys_, num_, iters_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+const typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::begin() const
 {
     return BaseType::begin();
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-const typename MemMap<KEY, VALUE, MAX_SIZE>::Iterator MemMap<KEY, VALUE, MAX_SIZE>::end() const
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+const typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::end() const
 {
     return BaseType::end();
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-typename MemMap<KEY, VALUE, MAX_SIZE>::Iterator MemMap<KEY, VALUE, MAX_SIZE>::begin()
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::begin()
 {
     return BaseType::begin();
 }
 
-template <typename KEY, typename VALUE, size_t MAX_SIZE>
-typename MemMap<KEY, VALUE, MAX_SIZE>::Iterator MemMap<KEY, VALUE, MAX_SIZE>::end()
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::end()
 {
     return BaseType::end();
 }
 
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+std::pair<typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator, bool>
+MemMap<KEY, VALUE, MAX_SIZE, TABLE>::insert_hashed(const KEY& key_, const VALUE& value_, size_t hash_)
+{
+    return BaseType::insert_hashed({key_, value_}, hash_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename K, typename>
+const typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::find(
+    const K& key_) const
+{
+    return BaseType::find(key_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename K, typename>
+typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::find(const K& key_)
+{
+    return BaseType::find(key_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename K, typename>
+bool MemMap<KEY, VALUE, MAX_SIZE, TABLE>::exist(const K& key_) const
+{
+    return BaseType::exist(key_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename K, typename>
+void MemMap<KEY, VALUE, MAX_SIZE, TABLE>::erase(const K& key_)
+{
+    BaseType::erase(key_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename K>
+size_t MemMap<KEY, VALUE, MAX_SIZE, TABLE>::key_hash(const K& key_) const
+{
+    return BaseType::key_hash(key_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename K>
+const typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator
+MemMap<KEY, VALUE, MAX_SIZE, TABLE>::find_hashed(const K& key_, size_t hash_) const
+{
+    return BaseType::find_hashed(key_, hash_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename K>
+typename MemMap<KEY, VALUE, MAX_SIZE, TABLE>::Iterator MemMap<KEY, VALUE, MAX_SIZE, TABLE>::find_hashed(
+    const K& key_, size_t hash_)
+{
+    return BaseType::find_hashed(key_, hash_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE, typename TABLE>
+template <typename K>
+void MemMap<KEY, VALUE, MAX_SIZE, TABLE>::erase_hashed(const K& key_, size_t hash_)
+{
+    BaseType::erase_hashed(key_, hash_);
+}
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE = 0>
+using FlatMemMap = MemMap<KEY, VALUE, MAX_SIZE, BaseFlatMemMap<KEY, VALUE, MAX_SIZE>>;
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE = 0>
+using HashCachedMemMap = MemMap<KEY, VALUE, MAX_SIZE, BaseHashCachedMemMap<KEY, VALUE, MAX_SIZE>>;
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE = 0>
+using JournaledMemMap = MemMap<KEY, VALUE, MAX_SIZE, BaseJournaledMemMap<KEY, VALUE, MAX_SIZE>>;
+
+template <typename KEY, typename VALUE, size_t MAX_SIZE = 0>
+using LiveBitmapMemMap = MemMap<KEY, VALUE, MAX_SIZE, BaseLiveBitmapMemMap<KEY, VALUE, MAX_SIZE>>;
+
 }  // namespace pepper
 
 #endif
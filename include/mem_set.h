@@ -9,6 +9,7 @@
 #define _MEM_SET_H_
 
 #include "inner/base_specialization.h"
+#include "inner/flat_hash_table.h"
 #include "inner/hash_table_policy.h"
 #include "inner/mem_hash_table.h"
 
@@ -17,11 +18,31 @@ namespace pepper
 template <typename T, size_t MAX_SIZE>
 using BaseMemSet = inner::MemHashTable<inner::HashTablePolicy<T, void, MAX_SIZE>>;
 
-template <typename T, size_t MAX_SIZE = 0>
-class MemSet : private BaseMemSet<T, MAX_SIZE>
+/// 开放寻址的版本，数据直接放在槽位里面
+template <typename T, size_t MAX_SIZE>
+using BaseFlatMemSet = inner::FlatHashTable<inner::FlatHashTablePolicy<T, void, MAX_SIZE>>;
+
+/// 每个节点在next旁边缓存一份哈希值，key比较贵的时候用
+template <typename T, size_t MAX_SIZE>
+using BaseHashCachedMemSet =
+    inner::MemHashTable<inner::HashTablePolicy<T, void, MAX_SIZE, std::hash<T>, IsEqual<T>, true>>;
+
+/// 带撤销日志，插入删除的时候进程挂了，下次挂上来能恢复到修改之前
+template <typename T, size_t MAX_SIZE>
+using BaseJournaledMemSet = inner::MemHashTable<
+    inner::HashTablePolicy<T, void, MAX_SIZE, std::hash<T>, IsEqual<T>, false, inner::ModBucket, true>>;
+
+/// 多一个槽位在用的位图，for_each和compact直接扫位图
+template <typename T, size_t MAX_SIZE>
+using BaseLiveBitmapMemSet = inner::MemHashTable<
+    inner::HashTablePolicy<T, void, MAX_SIZE, std::hash<T>, IsEqual<T>, false, inner::ModBucket, false, true>>;
+
+/// TABLE 是底层的哈希表，默认是拉链法的MemHashTable，也可以用FlatHashTable
+template <typename T, size_t MAX_SIZE = 0, typename TABLE = BaseMemSet<T, MAX_SIZE>>
+class MemSet : private TABLE
 {
 public:
-    using BaseType = BaseMemSet<T, MAX_SIZE>;
+    using BaseType = TABLE;
     using IntType = typename BaseType::IntType;
     using NodeType = typename BaseType::ValueType;
     using Iterator = typename BaseType::Iterator;
@@ -50,6 +71,40 @@ public:
     void erase(const Iterator& it_);
     /// 删除一个，根据值
     void erase(const T& value_);
+
+    /// 用别的类型的key查找和删除，底层的HASH和IS_EQUAL都要声明is_transparent
+    template <typename K, typename = typename BaseType::template TransparentKey<K>>
+    const Iterator find(const K& key_) const;
+    template <typename K, typename = typename BaseType::template TransparentKey<K>>
+    Iterator find(const K& key_);
+    template <typename K, typename = typename BaseType::template TransparentKey<K>>
+    bool exist(const K& key_) const;
+    template <typename K, typename = typename BaseType::template TransparentKey<K>>
+    void erase(const K& key_);
+    /// 算key的哈希值，先查再插或者跨多个容器查的时候留着给*_hashed接口用，不用重复算
+    template <typename K>
+    size_t key_hash(const K& key_) const;
+    template <typename K>
+    const Iterator find_hashed(const K& key_, size_t hash_) const;
+    template <typename K>
+    Iterator find_hashed(const K& key_, size_t hash_);
+    std::pair<Iterator, bool> insert_hashed(const T& value_, size_t hash_);
+    template <typename K>
+    void erase_hashed(const K& key_, size_t hash_);
+    /// 批量导入，[first_, last_)是随机访问迭代器，返回实际插入的个数
+    /// 空表的时候按桶排好序顺序写，比一个一个插入快很多，check_unique_ == false 的时候调用者保证没有重复
+    template <typename ITER>
+    size_t build(ITER first_, ITER last_, bool check_unique_ = true);
+    /// 整理碎片，在用的节点搬到内存的前面，sort_by_bucket_ == true 的时候按桶排序，之前的迭代器都失效了
+    size_t compact(bool sort_by_bucket_ = false);
+    /// TABLE是BaseJournaledMemSet的时候才能用，撤销上次没做完的插入或者删除，返回true表示撤销了
+    bool recover();
+    /// 不保证顺序的快速遍历，func_(const T&)，不算哈希，比迭代器快，遍历过程中不能插入和删除
+    /// LiveBitmapMemSet直接顺序扫节点数组，别的沿着桶链走
+    template <typename FUNC>
+    void for_each(FUNC&& func_) const;
+    /// 批量查找，iters_[i]是values_[i]的结果，找不到是end()，返回找到的个数，key多的时候比一个一个找快
+    size_t find_batch(const T* values_, size_t num_, Iterator* iters_);
     /// 迭代器
     const Iterator begin() const;
     const Iterator end() const;
@@ -57,96 +112,204 @@ public:
     Iterator end();
 };
 
-template <typename T, size_t MAX_SIZE>
-void MemSet<T, MAX_SIZE>::clear()
+template <typename T, size_t MAX_SIZE, typename TABLE>
+void MemSet<T, MAX_SIZE, TABLE>::clear()
 {
     BaseType::clear();
 }
 
-template <typename T, size_t MAX_SIZE>
-bool MemSet<T, MAX_SIZE>::empty() const
+template <typename T, size_t MAX_SIZE, typename TABLE>
+bool MemSet<T, MAX_SIZE, TABLE>::empty() const
 {
     return BaseType::empty();
 }
 
-template <typename T, size_t MAX_SIZE>
-bool MemSet<T, MAX_SIZE>::full() const
+template <typename T, size_t MAX_SIZE, typename TABLE>
+bool MemSet<T, MAX_SIZE, TABLE>::full() const
 {
     return BaseType::full();
 }
 
-template <typename T, size_t MAX_SIZE>
-size_t MemSet<T, MAX_SIZE>::size() const
+template <typename T, size_t MAX_SIZE, typename TABLE>
+size_t MemSet<T, MAX_SIZE, TABLE>::size() const
 {
     return BaseType::size();
 }
 
-template <typename T, size_t MAX_SIZE>
-size_t MemSet<T, MAX_SIZE>::capacity() const
+template <typename T, size_t MAX_SIZE, typename TABLE>
+size_t MemSet<T, MAX_SIZE, TABLE>::capacity() const
 {
     return BaseType::capacity();
 }
 
-template <typename T, size_t MAX_SIZE>
-std::pair<typename MemSet<T, MAX_SIZE>::Iterator, bool> MemSet<T, MAX_SIZE>::insert(const T& value_)
+template <typename T, size_t MAX_SIZE, typename TABLE>
+std::pair<typename MemSet<T, MAX_SIZE, TABLE>::Iterator, bool> MemSet<T, MAX_SIZE, TABLE>::insert(const T& value_)
 {
     return BaseType::insert(value_);
 }
 
-template <typename T, size_t MAX_SIZE>
-const typename MemSet<T, MAX_SIZE>::Iterator MemSet<T, MAX_SIZE>::find(const T& value_) const
+template <typename T, size_t MAX_SIZE, typename TABLE>
+const typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::find(const T& value_) const
 {
     return BaseType::find(value_);
 }
 
-template <typename T, size_t MAX_SIZE>
-typename MemSet<T, MAX_SIZE>::Iterator MemSet<T, MAX_SIZE>::find(const T& value_)
+template <typename T, size_t MAX_SIZE, typename TABLE>
+typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::find(const T& value_)
 {
     return BaseType::find(value_);
 }
 
-template <typename T, size_t MAX_SIZE>
-bool MemSet<T, MAX_SIZE>::exist(const T& value_) const
+template <typename T, size_t MAX_SIZE, typename TABLE>
+bool MemSet<T, MAX_SIZE, TABLE>::exist(const T& value_) const
 {
     return BaseType::exist(value_);
 }
 
-template <typename T, size_t MAX_SIZE>
-void MemSet<T, MAX_SIZE>::erase(const Iterator& it_)
+template <typename T, size_t MAX_SIZE, typename TABLE>
+void MemSet<T, MAX_SIZE, TABLE>::erase(const Iterator& it_)
 {
     BaseType::erase(it_);
 }
 
-template <typename T, size_t MAX_SIZE>
-void MemSet<T, MAX_SIZE>::erase(const T& value_)
+template <typename T, size_t MAX_SIZE, typename TABLE>
+void MemSet<T, MAX_SIZE, TABLE>::erase(const T& value_)
 {
     BaseType::erase(value_);
 }
 
-template <typename T, size_t MAX_SIZE>
-const typename MemSet<T, MAX_SIZE>::Iterator MemSet<T, MAX_SIZE>::begin() const
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename ITER>
+size_t MemSet<T, MAX_SIZE, TABLE>::build(ITER first_, ITER last_, bool check_unique_)
+{
+    return BaseType::build(first_, last_, check_unique_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+size_t MemSet<T, MAX_SIZE, TABLE>::compact(bool sort_by_bucket_)
+{
+    return BaseType::compact(sort_by_bucket_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+bool MemSet<T, MAX_SIZE, TABLE>::recover()
+{
+    return BaseType::recover();
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename FUNC>
+void MemSet<T, MAX_SIZE, TABLE>::for_each(FUNC&& func_) const
+{
+    BaseType::for_each(std::forward<FUNC>(func_));
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+size_t MemSet<T, MAX_SIZE, TABLE>::find_batch(const T* values_, size_t num_, Iterator* iters_)
+{
+    return BaseType::find_batch(values_, num_, iters_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+const typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::begin() const
 {
     return BaseType::begin();
 }
 
-template <typename T, size_t MAX_SIZE>
-typename MemSet<T, MAX_SIZE>::Iterator MemSet<T, MAX_SIZE>::begin()
+template <typename T, size_t MAX_SIZE, typename TABLE>
+typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::begin()
 {
     return BaseType::begin();
 }
 
-template <typename T, size_t MAX_SIZE>
-const typename MemSet<T, MAX_SIZE>::Iterator MemSet<T, MAX_SIZE>::end() const
+template <typename T, size_t MAX_SIZE, typename TABLE>
+const typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::end() const
 {
     return BaseType::end();
 }
 
-template <typename T, size_t MAX_SIZE>
-typename MemSet<T, MAX_SIZE>::Iterator MemSet<T, MAX_SIZE>::end()
+template <typename T, size_t MAX_SIZE, typename TABLE>
+typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::end()
 {
     return BaseType::end();
 }
 
+template <typename T, size_t MAX_SIZE, typename TABLE>
+std::pair<typename MemSet<T, MAX_SIZE, TABLE>::Iterator, bool> MemSet<T, MAX_SIZE, TABLE>::insert_hashed(
+    const T& value_, size_t hash_)
+{
+    return BaseType::insert_hashed(value_, hash_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename K, typename>
+const typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::find(const K& key_) const
+{
+    return BaseType::find(key_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename K, typename>
+typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::find(const K& key_)
+{
+    return BaseType::find(key_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename K, typename>
+bool MemSet<T, MAX_SIZE, TABLE>::exist(const K& key_) const
+{
+    return BaseType::exist(key_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename K, typename>
+void MemSet<T, MAX_SIZE, TABLE>::erase(const K& key_)
+{
+    BaseType::erase(key_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename K>
+size_t MemSet<T, MAX_SIZE, TABLE>::key_hash(const K& key_) const
+{
+    return BaseType::key_hash(key_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename K>
+const typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::find_hashed(
+    const K& key_, size_t hash_) const
+{
+    return BaseType::find_hashed(key_, hash_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename K>
+typename MemSet<T, MAX_SIZE, TABLE>::Iterator MemSet<T, MAX_SIZE, TABLE>::find_hashed(const K& key_, size_t hash_)
+{
+    return BaseType::find_hashed(key_, hash_);
+}
+
+template <typename T, size_t MAX_SIZE, typename TABLE>
+template <typename K>
+void MemSet<T, MAX_SIZE, TABLE>::erase_hashed(const K& key_, size_t hash_)
+{
+    BaseType::erase_hashed(key_, hash_);
+}
+
+template <typename T, size_t MAX_SIZE = 0>
+using FlatMemSet = MemSet<T, MAX_SIZE, BaseFlatMemSet<T, MAX_SIZE>>;
+
+template <typename T, size_t MAX_SIZE = 0>
+using HashCachedMemSet = MemSet<T, MAX_SIZE, BaseHashCachedMemSet<T, MAX_SIZE>>;
+
+template <typename T, size_t MAX_SIZE = 0>
+using JournaledMemSet = MemSet<T, MAX_SIZE, BaseJournaledMemSet<T, MAX_SIZE>>;
+
+template <typename T, size_t MAX_SIZE = 0>
+using LiveBitmapMemSet = MemSet<T, MAX_SIZE, BaseLiveBitmapMemSet<T, MAX_SIZE>>;
+
 }  // namespace pepper
 
 #endif
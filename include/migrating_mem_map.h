@@ -0,0 +1,197 @@
+/*
+ * * file name: migrating_mem_map.h
+ * * description: 共享内存哈希表在线扩容，同时挂上旧的和新的两块内存，每次操作顺带搬几个桶
+ * *              搬完之前查找两边都要看，插入只进新表，旧表搬空了就可以直接用新表了
+ * *              搬的进度不用存在共享内存里面，已经搬过的桶在旧表里面一定是空的，重新挂上来从头跳过空桶就行
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _MIGRATING_MEM_MAP_H_
+#define _MIGRATING_MEM_MAP_H_
+
+#include "inner/base_specialization.h"
+#include "inner/hash_table_policy.h"
+#include "inner/mem_hash_table.h"
+
+namespace pepper
+{
+/// 布局和MemMap<KEY, VALUE>一样，搬完之后新的那块内存可以直接用MemMap挂上去
+/// 不带锁，多进程用的时候和MemMap一样要调用者自己保证同一时间只有一个写者
+/// 只有insert、erase、step会搬桶，find和exist是只读的，读进程可以和写者同时调用
+template <typename KEY, typename VALUE, typename HASH = std::hash<KEY>, typename IS_EQUAL = IsEqual<KEY>>
+class MigratingMemMap
+{
+    using TableType = inner::MemHashTable<inner::HashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL>>;
+    using IntType = typename TableType::IntType;
+
+public:
+    using NodeType = typename TableType::ValueType;
+
+    /// 新表需要的内存大小
+    static size_t need_mem_size(size_t max_num_, size_t buckets_num_);
+    /// 旧表总是check_ == true挂上去，新表第一个进程check_ == false初始化，其他进程check_ == true挂上去
+    /// 新表的容量要放得下旧表现有的数据
+    bool init(void* old_mem_, size_t old_mem_size_, size_t old_max_num_, size_t old_buckets_num_, void* new_mem_,
+              size_t new_mem_size_, size_t new_max_num_, size_t new_buckets_num_, bool check_ = false);
+
+    /// 每次insert、erase顺带搬几个桶，0表示只在调用step的时候搬
+    void set_step_per_op(size_t bucket_num_) { m_step_per_op = bucket_num_; }
+    /// 搬bucket_num_个桶，返回实际处理的桶数，新表满了的话会提前返回
+    size_t step(size_t bucket_num_);
+    /// 旧表是否已经搬空
+    bool finished() const { return m_old.size() == 0; }
+
+    /// 两边加起来的个数
+    size_t size() const { return m_old.size() + m_new.size(); }
+    /// 新表的容量
+    size_t capacity() const { return m_new.capacity(); }
+
+    /// 插入一个元素，已经存在或者新表满了返回false
+    bool insert(const KEY& key_, const VALUE& value_);
+    /// 找到了返回值的指针，指针在下一次修改操作之前有效，不搬桶，通过返回的指针改值的话算写操作
+    VALUE* find(const KEY& key_);
+    const VALUE* find(const KEY& key_) const;
+    /// 是否存在
+    bool exist(const KEY& key_) const;
+    /// 删除一个，不存在返回false
+    bool erase(const KEY& key_);
+    /// 遍历两边所有的元素，func_(const NodeType&)
+    template <typename FUNC>
+    void for_each(FUNC&& func_) const;
+
+private:
+    /// 把旧表一个桶上的节点全部搬到新表，新表满了返回false
+    bool move_bucket(size_t bucket_);
+    const VALUE* find_hashed(const KEY& key_, size_t hash_) const;
+
+    TableType m_old;
+    TableType m_new;
+    /// 本进程看到的搬迁进度，比这个小的桶在旧表里面都是空的
+    size_t m_cursor = 0;
+    size_t m_step_per_op = 4;
+};
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+size_t MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::need_mem_size(size_t max_num_, size_t buckets_num_)
+{
+    return TableType::need_mem_size(max_num_, buckets_num_);
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::init(void* old_mem_, size_t old_mem_size_, size_t old_max_num_,
+                                                       size_t old_buckets_num_, void* new_mem_, size_t new_mem_size_,
+                                                       size_t new_max_num_, size_t new_buckets_num_, bool check_)
+{
+    if (old_mem_ == new_mem_ || new_buckets_num_ == 0)
+        return false;
+
+    TableType old_table;
+    if (!old_table.init(old_mem_, old_mem_size_, old_max_num_, old_buckets_num_, true))
+        return false;
+    TableType new_table;
+    if (!new_table.init(new_mem_, new_mem_size_, new_max_num_, new_buckets_num_, check_))
+        return false;
+    if (old_table.size() + new_table.size() > new_table.capacity())
+        return false;
+
+    m_old = old_table;
+    m_new = new_table;
+    m_cursor = 0;
+    return true;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+size_t MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::step(size_t bucket_num_)
+{
+    size_t moved = 0;
+    size_t bucket_count = m_old.bucket_count();
+    while (moved < bucket_num_ && m_cursor < bucket_count && !finished())
+    {
+        if (!move_bucket(m_cursor))
+            break;
+        ++m_cursor;
+        ++moved;
+    }
+    return moved;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::move_bucket(size_t bucket_)
+{
+    for (IntType index = m_old.bucket_first(bucket_); index != 0; index = m_old.bucket_first(bucket_))
+    {
+        // 两个表的HASH是一样的，哈希值算一次两边都能用
+        NodeType node = m_old.deref(index);
+        size_t hash = m_old.key_hash(node.first);
+        if (m_new.insert2_hashed(node, hash).first == 0)
+            return false;
+        m_old.erase_hashed(node.first, hash);
+    }
+    return true;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::insert(const KEY& key_, const VALUE& value_)
+{
+    step(m_step_per_op);
+    size_t hash = m_new.key_hash(key_);
+    // 还没搬过来的也算已经存在
+    if (!finished() && m_old.find_index_hashed(key_, hash) != 0)
+        return false;
+    return m_new.insert2_hashed({key_, value_}, hash).second;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+VALUE* MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::find(const KEY& key_)
+{
+    return const_cast<VALUE*>(find_hashed(key_, m_new.key_hash(key_)));
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+const VALUE* MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::find(const KEY& key_) const
+{
+    return find_hashed(key_, m_new.key_hash(key_));
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+const VALUE* MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::find_hashed(const KEY& key_, size_t hash_) const
+{
+    IntType index = m_new.find_index_hashed(key_, hash_);
+    if (index != 0)
+        return &(m_new.deref(index).second);
+    if (finished())
+        return nullptr;
+    index = m_old.find_index_hashed(key_, hash_);
+    return index != 0 ? &(m_old.deref(index).second) : nullptr;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::exist(const KEY& key_) const
+{
+    return find(key_) != nullptr;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::erase(const KEY& key_)
+{
+    step(m_step_per_op);
+    size_t hash = m_new.key_hash(key_);
+    if (m_new.erase_hashed(key_, hash) != 0)
+        return true;
+    return !finished() && m_old.erase_hashed(key_, hash) != 0;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+template <typename FUNC>
+void MigratingMemMap<KEY, VALUE, HASH, IS_EQUAL>::for_each(FUNC&& func_) const
+{
+    for (auto it = m_old.begin(); it != m_old.end(); ++it)
+        func_(*it);
+    for (auto it = m_new.begin(); it != m_new.end(); ++it)
+        func_(*it);
+}
+
+}  // namespace pepper
+
+#endif
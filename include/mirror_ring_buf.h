@@ -0,0 +1,239 @@
+/*
+ * * file name: mirror_ring_buf.h
+ * * description: 变长队列，数据区是memfd背靠背映射的两份，元素跨过尾部也是连续的
+ * *              不需要填充节点，front永远返回一段连续的内存
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _MIRROR_RING_BUF_H_
+#define _MIRROR_RING_BUF_H_
+
+#include <sys/uio.h>
+#include "inner/buf_data.h"
+
+namespace pepper
+{
+/// 大小通过init来指定，会向上取整到页大小，跨进程使用的时候把fd()传给另外一个进程，用attach挂上去
+class MirrorRingBuf : public inner::MirrorRingBufData
+{
+    using Data = inner::MirrorRingBufData;
+    using IntType = Data::IntType;
+
+public:
+    /// 清空队列
+    void clear();
+    /// 队列是否空
+    bool empty() const;
+    /// 队列是否满了
+    bool full() const;
+    /// 当前已经使用的字节数
+    size_t size() const;
+    /// 队列最大字节数容量
+    size_t capacity() const;
+    /// 获取插入了多少数据包
+    size_t get_num() const;
+    /// 队尾入队
+    bool push(const uint8_t *data_, size_t len_, bool over_write_ = false);
+    bool push(const struct iovec *iov_, size_t iov_cnt_, bool over_write_ = false);
+    /// 在队尾预留len_个字节，返回可以直接写入的连续地址，失败返回nullptr，写完之后调用commit入队
+    uint8_t *reserve(size_t len_, bool over_write_ = false);
+    /// 把reserve预留的空间入队，len_是实际写入的长度，不能大于预留的长度
+    bool commit(size_t len_);
+    /// 队头弹出一个
+    void pop();
+    /// 队头弹出num_个，返回真正弹出的个数
+    size_t pop_n(size_t num_);
+    /// 获取队头往后数第index_个元素(从0开始计数)，返回该元素的指针，len_表示数据长度
+    const uint8_t *front(size_t &len_, size_t index_ = 0) const;
+    uint8_t *front(size_t &len_, size_t index_ = 0);
+
+private:
+    struct ItemHeader
+    {
+        /// 0 表示数据节点，2 表示reserve了还没有commit的，没有填充节点
+        uint8_t m_flag = 0;
+        /// 后面的数据长度
+        IntType m_len = 0;
+    };
+
+    /// 找不到就返回max_size
+    IntType find_start(size_t index_) const;
+};
+
+inline void MirrorRingBuf::clear()
+{
+    Data::set_start(0);
+    Data::set_end(0);
+    Data::set_used_size(0);
+    Data::set_item_num(0);
+}
+
+inline bool MirrorRingBuf::empty() const
+{
+    return Data::get_item_num() == 0;
+}
+
+inline bool MirrorRingBuf::full() const
+{
+    return Data::get_used_size() + sizeof(ItemHeader) > Data::get_max_size();
+}
+
+inline size_t MirrorRingBuf::size() const
+{
+    return Data::get_used_size();
+}
+
+inline size_t MirrorRingBuf::capacity() const
+{
+    return Data::get_max_size();
+}
+
+inline size_t MirrorRingBuf::get_num() const
+{
+    return Data::get_item_num();
+}
+
+inline bool MirrorRingBuf::push(const uint8_t *data_, size_t len_, bool over_write_)
+{
+    struct iovec iov[1];
+    iov[0].iov_base = const_cast<void *>(reinterpret_cast<const void *>(data_));
+    iov[0].iov_len = len_;
+    return push(iov, 1, over_write_);
+}
+
+inline bool MirrorRingBuf::push(const struct iovec *iov_, size_t iov_cnt_, bool over_write_)
+{
+    size_t total_len = 0;
+    for (size_t i = 0; i < iov_cnt_; ++i)
+        total_len += iov_[i].iov_len;
+
+    uint8_t *begin = reserve(total_len, over_write_);
+    if (begin == nullptr)
+        return false;
+
+    for (size_t i = 0; i < iov_cnt_; ++i)
+    {
+        std::memcpy(begin, iov_[i].iov_base, iov_[i].iov_len);
+        begin += iov_[i].iov_len;
+    }
+    return commit(total_len);
+}
+
+inline uint8_t *MirrorRingBuf::reserve(size_t len_, bool over_write_)
+{
+    size_t need_len = len_ + sizeof(ItemHeader);
+    if (need_len > Data::get_max_size())
+        return nullptr;
+
+    // 不需要考虑尾部放不下的情况，只要总的空闲空间够就行
+    while (Data::get_used_size() + need_len > Data::get_max_size())
+    {
+        if (!over_write_)
+            return nullptr;
+        pop();
+    }
+
+    ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + Data::get_end());
+    item_header->m_len = len_;
+    item_header->m_flag = 2;
+    return reinterpret_cast<uint8_t *>(item_header + 1);
+}
+
+inline bool MirrorRingBuf::commit(size_t len_)
+{
+    if (full())
+        return false;
+
+    ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + Data::get_end());
+    if (item_header->m_flag != 2 || len_ > item_header->m_len)
+        return false;
+
+    item_header->m_len = len_;
+    item_header->m_flag = 0;
+
+    size_t need_len = len_ + sizeof(ItemHeader);
+    Data::set_end(Data::wrap(Data::get_end() + need_len));
+    Data::incr_used_size(need_len);
+    Data::incr_item_num();
+    return true;
+}
+
+inline void MirrorRingBuf::pop()
+{
+    if (empty())
+        return;
+
+    const ItemHeader *item_header = reinterpret_cast<const ItemHeader *>(Data::m_buf + Data::get_start());
+    assert(item_header->m_flag == 0);
+    size_t item_len = sizeof(ItemHeader) + item_header->m_len;
+    assert(Data::get_used_size() >= item_len);
+
+    Data::set_start(Data::wrap(Data::get_start() + item_len));
+    Data::decr_used_size(item_len);
+    Data::decr_item_num();
+}
+
+inline size_t MirrorRingBuf::pop_n(size_t num_)
+{
+    if (num_ >= Data::get_item_num())
+    {
+        num_ = Data::get_item_num();
+        clear();
+        return num_;
+    }
+
+    IntType item_start = Data::get_start();
+    IntType pop_size = 0;
+    for (size_t i = 0; i < num_; ++i)
+    {
+        const ItemHeader *item_header = reinterpret_cast<const ItemHeader *>(Data::m_buf + item_start);
+        pop_size += sizeof(ItemHeader) + item_header->m_len;
+        item_start = Data::wrap(item_start + sizeof(ItemHeader) + item_header->m_len);
+    }
+
+    Data::set_start(item_start);
+    Data::decr_used_size(pop_size);
+    Data::set_item_num(Data::get_item_num() - num_);
+    return num_;
+}
+
+inline const uint8_t *MirrorRingBuf::front(size_t &len_, size_t index_) const
+{
+    IntType item_start = find_start(index_);
+    if (item_start == Data::get_max_size())
+        return nullptr;
+
+    const ItemHeader *item_header = reinterpret_cast<const ItemHeader *>(Data::m_buf + item_start);
+    len_ = item_header->m_len;
+    return reinterpret_cast<const uint8_t *>(item_header + 1);
+}
+
+inline uint8_t *MirrorRingBuf::front(size_t &len_, size_t index_)
+{
+    IntType item_start = find_start(index_);
+    if (item_start == Data::get_max_size())
+        return nullptr;
+
+    ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + item_start);
+    len_ = item_header->m_len;
+    return reinterpret_cast<uint8_t *>(item_header + 1);
+}
+
+inline MirrorRingBuf::IntType MirrorRingBuf::find_start(size_t index_) const
+{
+    if (index_ >= Data::get_item_num())
+        return Data::get_max_size();
+
+    IntType item_start = Data::get_start();
+    for (size_t i = 0; i < index_; ++i)
+    {
+        const ItemHeader *item_header = reinterpret_cast<const ItemHeader *>(Data::m_buf + item_start);
+        item_start = Data::wrap(item_start + sizeof(ItemHeader) + item_header->m_len);
+    }
+    return item_start;
+}
+
+}  // namespace pepper
+
+#endif
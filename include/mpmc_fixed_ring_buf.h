@@ -0,0 +1,141 @@
+/*
+ * * file name: mpmc_fixed_ring_buf.h
+ * * description: 多生产者多消费者的无锁定长队列，每个槽位带一个序号，不需要加锁
+ * *              可以放在共享内存上给多个进程用
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _MPMC_FIXED_RING_BUF_H_
+#define _MPMC_FIXED_RING_BUF_H_
+
+#include <cstdint>
+#include "inner/buf_data.h"
+
+namespace pepper
+{
+/// SIZE 如果是0，则表示大小是通过init来指定
+/// 因为元素随时可能被其他消费者拿走，所以不提供front和back，只能通过pop拷贝出来
+template <typename T, size_t MAX_SIZE = 0>
+class MPMCFixedRingBuf : public inner::MPMCFixedRingBufData<T, MAX_SIZE>
+{
+public:
+    /// 队列是否空，只是一个瞬时值
+    bool empty() const;
+    /// 队列是否满了，只是一个瞬时值
+    bool full() const;
+    /// 当前已经用的个数，只是一个瞬时值
+    size_t size() const;
+    /// 队列最大容量
+    size_t capacity() const;
+    /// 队尾入队，满了返回false
+    bool push(const T &value_);
+    /// 队头出队，拷贝到value_里面，空了返回false
+    bool pop(T &value_);
+
+private:
+    using Data = inner::MPMCFixedRingBufData<T, MAX_SIZE>;
+    using IntType = typename Data::IntType;
+};
+
+template <typename T, size_t MAX_SIZE>
+bool MPMCFixedRingBuf<T, MAX_SIZE>::empty() const
+{
+    return size() == 0;
+}
+
+template <typename T, size_t MAX_SIZE>
+bool MPMCFixedRingBuf<T, MAX_SIZE>::full() const
+{
+    return size() >= Data::get_max_num();
+}
+
+template <typename T, size_t MAX_SIZE>
+size_t MPMCFixedRingBuf<T, MAX_SIZE>::size() const
+{
+    size_t dequeue_pos = Data::dequeue_pos().load(std::memory_order_acquire);
+    size_t enqueue_pos = Data::enqueue_pos().load(std::memory_order_acquire);
+    return enqueue_pos > dequeue_pos ? std::min<size_t>(enqueue_pos - dequeue_pos, Data::get_max_num()) : 0;
+}
+
+template <typename T, size_t MAX_SIZE>
+size_t MPMCFixedRingBuf<T, MAX_SIZE>::capacity() const
+{
+    return Data::get_max_num();
+}
+
+template <typename T, size_t MAX_SIZE>
+bool MPMCFixedRingBuf<T, MAX_SIZE>::push(const T &value_)
+{
+    assert(Data::get_max_num() > 0);
+    auto &enqueue_pos = Data::enqueue_pos();
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    typename Data::Slot *slot = nullptr;
+    while (true)
+    {
+        slot = &(Data::slot(Data::wrap(pos)));
+        size_t seq = slot->m_seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            // 槽位空着，抢这个入队位置
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // 槽位上一轮的数据还没有被取走，满了
+            return false;
+        }
+        else
+        {
+            // 被别的生产者抢先了
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->m_value = value_;
+    // 发布给第pos次出队
+    slot->m_seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T, size_t MAX_SIZE>
+bool MPMCFixedRingBuf<T, MAX_SIZE>::pop(T &value_)
+{
+    assert(Data::get_max_num() > 0);
+    auto &dequeue_pos = Data::dequeue_pos();
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    typename Data::Slot *slot = nullptr;
+    while (true)
+    {
+        slot = &(Data::slot(Data::wrap(pos)));
+        size_t seq = slot->m_seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0)
+        {
+            // 槽位数据写好了，抢这个出队位置
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // 槽位还没有被写入，空了
+            return false;
+        }
+        else
+        {
+            // 被别的消费者抢先了
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    value_ = slot->m_value;
+    // 槽位留给下一轮的第pos + max_num次入队
+    slot->m_seq.store(pos + Data::get_max_num(), std::memory_order_release);
+    return true;
+}
+
+}  // namespace pepper
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * * file name: offset_ptr.h
+ * * description: 相对自己地址的指针，存的是目标地址减去自己的地址
+ * *              指针和它指向的东西在同一块内存里面的时候，整块内存映射到哪里都还是对的
+ * *              可以当成std容器的allocator的pointer类型用，见shm_allocator.h
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _OFFSET_PTR_H_
+#define _OFFSET_PTR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+namespace pepper
+{
+template <typename T>
+class OffsetPtr
+{
+    template <typename U>
+    friend class OffsetPtr;
+
+    /// 指向自己是合法的，偏移0不能当空指针，用1表示空，1不可能是一个对齐了的地址差
+    static constexpr std::ptrdiff_t NULL_OFFSET = 1;
+
+public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = OffsetPtr;
+    using reference = std::add_lvalue_reference_t<T>;
+    using iterator_category = std::random_access_iterator_tag;
+    template <typename U>
+    using rebind = OffsetPtr<U>;
+
+    OffsetPtr() = default;
+    OffsetPtr(std::nullptr_t) {}
+    OffsetPtr(T* p_) { set(p_); }
+    OffsetPtr(const OffsetPtr& right_) { set(right_.get()); }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    OffsetPtr(const OffsetPtr<U>& right_)
+    {
+        set(right_.get());
+    }
+    /// void指针和别的类型的指针之间的转换，std容器从void_pointer转回来的时候要用
+    template <typename U, typename = std::enable_if_t<!std::is_convertible_v<U*, T*>>, typename = void>
+    explicit OffsetPtr(const OffsetPtr<U>& right_)
+    {
+        set(static_cast<T*>(static_cast<std::conditional_t<std::is_const_v<U>, const void*, void*>>(right_.get())));
+    }
+
+    OffsetPtr& operator=(const OffsetPtr& right_)
+    {
+        set(right_.get());
+        return *this;
+    }
+    OffsetPtr& operator=(T* p_)
+    {
+        set(p_);
+        return *this;
+    }
+
+    T* get() const
+    {
+        if (m_offset == NULL_OFFSET)
+            return nullptr;
+        return reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + m_offset);
+    }
+
+    template <typename U = T>
+    std::enable_if_t<!std::is_void_v<U>, U&> operator*() const
+    {
+        return *get();
+    }
+    T* operator->() const { return get(); }
+    template <typename U = T>
+    std::enable_if_t<!std::is_void_v<U>, U&> operator[](difference_type n_) const
+    {
+        return get()[n_];
+    }
+    explicit operator bool() const { return m_offset != NULL_OFFSET; }
+    /// libstdc++的basic_string里面直接把pointer当成裸指针用，只能提供隐式转换
+    operator T*() const { return get(); }
+
+    /// std::pointer_traits用的
+    template <typename U = T>
+    static std::enable_if_t<!std::is_void_v<U>, OffsetPtr> pointer_to(U& ref_)
+    {
+        return OffsetPtr(&ref_);
+    }
+
+    OffsetPtr& operator++() { return *this += 1; }
+    OffsetPtr operator++(int)
+    {
+        OffsetPtr temp(*this);
+        ++(*this);
+        return temp;
+    }
+    OffsetPtr& operator--() { return *this -= 1; }
+    OffsetPtr operator--(int)
+    {
+        OffsetPtr temp(*this);
+        --(*this);
+        return temp;
+    }
+    OffsetPtr& operator+=(difference_type n_)
+    {
+        m_offset += n_ * static_cast<difference_type>(sizeof(T));
+        return *this;
+    }
+    OffsetPtr& operator-=(difference_type n_)
+    {
+        m_offset -= n_ * static_cast<difference_type>(sizeof(T));
+        return *this;
+    }
+    friend OffsetPtr operator+(OffsetPtr p_, difference_type n_) { return p_ += n_; }
+    friend OffsetPtr operator+(difference_type n_, OffsetPtr p_) { return p_ += n_; }
+    friend OffsetPtr operator-(OffsetPtr p_, difference_type n_) { return p_ -= n_; }
+    friend difference_type operator-(const OffsetPtr& left_, const OffsetPtr& right_)
+    {
+        return left_.get() - right_.get();
+    }
+
+    friend bool operator==(const OffsetPtr& left_, const OffsetPtr& right_) { return left_.get() == right_.get(); }
+    friend bool operator!=(const OffsetPtr& left_, const OffsetPtr& right_) { return left_.get() != right_.get(); }
+    friend bool operator<(const OffsetPtr& left_, const OffsetPtr& right_) { return left_.get() < right_.get(); }
+    friend bool operator>(const OffsetPtr& left_, const OffsetPtr& right_) { return left_.get() > right_.get(); }
+    friend bool operator<=(const OffsetPtr& left_, const OffsetPtr& right_) { return left_.get() <= right_.get(); }
+    friend bool operator>=(const OffsetPtr& left_, const OffsetPtr& right_) { return left_.get() >= right_.get(); }
+    friend bool operator==(const OffsetPtr& left_, std::nullptr_t) { return !left_; }
+    friend bool operator!=(const OffsetPtr& left_, std::nullptr_t) { return static_cast<bool>(left_); }
+
+private:
+    void set(T* p_)
+    {
+        if (!p_)
+            m_offset = NULL_OFFSET;
+        else
+            m_offset = reinterpret_cast<intptr_t>(p_) - reinterpret_cast<intptr_t>(this);
+    }
+
+    std::ptrdiff_t m_offset = NULL_OFFSET;
+};
+
+}  // namespace pepper
+
+#endif
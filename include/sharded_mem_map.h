@@ -0,0 +1,325 @@
+/*
+ * * file name: sharded_mem_map.h
+ * * description: 分片的共享内存哈希表，多个线程或者进程可以同时挂在同一块内存上
+ * *              key按哈希分到N个独立的MemHashTable上，每个分片一个seqlock
+ * *              写操作只锁自己的分片，读操作没有写的时候不用加锁，只是把值拷贝出来再校验一下序号
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SHARDED_MEM_MAP_H_
+#define _SHARDED_MEM_MAP_H_
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "const_var.h"
+#include "inner/base_specialization.h"
+#include "inner/hash_table_policy.h"
+#include "inner/mem_hash_table.h"
+
+namespace pepper
+{
+namespace inner
+{
+/// 每个分片的锁字，单独占一个cache line，不同分片的读写互不影响
+/// 奇数表示有写者在改，写者把它从偶数CAS成奇数就相当于拿到了锁
+struct alignas(CACHE_LINE_SIZE) ShardSeqLock
+{
+    std::atomic<uint32_t> m_seq{0};
+
+    void lock()
+    {
+        uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        while ((seq & 1) != 0 || !m_seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+            seq = m_seq.load(std::memory_order_relaxed);
+        }
+        // 后面对分片的修改不能跑到序号变成奇数之前
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void unlock() { m_seq.fetch_add(1, std::memory_order_release); }
+
+    /// 读开始，等到没有写者的时候返回序号
+    uint32_t read_begin() const
+    {
+        uint32_t seq = m_seq.load(std::memory_order_acquire);
+        while ((seq & 1) != 0)
+        {
+            std::this_thread::yield();
+            seq = m_seq.load(std::memory_order_acquire);
+        }
+        return seq;
+    }
+
+    /// 读结束，序号没变说明读到的数据是完整的
+    bool read_retry(uint32_t seq_) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_seq.load(std::memory_order_relaxed) != seq_;
+    }
+};
+}  // namespace inner
+
+/// KEY和VALUE都要是平凡可拷贝的，读的时候是把值拷贝出来的，不提供迭代器和引用
+template <typename KEY, typename VALUE, typename HASH = std::hash<KEY>, typename IS_EQUAL = IsEqual<KEY>>
+class ShardedMemMap
+{
+    static_assert(std::is_trivially_copyable_v<KEY> && std::is_trivially_copyable_v<VALUE>,
+                  "ShardedMemMap need trivially copyable key and value");
+
+    using TableType = inner::MemHashTable<inner::HashTablePolicy<KEY, VALUE, 0, HASH, IS_EQUAL>>;
+    using ShardLock = inner::ShardSeqLock;
+
+public:
+    /// 计算需要的内存大小
+    static size_t need_mem_size(size_t shard_num_, size_t max_num_per_shard_, size_t buckets_per_shard_);
+    /// 调用者提供内存，一个进程check_ == false初始化，其他的进程check_ == true挂上去
+    bool init(void* mem_, size_t mem_size_, size_t shard_num_, size_t max_num_per_shard_, size_t buckets_per_shard_,
+              bool check_ = false);
+
+    /// 清空所有分片，会依次锁住每个分片
+    void clear();
+    /// 当前已经用的个数，只是一个瞬时值
+    size_t size() const;
+    /// 最大容量
+    size_t capacity() const;
+    /// 分片数
+    size_t shard_num() const { return m_shards.size(); }
+    /// key落在哪个分片
+    size_t shard_index(const KEY& key_) const;
+    /// 哈希值落在哪个分片，hash_是HASH()(key)的结果，分片里面的表直接复用这个值，不用再算一次
+    size_t shard_of_hash(size_t hash_) const;
+
+    /// 插入一个元素，已经存在或者分片满了返回false
+    bool insert(const KEY& key_, const VALUE& value_);
+    /// 不存在就插入，存在就覆盖，分片满了返回false
+    bool assign(const KEY& key_, const VALUE& value_);
+    /// 在分片的锁里面修改值，func_(VALUE&)，不存在返回false
+    template <typename FUNC>
+    bool update(const KEY& key_, FUNC&& func_);
+    /// 找到了就把值拷贝到value_里面
+    bool find(const KEY& key_, VALUE& value_) const;
+    /// 是否存在
+    bool exist(const KEY& key_) const;
+    /// 删除一个，不存在返回false
+    bool erase(const KEY& key_);
+
+private:
+    struct Head
+    {
+        size_t m_shard_num = 0;
+        size_t m_max_num_per_shard = 0;
+        size_t m_buckets_per_shard = 0;
+        size_t m_mem_size = 0;
+    };
+
+    static constexpr size_t align_size(size_t size_)
+    {
+        return (size_ + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    }
+    static size_t shard_mem_size(size_t max_num_per_shard_, size_t buckets_per_shard_)
+    {
+        return TableType::need_mem_size(max_num_per_shard_, buckets_per_shard_);
+    }
+
+    Head* m_head = nullptr;
+    ShardLock* m_locks = nullptr;
+    /// 每个分片自己的指针，只是本进程的视图，内存都在共享内存上
+    std::vector<TableType> m_shards;
+};
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+size_t ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::need_mem_size(size_t shard_num_, size_t max_num_per_shard_,
+                                                                size_t buckets_per_shard_)
+{
+    return align_size(sizeof(Head)) + sizeof(ShardLock) * shard_num_ +
+           align_size(shard_mem_size(max_num_per_shard_, buckets_per_shard_)) * shard_num_;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::init(void* mem_, size_t mem_size_, size_t shard_num_,
+                                                     size_t max_num_per_shard_, size_t buckets_per_shard_, bool check_)
+{
+    if (!mem_ || shard_num_ == 0 || buckets_per_shard_ == 0 ||
+        mem_size_ != need_mem_size(shard_num_, max_num_per_shard_, buckets_per_shard_))
+        return false;
+
+    Head* head = reinterpret_cast<Head*>(mem_);
+    if (check_)
+    {
+        if (head->m_shard_num != shard_num_ || head->m_max_num_per_shard != max_num_per_shard_ ||
+            head->m_buckets_per_shard != buckets_per_shard_ || head->m_mem_size != mem_size_)
+            return false;
+    }
+    else
+    {
+        new (head) Head();
+        head->m_shard_num = shard_num_;
+        head->m_max_num_per_shard = max_num_per_shard_;
+        head->m_buckets_per_shard = buckets_per_shard_;
+        head->m_mem_size = mem_size_;
+    }
+
+    uint8_t* cur = reinterpret_cast<uint8_t*>(mem_) + align_size(sizeof(Head));
+    ShardLock* locks = reinterpret_cast<ShardLock*>(cur);
+    if (!check_)
+    {
+        for (size_t i = 0; i < shard_num_; ++i)
+            new (locks + i) ShardLock();
+    }
+    cur += sizeof(ShardLock) * shard_num_;
+
+    std::vector<TableType> shards(shard_num_);
+    size_t table_mem_size = shard_mem_size(max_num_per_shard_, buckets_per_shard_);
+    for (size_t i = 0; i < shard_num_; ++i)
+    {
+        if (!shards[i].init(cur, table_mem_size, max_num_per_shard_, buckets_per_shard_, check_))
+            return false;
+        cur += align_size(table_mem_size);
+    }
+
+    m_head = head;
+    m_locks = locks;
+    m_shards.swap(shards);
+    return true;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+void ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::clear()
+{
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        m_locks[i].lock();
+        m_shards[i].clear();
+        m_locks[i].unlock();
+    }
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+size_t ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::size() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        size_t used = 0;
+        uint32_t seq = 0;
+        do
+        {
+            seq = m_locks[i].read_begin();
+            used = m_shards[i].size();
+        } while (m_locks[i].read_retry(seq));
+        total += used;
+    }
+    return total;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+size_t ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::capacity() const
+{
+    return m_head ? m_head->m_shard_num * m_head->m_max_num_per_shard : 0;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+size_t ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::shard_index(const KEY& key_) const
+{
+    return shard_of_hash(HASH()(key_));
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+size_t ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::shard_of_hash(size_t hash_) const
+{
+    // 分片内部的桶用的是hash % buckets_num，这里先把hash打散再取高位，避免分片和桶用到同样的低位
+    return static_cast<size_t>((mix_hash(hash_) >> 32) % m_shards.size());
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::insert(const KEY& key_, const VALUE& value_)
+{
+    size_t hash = HASH()(key_);
+    size_t index = shard_of_hash(hash);
+    m_locks[index].lock();
+    bool result = m_shards[index].insert2_hashed({key_, value_}, hash).second;
+    m_locks[index].unlock();
+    return result;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::assign(const KEY& key_, const VALUE& value_)
+{
+    size_t hash = HASH()(key_);
+    size_t index = shard_of_hash(hash);
+    m_locks[index].lock();
+    auto result = m_shards[index].insert2_hashed({key_, value_}, hash);
+    if (!result.second && result.first != 0)
+        m_shards[index].deref(result.first).second = value_;
+    m_locks[index].unlock();
+    return result.first != 0;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+template <typename FUNC>
+bool ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::update(const KEY& key_, FUNC&& func_)
+{
+    size_t hash = HASH()(key_);
+    size_t index = shard_of_hash(hash);
+    m_locks[index].lock();
+    auto node_index = m_shards[index].find_index_hashed(key_, hash);
+    if (node_index != 0)
+        func_(m_shards[index].deref(node_index).second);
+    m_locks[index].unlock();
+    return node_index != 0;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::find(const KEY& key_, VALUE& value_) const
+{
+    size_t hash = HASH()(key_);
+    size_t index = shard_of_hash(hash);
+    const ShardLock& lock = m_locks[index];
+    const TableType& shard = m_shards[index];
+    bool found = false;
+    uint32_t seq = 0;
+    do
+    {
+        // 和写者并发的时候可能读到一半的数据，但是下标总是合法的，序号变了重新读一遍就行
+        seq = lock.read_begin();
+        auto node_index = shard.find_index_hashed(key_, hash);
+        found = node_index != 0;
+        if (found)
+            value_ = shard.deref(node_index).second;
+    } while (lock.read_retry(seq));
+    return found;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::exist(const KEY& key_) const
+{
+    size_t hash = HASH()(key_);
+    size_t index = shard_of_hash(hash);
+    bool found = false;
+    uint32_t seq = 0;
+    do
+    {
+        seq = m_locks[index].read_begin();
+        found = m_shards[index].find_index_hashed(key_, hash) != 0;
+    } while (m_locks[index].read_retry(seq));
+    return found;
+}
+
+template <typename KEY, typename VALUE, typename HASH, typename IS_EQUAL>
+bool ShardedMemMap<KEY, VALUE, HASH, IS_EQUAL>::erase(const KEY& key_)
+{
+    size_t hash = HASH()(key_);
+    size_t index = shard_of_hash(hash);
+    m_locks[index].lock();
+    bool result = m_shards[index].erase_hashed(key_, hash) != 0;
+    m_locks[index].unlock();
+    return result;
+}
+
+}  // namespace pepper
+
+#endif
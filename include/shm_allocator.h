@@ -0,0 +1,92 @@
+/*
+ * * file name: shm_allocator.h
+ * * description: 从UnFixedMemPool上申请内存的std allocator，pointer是OffsetPtr
+ * *              容器对象本身也放在同一块内存里面的话，整块内存搬走或者重启之后映射到别的地址还能直接用
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SHM_ALLOCATOR_H_
+#define _SHM_ALLOCATOR_H_
+
+#include <new>
+#include "offset_ptr.h"
+#include "unfixed_mem_pool.h"
+
+namespace pepper
+{
+/// 只存了一个指向内存池开头的OffsetPtr，所以allocator自己也必须和内存池在同一块内存里面
+/// 也就是说容器对象要放在池子里面，不能放在栈上，池子用完了抛std::bad_alloc
+/// 超过UnFixedMemPool::max_alloc_size()的申请要连续的整slab，碎片多了大的vector可能申请不到
+template <typename T>
+class ShmAllocator
+{
+    using PoolType = UnFixedMemPool<>;
+
+    template <typename U>
+    friend class ShmAllocator;
+
+public:
+    using value_type = T;
+    using pointer = OffsetPtr<T>;
+    using const_pointer = OffsetPtr<const T>;
+    using void_pointer = OffsetPtr<void>;
+    using const_void_pointer = OffsetPtr<const void>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    /// 拷贝容器的时候新的容器还是用同一个池子，交换的时候allocator跟着走
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    /// pool_mem_ 是UnFixedMemPool初始化过的那块内存
+    explicit ShmAllocator(void* pool_mem_) : m_pool_mem(static_cast<uint8_t*>(pool_mem_)) {}
+    ShmAllocator(const ShmAllocator& right_) : m_pool_mem(right_.m_pool_mem) {}
+    template <typename U>
+    ShmAllocator(const ShmAllocator<U>& right_) : m_pool_mem(right_.m_pool_mem)
+    {
+    }
+    ShmAllocator& operator=(const ShmAllocator& right_)
+    {
+        m_pool_mem = right_.m_pool_mem;
+        return *this;
+    }
+
+    pointer allocate(size_type n_)
+    {
+        static_assert(alignof(T) <= alignof(size_t), "ShmAllocator can not align more than size_t");
+        PoolType pool;
+        size_t offset = pool.attach(m_pool_mem.get()) ? pool.alloc(n_ * sizeof(T)) : 0;
+        if (offset == 0)
+            throw std::bad_alloc();
+        return pointer(static_cast<T*>(pool.offset_2_ptr(offset)));
+    }
+
+    void deallocate(pointer p_, size_type)
+    {
+        PoolType pool;
+        if (p_ && pool.attach(m_pool_mem.get()))
+            pool.free(pool.ptr_2_offset(p_.get()));
+    }
+
+    void* pool_mem() const { return m_pool_mem.get(); }
+
+    template <typename U>
+    bool operator==(const ShmAllocator<U>& right_) const
+    {
+        return m_pool_mem.get() == right_.m_pool_mem.get();
+    }
+    template <typename U>
+    bool operator!=(const ShmAllocator<U>& right_) const
+    {
+        return m_pool_mem.get() != right_.m_pool_mem.get();
+    }
+
+private:
+    OffsetPtr<uint8_t> m_pool_mem;
+};
+
+}  // namespace pepper
+
+#endif
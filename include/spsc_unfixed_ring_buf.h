@@ -0,0 +1,314 @@
+/*
+ * * file name: spsc_unfixed_ring_buf.h
+ * * description: 单生产者单消费者的无锁不定长队列，可以放在共享内存上给两个进程用
+ * *              读写位置分别放在不同的cache line上，只有生产者修改写位置，只有消费者修改读位置
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SPSC_UNFIXED_RING_BUF_H_
+#define _SPSC_UNFIXED_RING_BUF_H_
+
+#include <sys/uio.h>
+#include "inner/buf_data.h"
+
+namespace pepper
+{
+/// SIZE 如果是0，则表示大小是通过init来指定
+/// 生产者只能调用push，消费者只能调用front和pop，其他接口两边都能调用，但是结果只是一个瞬时值
+/// 因为生产者不能修改读位置，所以不提供覆盖写的功能
+/// 读写位置不回绕，队列空了也不能重置到开头，所以一个数据包加上头部最多是容量的一半，否则写位置在中间的时候补上填充永远放不下
+template <size_t MAX_SIZE = 0>
+class SPSCUnfixedRingBuf : public inner::SPSCUnfixedRingBufData<MAX_SIZE>
+{
+public:
+    /// 清空队列，只能在没有生产者和消费者在读写的时候调用
+    void clear();
+    /// 队列是否空
+    bool empty() const;
+    /// 当前已经使用的字节数，包括填充的字节
+    size_t size() const;
+    /// 队列最大字节数容量
+    size_t capacity() const;
+    /// 获取插入了多少数据包
+    size_t get_num() const;
+    /// 队尾入队，只有生产者调用
+    bool push(const uint8_t *data_, size_t len_);
+    bool push(const struct iovec *iov_, size_t iov_cnt_);
+    /// 在队尾预留len_个字节，返回可以直接写入的地址，失败返回nullptr，只有生产者调用
+    /// len_加上头部超过容量的一半直接失败，push也一样
+    /// 写完之后调用commit发布给消费者，在commit之前消费者是看不到的
+    uint8_t *reserve(size_t len_);
+    /// 发布reserve预留的空间，len_是实际写入的长度，不能大于预留的长度，只有生产者调用
+    bool commit(size_t len_);
+    /// 队头弹出一个，只有消费者调用
+    void pop();
+    /// 获取队头元素，返回该元素的指针，len_表示数据长度，只有消费者调用
+    const uint8_t *front(size_t &len_) const;
+    uint8_t *front(size_t &len_);
+    /// 从队头开始最多处理max_num_个元素，func_(const uint8_t *data, size_t len)返回false表示不处理这个元素了
+    /// 处理完的元素一次性弹出，读位置只发布一次，返回处理了多少个，只有消费者调用
+    template <typename FUNC>
+    size_t consume(FUNC &&func_, size_t max_num_);
+
+private:
+    using Data = inner::SPSCUnfixedRingBufData<MAX_SIZE>;
+    using IntType = typename Data::IntType;
+
+    struct ItemHeader
+    {
+        /// 0 表示数据节点，1 表示填充用的，2 表示reserve了还没有commit的
+        uint8_t m_flag = 0;
+        /// 后面的数据长度
+        IntType m_len = 0;
+    };
+
+    /// 生产者看看从tail_开始还能不能写下len_个字节
+    bool has_space(size_t tail_, size_t len_);
+    /// 消费者从head_开始找到第一个数据节点的累计位置，跳过填充，空的话返回false
+    bool find_start(size_t head_, size_t &pos_) const;
+};
+
+template <size_t MAX_SIZE>
+void SPSCUnfixedRingBuf<MAX_SIZE>::clear()
+{
+    Data::producer().m_tail.store(0, std::memory_order_relaxed);
+    Data::producer().m_push_num.store(0, std::memory_order_relaxed);
+    Data::producer().m_cached_head = 0;
+    Data::consumer().m_head.store(0, std::memory_order_relaxed);
+    Data::consumer().m_pop_num.store(0, std::memory_order_relaxed);
+    Data::consumer().m_cached_tail = 0;
+}
+
+template <size_t MAX_SIZE>
+bool SPSCUnfixedRingBuf<MAX_SIZE>::empty() const
+{
+    return Data::consumer().m_head.load(std::memory_order_acquire) ==
+           Data::producer().m_tail.load(std::memory_order_acquire);
+}
+
+template <size_t MAX_SIZE>
+size_t SPSCUnfixedRingBuf<MAX_SIZE>::size() const
+{
+    size_t head = Data::consumer().m_head.load(std::memory_order_acquire);
+    size_t tail = Data::producer().m_tail.load(std::memory_order_acquire);
+    return tail >= head ? tail - head : 0;
+}
+
+template <size_t MAX_SIZE>
+size_t SPSCUnfixedRingBuf<MAX_SIZE>::capacity() const
+{
+    return Data::get_max_size();
+}
+
+template <size_t MAX_SIZE>
+size_t SPSCUnfixedRingBuf<MAX_SIZE>::get_num() const
+{
+    size_t pop_num = Data::consumer().m_pop_num.load(std::memory_order_acquire);
+    size_t push_num = Data::producer().m_push_num.load(std::memory_order_acquire);
+    return push_num >= pop_num ? push_num - pop_num : 0;
+}
+
+template <size_t MAX_SIZE>
+bool SPSCUnfixedRingBuf<MAX_SIZE>::push(const uint8_t *data_, size_t len_)
+{
+    struct iovec iov[1];
+    iov[0].iov_base = const_cast<void *>(reinterpret_cast<const void *>(data_));
+    iov[0].iov_len = len_;
+    return push(iov, 1);
+}
+
+template <size_t MAX_SIZE>
+bool SPSCUnfixedRingBuf<MAX_SIZE>::push(const struct iovec *iov_, size_t iov_cnt_)
+{
+    size_t total_len = 0;
+    for (size_t i = 0; i < iov_cnt_; ++i)
+        total_len += iov_[i].iov_len;
+
+    uint8_t *begin = reserve(total_len);
+    if (begin == nullptr)
+        return false;
+
+    for (size_t i = 0; i < iov_cnt_; ++i)
+    {
+        std::memcpy(begin, iov_[i].iov_base, iov_[i].iov_len);
+        begin += iov_[i].iov_len;
+    }
+    return commit(total_len);
+}
+
+template <size_t MAX_SIZE>
+uint8_t *SPSCUnfixedRingBuf<MAX_SIZE>::reserve(size_t len_)
+{
+    size_t need_len = len_ + sizeof(ItemHeader);
+    // 不超过一半的话，队列空着的时候不管写位置在哪，尾部的填充加上数据包都放得下
+    if (need_len > Data::get_max_size() / 2)
+        return nullptr;
+
+    // 累计字节数用size_t表示，2^64个字节之前不会回绕
+    size_t tail = Data::producer().m_tail.load(std::memory_order_relaxed);
+    size_t pos = Data::wrap(tail);
+    // 尾部放不下，要补齐到buffer的结尾，从头开始放
+    size_t padding_len = pos + need_len > Data::get_max_size() ? Data::get_max_size() - pos : 0;
+    if (!has_space(tail, padding_len + need_len))
+        return nullptr;
+
+    if (padding_len > 0)
+    {
+        // 不足一个ItemHeader的尾部，消费者也会跳过，不用写填充节点
+        if (padding_len >= sizeof(ItemHeader))
+        {
+            ItemHeader *padding_header = reinterpret_cast<ItemHeader *>(Data::m_buf + pos);
+            padding_header->m_len = padding_len - sizeof(ItemHeader);
+            padding_header->m_flag = 1;
+        }
+        pos = 0;
+    }
+
+    ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + pos);
+    item_header->m_len = len_;
+    item_header->m_flag = 2;
+    return reinterpret_cast<uint8_t *>(item_header + 1);
+}
+
+template <size_t MAX_SIZE>
+bool SPSCUnfixedRingBuf<MAX_SIZE>::commit(size_t len_)
+{
+    size_t tail = Data::producer().m_tail.load(std::memory_order_relaxed);
+    size_t pos = Data::wrap(tail);
+    size_t left_bytes = Data::get_max_size() - pos;
+    ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + pos);
+    // reserve的时候没有补填充，预留的节点就在写位置上，否则在buffer的开头
+    if (left_bytes < sizeof(ItemHeader) || item_header->m_flag != 2)
+    {
+        tail += left_bytes;
+        item_header = reinterpret_cast<ItemHeader *>(Data::m_buf);
+    }
+
+    if (item_header->m_flag != 2 || len_ > item_header->m_len)
+        return false;
+
+    item_header->m_len = len_;
+    item_header->m_flag = 0;
+
+    // 先写个数再发布写位置，消费者看到数据的时候个数一定是对的
+    Data::producer().m_push_num.store(Data::producer().m_push_num.load(std::memory_order_relaxed) + 1,
+                                      std::memory_order_relaxed);
+    Data::producer().m_tail.store(tail + sizeof(ItemHeader) + len_, std::memory_order_release);
+    return true;
+}
+
+template <size_t MAX_SIZE>
+void SPSCUnfixedRingBuf<MAX_SIZE>::pop()
+{
+    size_t pos = 0;
+    if (!find_start(Data::consumer().m_head.load(std::memory_order_relaxed), pos))
+        return;
+
+    const ItemHeader *item_header =
+        reinterpret_cast<const ItemHeader *>(Data::m_buf + Data::wrap(pos));
+    assert(item_header->m_flag == 0);
+    Data::consumer().m_pop_num.store(Data::consumer().m_pop_num.load(std::memory_order_relaxed) + 1,
+                                     std::memory_order_relaxed);
+    // release保证读完数据之后生产者才能覆盖这段内存
+    Data::consumer().m_head.store(pos + sizeof(ItemHeader) + item_header->m_len, std::memory_order_release);
+}
+
+template <size_t MAX_SIZE>
+const uint8_t *SPSCUnfixedRingBuf<MAX_SIZE>::front(size_t &len_) const
+{
+    size_t pos = 0;
+    if (!find_start(Data::consumer().m_head.load(std::memory_order_relaxed), pos))
+        return nullptr;
+
+    const ItemHeader *item_header =
+        reinterpret_cast<const ItemHeader *>(Data::m_buf + Data::wrap(pos));
+    len_ = item_header->m_len;
+    return reinterpret_cast<const uint8_t *>(item_header + 1);
+}
+
+template <size_t MAX_SIZE>
+uint8_t *SPSCUnfixedRingBuf<MAX_SIZE>::front(size_t &len_)
+{
+    return const_cast<uint8_t *>(static_cast<const SPSCUnfixedRingBuf *>(this)->front(len_));
+}
+
+template <size_t MAX_SIZE>
+template <typename FUNC>
+size_t SPSCUnfixedRingBuf<MAX_SIZE>::consume(FUNC &&func_, size_t max_num_)
+{
+    size_t num = 0;
+    size_t pos = 0;
+    size_t end_pos = Data::consumer().m_head.load(std::memory_order_relaxed);
+    while (num < max_num_ && find_start(end_pos, pos))
+    {
+        const ItemHeader *item_header =
+            reinterpret_cast<const ItemHeader *>(Data::m_buf + Data::wrap(pos));
+        assert(item_header->m_flag == 0);
+        if (!func_(reinterpret_cast<const uint8_t *>(item_header + 1), static_cast<size_t>(item_header->m_len)))
+            break;
+
+        ++num;
+        end_pos = pos + sizeof(ItemHeader) + item_header->m_len;
+    }
+
+    if (num > 0)
+    {
+        Data::consumer().m_pop_num.store(Data::consumer().m_pop_num.load(std::memory_order_relaxed) + num,
+                                         std::memory_order_relaxed);
+        Data::consumer().m_head.store(end_pos, std::memory_order_release);
+    }
+    return num;
+}
+
+template <size_t MAX_SIZE>
+bool SPSCUnfixedRingBuf<MAX_SIZE>::has_space(size_t tail_, size_t len_)
+{
+    auto &producer = Data::producer();
+    if (tail_ + len_ - producer.m_cached_head <= Data::get_max_size())
+        return true;
+
+    // acquire保证消费者读完了这段内存才会被覆盖
+    producer.m_cached_head = Data::consumer().m_head.load(std::memory_order_acquire);
+    return tail_ + len_ - producer.m_cached_head <= Data::get_max_size();
+}
+
+template <size_t MAX_SIZE>
+bool SPSCUnfixedRingBuf<MAX_SIZE>::find_start(size_t head_, size_t &pos_) const
+{
+    auto &consumer = Data::consumer();
+    size_t head = head_;
+    while (true)
+    {
+        if (head == consumer.m_cached_tail)
+        {
+            // acquire保证看到写位置的时候，数据已经写好了
+            consumer.m_cached_tail = Data::producer().m_tail.load(std::memory_order_acquire);
+            if (head == consumer.m_cached_tail)
+                return false;
+        }
+
+        size_t pos = Data::wrap(head);
+        size_t left_bytes = Data::get_max_size() - pos;
+        // 跳过buffer尾部不满ItemHeader大小的字节
+        if (left_bytes < sizeof(ItemHeader))
+        {
+            head += left_bytes;
+            continue;
+        }
+
+        const ItemHeader *item_header = reinterpret_cast<const ItemHeader *>(Data::m_buf + pos);
+        if (item_header->m_flag == 1)
+        {
+            head += sizeof(ItemHeader) + item_header->m_len;
+            continue;
+        }
+
+        pos_ = head;
+        return true;
+    }
+}
+
+}  // namespace pepper
+
+#endif
@@ -0,0 +1,308 @@
+/*
+ * * file name: thread_cached_mem_pool.h
+ * * description: 多线程用的定长内存池，每个线程一个本地缓存，申请回收平时只动本地缓存
+ * *              本地缓存空了或者太多了，一次搬一批节点到共享的中央空闲链表，中央链表是无锁的
+ * *              中央链表也空了再去底下的FixedMemPool切一批新的出来，只有这一步要加锁
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _THREAD_CACHED_MEM_POOL_H_
+#define _THREAD_CACHED_MEM_POOL_H_
+
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include "const_var.h"
+#include "fixed_mem_pool.h"
+
+namespace pepper
+{
+namespace inner
+{
+/// 空闲节点自己的内存里面放m_next，串起一批里面的节点，这一批摘下来之后才会去读，不会和别的线程冲突
+/// 串起中央链表上的批的指针不能放在节点里面，见ThreadCachedMemPool::m_batch_next
+struct ThreadCacheFreeNode
+{
+    uint32_t m_next;
+};
+}  // namespace inner
+
+/// 底下是位图布局的FixedMemPool，节点一旦切出来就不会还回去了，只在本地缓存和中央链表之间流转
+/// 所以不提供遍历，size也只有本地缓存自己的数，节点放在某个线程的本地缓存里面的时候，别的线程是拿不到的
+/// 跨进程用的时候要注意两点：
+/// 进程挂了的话它的LocalCache里面的节点就永远丢了，没有办法收回来，池子的容量要留出余量
+/// 切新节点的锁里面存的是拿锁的进程号，拿着锁的进程挂了，别的进程发现它不在了会把锁抢过来
+/// 它要是挂在切节点的中间，那一批节点也会丢掉，进程号刚好被新进程复用的话，要等新进程退出才能抢过来
+template <typename T, size_t ALIGN = alignof(size_t)>
+class ThreadCachedMemPool
+{
+    using PoolType = FixedMemPool<T, ALIGN, true>;
+    using FreeNode = inner::ThreadCacheFreeNode;
+
+public:
+    /// 本地缓存和中央链表之间一次搬的节点数
+    static constexpr size_t BATCH_NUM = 32;
+
+    /// 每个线程自己建一个，不能跨线程用，析构的时候把缓存的节点还给中央链表
+    class LocalCache
+    {
+    public:
+        explicit LocalCache(ThreadCachedMemPool& pool_) : m_pool(&pool_) {}
+        ~LocalCache() { flush(); }
+
+        /// 申请一个节点，整个池子都没有了返回nullptr
+        T* alloc(bool zero_ = true);
+        /// 回收一个节点，可以是别的线程申请的，不检查重复回收
+        bool free(const T* p_);
+        /// 把缓存的节点全部还给中央链表
+        void flush();
+        /// 本地缓存了多少个节点
+        size_t cached() const { return m_num; }
+
+    private:
+        LocalCache(const LocalCache&) = delete;
+        LocalCache& operator=(const LocalCache&) = delete;
+
+        ThreadCachedMemPool* m_pool;
+        size_t m_num = 0;
+        /// 最多缓存两批，满了还一批回去，留一批下次申请用，不会在一个边界上来回搬
+        uint32_t m_indexes[BATCH_NUM * 2];
+    };
+
+    static size_t calc_need_size(size_t max_node_num_);
+    /// 一个进程check_ == false初始化，其他的进程check_ == true挂上去，节点数不能超过32位
+    bool init(void* mem_, size_t mem_size_, size_t max_node_num_, bool check_ = false);
+    /// 最大节点个数
+    size_t capacity() const;
+    /// 节点大小，至少能放下空闲链表的指针
+    size_t node_size() const;
+    /// 节点指针和下标互转，下标[1, max_num]，0 表示失败
+    size_t ptr_2_int(const T* p_) const;
+    const T* int_2_ptr(size_t index_) const;
+    T* int_2_ptr(size_t index_);
+
+private:
+    struct Head
+    {
+        /// 中央空闲链表头，低32位是第一批的第一个节点的下标，高32位是版本号，每次修改都加一，防止ABA
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_central{0};
+        /// 从FixedMemPool切新节点的时候的锁，存的是拿着锁的进程号，0 表示没人拿着
+        alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_backend_lock{0};
+        size_t m_max_num = 0;
+        size_t m_mem_size = 0;
+    };
+
+    static constexpr size_t align_size(size_t size_)
+    {
+        return (size_ + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    }
+    static constexpr size_t real_node_size() { return sizeof(T) < sizeof(FreeNode) ? sizeof(FreeNode) : sizeof(T); }
+    static constexpr size_t batch_next_size(size_t max_node_num_)
+    {
+        return align_size(sizeof(uint32_t) * (max_node_num_ + 1));
+    }
+
+    /// 从中央链表拿一批放到indexes_里面，返回个数，中央链表是空的返回0
+    size_t pop_batch(uint32_t* indexes_);
+    /// 把num_个节点串成一批挂到中央链表上，num_不超过BATCH_NUM
+    void push_batch(const uint32_t* indexes_, size_t num_);
+    /// 从FixedMemPool切最多num_个新的节点，返回个数
+    size_t alloc_from_backend(uint32_t* indexes_, size_t num_);
+    FreeNode* free_node(uint32_t index_) { return reinterpret_cast<FreeNode*>(m_pool.int_2_ptr(index_)); }
+
+    Head* m_head = nullptr;
+    /// 下标是一批的第一个节点，串起中央链表上的批，和节点分开放
+    /// pop_batch读的时候这个节点可能已经被别的线程拿走当T写了，放在节点里面的话就是数据竞争
+    uint32_t* m_batch_next = nullptr;
+    PoolType m_pool;
+};
+
+template <typename T, size_t ALIGN>
+size_t ThreadCachedMemPool<T, ALIGN>::calc_need_size(size_t max_node_num_)
+{
+    return align_size(sizeof(Head)) + batch_next_size(max_node_num_) +
+           PoolType::calc_need_size(max_node_num_, real_node_size());
+}
+
+template <typename T, size_t ALIGN>
+bool ThreadCachedMemPool<T, ALIGN>::init(void* mem_, size_t mem_size_, size_t max_node_num_, bool check_)
+{
+    if (!mem_ || max_node_num_ == 0 || max_node_num_ >= MAX_UINT32 || mem_size_ != calc_need_size(max_node_num_))
+        return false;
+
+    Head* head = reinterpret_cast<Head*>(mem_);
+    uint32_t* batch_next = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(mem_) + align_size(sizeof(Head)));
+    if (check_)
+    {
+        if (head->m_max_num != max_node_num_ || head->m_mem_size != mem_size_)
+            return false;
+    }
+    else
+    {
+        new (head) Head();
+        head->m_max_num = max_node_num_;
+        head->m_mem_size = mem_size_;
+        memset(batch_next, 0, batch_next_size(max_node_num_));
+    }
+
+    size_t pool_offset = align_size(sizeof(Head)) + batch_next_size(max_node_num_);
+    void* pool_mem = reinterpret_cast<uint8_t*>(mem_) + pool_offset;
+    if (!m_pool.init(pool_mem, mem_size_ - pool_offset, max_node_num_, real_node_size(), check_))
+        return false;
+
+    m_head = head;
+    m_batch_next = batch_next;
+    return true;
+}
+
+template <typename T, size_t ALIGN>
+size_t ThreadCachedMemPool<T, ALIGN>::capacity() const
+{
+    return m_head->m_max_num;
+}
+
+template <typename T, size_t ALIGN>
+size_t ThreadCachedMemPool<T, ALIGN>::node_size() const
+{
+    return m_pool.node_size();
+}
+
+template <typename T, size_t ALIGN>
+size_t ThreadCachedMemPool<T, ALIGN>::ptr_2_int(const T* p_) const
+{
+    return m_pool.ptr_2_int(p_);
+}
+
+template <typename T, size_t ALIGN>
+const T* ThreadCachedMemPool<T, ALIGN>::int_2_ptr(size_t index_) const
+{
+    return m_pool.int_2_ptr(index_);
+}
+
+template <typename T, size_t ALIGN>
+T* ThreadCachedMemPool<T, ALIGN>::int_2_ptr(size_t index_)
+{
+    return m_pool.int_2_ptr(index_);
+}
+
+template <typename T, size_t ALIGN>
+size_t ThreadCachedMemPool<T, ALIGN>::pop_batch(uint32_t* indexes_)
+{
+    uint64_t head = m_head->m_central.load(std::memory_order_acquire);
+    uint32_t first = 0;
+    while (true)
+    {
+        first = static_cast<uint32_t>(head);
+        if (first == 0)
+            return 0;
+        // 这一批有可能已经被别的线程拿走又挂回来了，读到的是旧的值，但是版本号变了，下面的CAS一定会失败
+        uint32_t next = __atomic_load_n(&m_batch_next[first], __ATOMIC_RELAXED);
+        uint64_t new_head = (((head >> 32) + 1) << 32) | next;
+        if (m_head->m_central.compare_exchange_weak(head, new_head, std::memory_order_acquire,
+                                                    std::memory_order_acquire))
+            break;
+    }
+
+    // 摘下来之后这一批只有自己能看到了
+    size_t num = 0;
+    for (uint32_t index = first; index != 0; index = free_node(index)->m_next)
+        indexes_[num++] = index;
+    assert(num <= BATCH_NUM);
+    return num;
+}
+
+template <typename T, size_t ALIGN>
+void ThreadCachedMemPool<T, ALIGN>::push_batch(const uint32_t* indexes_, size_t num_)
+{
+    assert(num_ > 0 && num_ <= BATCH_NUM);
+    for (size_t i = 0; i + 1 < num_; ++i)
+        free_node(indexes_[i])->m_next = indexes_[i + 1];
+    free_node(indexes_[num_ - 1])->m_next = 0;
+
+    uint64_t head = m_head->m_central.load(std::memory_order_relaxed);
+    while (true)
+    {
+        __atomic_store_n(&m_batch_next[indexes_[0]], static_cast<uint32_t>(head), __ATOMIC_RELAXED);
+        uint64_t new_head = (((head >> 32) + 1) << 32) | indexes_[0];
+        if (m_head->m_central.compare_exchange_weak(head, new_head, std::memory_order_release,
+                                                    std::memory_order_relaxed))
+            break;
+    }
+}
+
+template <typename T, size_t ALIGN>
+size_t ThreadCachedMemPool<T, ALIGN>::alloc_from_backend(uint32_t* indexes_, size_t num_)
+{
+    uint32_t self = static_cast<uint32_t>(getpid());
+    uint32_t owner = 0;
+    while (!m_head->m_backend_lock.compare_exchange_weak(owner, self, std::memory_order_acquire))
+    {
+        // 拿着锁的进程已经不在了，锁永远不会放了，下一次CAS直接从它手上抢过来
+        if (owner != 0 && owner != self && kill(static_cast<pid_t>(owner), 0) != 0 && errno == ESRCH)
+            continue;
+        owner = 0;
+        std::this_thread::yield();
+    }
+
+    size_t num = 0;
+    for (; num < num_; ++num)
+    {
+        T* p = m_pool.alloc(false);
+        if (!p)
+            break;
+        indexes_[num] = static_cast<uint32_t>(m_pool.ptr_2_int(p));
+    }
+
+    m_head->m_backend_lock.store(0, std::memory_order_release);
+    return num;
+}
+
+template <typename T, size_t ALIGN>
+T* ThreadCachedMemPool<T, ALIGN>::LocalCache::alloc(bool zero_)
+{
+    if (m_num == 0)
+    {
+        m_num = m_pool->pop_batch(m_indexes);
+        if (m_num == 0)
+            m_num = m_pool->alloc_from_backend(m_indexes, BATCH_NUM);
+        if (m_num == 0)
+            return nullptr;
+    }
+
+    T* p = m_pool->int_2_ptr(m_indexes[--m_num]);
+    if (zero_)
+        memset(static_cast<void*>(p), 0, m_pool->node_size());
+    return p;
+}
+
+template <typename T, size_t ALIGN>
+bool ThreadCachedMemPool<T, ALIGN>::LocalCache::free(const T* p_)
+{
+    size_t index = m_pool->ptr_2_int(p_);
+    if (index == 0 || index > m_pool->capacity())
+        return false;
+
+    if (m_num == BATCH_NUM * 2)
+    {
+        m_pool->push_batch(m_indexes + BATCH_NUM, BATCH_NUM);
+        m_num = BATCH_NUM;
+    }
+    m_indexes[m_num++] = static_cast<uint32_t>(index);
+    return true;
+}
+
+template <typename T, size_t ALIGN>
+void ThreadCachedMemPool<T, ALIGN>::LocalCache::flush()
+{
+    for (size_t i = 0; i < m_num; i += BATCH_NUM)
+        m_pool->push_batch(m_indexes + i, m_num - i < BATCH_NUM ? m_num - i : BATCH_NUM);
+    m_num = 0;
+}
+
+}  // namespace pepper
+
+#endif
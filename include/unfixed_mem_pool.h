@@ -0,0 +1,464 @@
+/*
+ * * file name: unfixed_mem_pool.h
+ * * description: 变长内存池，一整块内存切成同样大小的slab，每个slab按需要分给一个大小档位
+ * *              slab里面就是一个位图布局的FixedMemPool，申请回收都是O(1)
+ * *              超过最大档位的直接分连续的几个整slab，要扫一遍slab头找连续的空闲slab
+ * *              对外只给相对内存块开头的偏移，整块内存搬走或者映射到别的地址都还能用
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _UNFIXED_MEM_POOL_H_
+#define _UNFIXED_MEM_POOL_H_
+
+#include <cstring>
+#include "const_var.h"
+#include "fixed_mem_pool.h"
+
+namespace pepper
+{
+/// 每个大小档位的统计，整slab分出去的大块也用这个，节点大小是slab大小
+struct UnFixedMemPoolStat
+{
+    /// 这个档位的节点大小
+    size_t node_size = 0;
+    /// 一个slab能放多少个节点，0 表示slab太小，这个档位不能用
+    size_t nodes_per_slab = 0;
+    /// 分给这个档位的slab个数
+    size_t slab_num = 0;
+    /// 在用的节点个数
+    size_t used_num = 0;
+    /// 累计申请、回收、申请失败的次数
+    size_t alloc_times = 0;
+    size_t free_times = 0;
+    size_t fail_times = 0;
+};
+
+/// 大小档位：8到64每8个字节一档，往上每个2的幂之间分4档，最大16K，64字节以上浪费的不超过20%
+/// 一个slab放不下MIN_NODES_PER_SLAB个节点的档位不用，更大的申请按整slab向上取整分连续的slab
+/// 不是线程安全的，和FixedMemPool一样要调用者自己加锁
+template <size_t ALIGN = alignof(size_t)>
+class UnFixedMemPool
+{
+    using SlabPool = FixedMemPool<uint8_t, ALIGN, true>;
+
+public:
+    /// 档位个数
+    static constexpr size_t CLASS_NUM = 40;
+
+    static constexpr size_t class_size(size_t class_index_)
+    {
+        if (class_index_ < 8)
+            return (class_index_ + 1) * 8;
+        size_t base = size_t(64) << ((class_index_ - 8) / 4);
+        return base + base / 4 * ((class_index_ - 8) % 4 + 1);
+    }
+    /// bytes_ 落在哪个档位，超过最大的档位返回CLASS_NUM
+    static constexpr size_t class_index(size_t bytes_)
+    {
+        if (bytes_ <= 64)
+            return bytes_ == 0 ? 0 : (bytes_ - 1) / 8;
+        size_t power = floor_pow_of_two(bytes_ - 1);
+        size_t group = 63 - __builtin_clzll(power) - 6;
+        size_t index = 8 + group * 4 + (bytes_ - 1 - power) / (power / 4);
+        return index < CLASS_NUM ? index : CLASS_NUM;
+    }
+
+    /// slab_size_ 是2的幂，大的档位一个slab至少要能放4个节点，放不下的档位不能用
+    static size_t calc_need_size(size_t slab_num_, size_t slab_size_);
+
+    UnFixedMemPool() = default;
+
+    /// 一个进程check_ == false初始化，其他的进程check_ == true挂上去
+    bool init(void* mem_, size_t mem_size_, size_t slab_num_, size_t slab_size_, bool check_ = false);
+    /// 挂到已经初始化过的内存上，参数从头部读出来，只知道内存地址的时候用，比如ShmAllocator
+    bool attach(void* mem_);
+    /// 申请bytes_个字节，返回相对内存块开头的偏移，按ALIGN对齐，失败返回0
+    /// 超过max_alloc_size()的按整slab分，找不到足够多连续的空闲slab也会失败
+    size_t alloc(size_t bytes_);
+    /// 回收alloc返回的偏移，重复回收或者不是alloc返回的偏移返回false
+    bool free(size_t offset_);
+    /// 清空，所有的slab都还回去
+    void clear();
+
+    /// 偏移和本进程地址互转
+    void* offset_2_ptr(size_t offset_);
+    const void* offset_2_ptr(size_t offset_) const;
+    size_t ptr_2_offset(const void* p_) const;
+
+    /// 走档位能申请的最大字节数，再大的就是整slab分了
+    size_t max_alloc_size() const;
+    /// slab个数、大小和还没分出去的slab个数
+    size_t slab_num() const { return m_header->slab_num; }
+    size_t slab_size() const { return m_header->slab_size; }
+    size_t free_slab_num() const { return m_header->free_slab_num; }
+    /// 每个档位的统计
+    const UnFixedMemPoolStat& stat(size_t class_index_) const { return m_header->classes[class_index_].stat; }
+    /// 整slab分出去的大块的统计，slab_num是大块占的slab个数，used_num是大块个数
+    const UnFixedMemPoolStat& large_stat() const { return m_header->large; }
+
+private:
+    /// slab的下标都是从1开始的，0 表示没有
+    struct SlabHead
+    {
+        /// 分给了哪个档位，没分出去是CLASS_NUM，大块的第一个slab是LARGE_HEAD，后面的是LARGE_BODY
+        uint32_t class_index;
+        /// 同一个档位还有空闲节点的slab、没分出去的slab各自串成双向链表
+        /// 大块的第一个slab的next是占了几个slab
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    struct ClassHead
+    {
+        /// 还有空闲节点的slab链表头
+        uint32_t partial;
+        UnFixedMemPoolStat stat;
+    };
+
+    struct MemHeader
+    {
+        size_t magic_num;
+        size_t mem_size;
+        size_t slab_num;
+        size_t slab_size;
+        /// 第一个slab的偏移
+        size_t slab_offset;
+        size_t free_slab_num;
+        uint32_t free_slab;
+        ClassHead classes[CLASS_NUM];
+        UnFixedMemPoolStat large;
+    };
+
+    static size_t slab_offset(size_t slab_num_)
+    {
+        return (sizeof(MemHeader) + sizeof(SlabHead) * slab_num_ + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE *
+               CACHE_LINE_SIZE;
+    }
+    static size_t nodes_per_slab(size_t node_size_, size_t slab_size_);
+
+    SlabHead* slab_head(size_t slab_);
+    uint8_t* slab_mem(size_t slab_);
+    /// 把pool_挂到slab上，只是一个视图，FixedMemPool里面存的都是slab里面的偏移
+    void attach_slab(size_t slab_, SlabPool& pool_);
+    /// 从档位的partial链表或者空闲slab链表上摘下来、挂上去
+    void unlink_slab(uint32_t& list_, size_t slab_);
+    void link_slab(uint32_t& list_, size_t slab_);
+    /// 分连续的slab_num_个slab给一个大块，返回第一个slab，没有返回0
+    size_t alloc_large(size_t slab_num_);
+
+    static const size_t HEADER_MAGIC_NUM = 0x9E370101;
+    static const uint32_t LARGE_HEAD = CLASS_NUM + 1;
+    static const uint32_t LARGE_BODY = CLASS_NUM + 2;
+    /// 最大的档位一个slab至少放这么多个节点
+    static const size_t MIN_NODES_PER_SLAB = 4;
+
+    UnFixedMemPool(const UnFixedMemPool&) = delete;
+    UnFixedMemPool& operator=(const UnFixedMemPool&) = delete;
+
+    MemHeader* m_header = nullptr;
+};
+
+template <size_t ALIGN>
+size_t UnFixedMemPool<ALIGN>::calc_need_size(size_t slab_num_, size_t slab_size_)
+{
+    return slab_offset(slab_num_) + slab_num_ * slab_size_;
+}
+
+template <size_t ALIGN>
+size_t UnFixedMemPool<ALIGN>::nodes_per_slab(size_t node_size_, size_t slab_size_)
+{
+    size_t num = slab_size_ / node_size_;
+    while (num >= MIN_NODES_PER_SLAB && SlabPool::calc_need_size(num, node_size_) > slab_size_)
+        --num;
+    return num >= MIN_NODES_PER_SLAB ? num : 0;
+}
+
+template <size_t ALIGN>
+bool UnFixedMemPool<ALIGN>::init(void* mem_, size_t mem_size_, size_t slab_num_, size_t slab_size_, bool check_)
+{
+    if (!mem_ || slab_num_ == 0 || slab_num_ >= MAX_UINT32 || !is_pow_of_two(slab_size_) ||
+        mem_size_ != calc_need_size(slab_num_, slab_size_))
+        return false;
+
+    MemHeader* header = reinterpret_cast<MemHeader*>(mem_);
+    if (check_)
+    {
+        if (header->magic_num != HEADER_MAGIC_NUM || header->mem_size != mem_size_ ||
+            header->slab_num != slab_num_ || header->slab_size != slab_size_)
+            return false;
+        m_header = header;
+        return true;
+    }
+
+    memset(static_cast<void*>(header), 0, sizeof(MemHeader));
+    header->magic_num = HEADER_MAGIC_NUM;
+    header->mem_size = mem_size_;
+    header->slab_num = slab_num_;
+    header->slab_size = slab_size_;
+    header->slab_offset = slab_offset(slab_num_);
+    for (size_t i = 0; i < CLASS_NUM; ++i)
+    {
+        UnFixedMemPoolStat& stat = header->classes[i].stat;
+        stat.node_size = (class_size(i) + ALIGN - 1) & ~(ALIGN - 1);
+        stat.nodes_per_slab = nodes_per_slab(stat.node_size, slab_size_);
+    }
+    header->large.node_size = slab_size_;
+    header->large.nodes_per_slab = 1;
+    m_header = header;
+    clear();
+    return true;
+}
+
+template <size_t ALIGN>
+bool UnFixedMemPool<ALIGN>::attach(void* mem_)
+{
+    MemHeader* header = reinterpret_cast<MemHeader*>(mem_);
+    if (!header || header->magic_num != HEADER_MAGIC_NUM)
+        return false;
+    m_header = header;
+    return true;
+}
+
+template <size_t ALIGN>
+void UnFixedMemPool<ALIGN>::clear()
+{
+    // 所有的slab串到空闲链表上，按下标顺序分出去
+    for (size_t i = 0; i < CLASS_NUM; ++i)
+    {
+        ClassHead& class_head = m_header->classes[i];
+        class_head.partial = 0;
+        class_head.stat.slab_num = 0;
+        class_head.stat.used_num = 0;
+    }
+    m_header->large.slab_num = 0;
+    m_header->large.used_num = 0;
+    for (size_t slab = 1; slab <= m_header->slab_num; ++slab)
+    {
+        SlabHead* head = slab_head(slab);
+        head->class_index = CLASS_NUM;
+        head->prev = static_cast<uint32_t>(slab - 1);
+        head->next = slab < m_header->slab_num ? static_cast<uint32_t>(slab + 1) : 0;
+    }
+    m_header->free_slab = 1;
+    m_header->free_slab_num = m_header->slab_num;
+}
+
+template <size_t ALIGN>
+size_t UnFixedMemPool<ALIGN>::alloc(size_t bytes_)
+{
+    size_t index = class_index(bytes_);
+    if (index >= CLASS_NUM || m_header->classes[index].stat.nodes_per_slab == 0)
+    {
+        size_t slab = alloc_large(bytes_ / m_header->slab_size + (bytes_ % m_header->slab_size != 0));
+        return slab == 0 ? 0 : ptr_2_offset(slab_mem(slab));
+    }
+
+    ClassHead& class_head = m_header->classes[index];
+    size_t slab = class_head.partial;
+    if (slab == 0)
+    {
+        // 这个档位没有空闲节点了，分一个新的slab过来
+        slab = m_header->free_slab;
+        if (slab == 0)
+        {
+            ++class_head.stat.fail_times;
+            return 0;
+        }
+        unlink_slab(m_header->free_slab, slab);
+        --m_header->free_slab_num;
+        slab_head(slab)->class_index = static_cast<uint32_t>(index);
+
+        SlabPool pool;
+        size_t nodes = class_head.stat.nodes_per_slab;
+        pool.init(slab_mem(slab), SlabPool::calc_need_size(nodes, class_head.stat.node_size), nodes,
+                  class_head.stat.node_size);
+        link_slab(class_head.partial, slab);
+        ++class_head.stat.slab_num;
+    }
+
+    SlabPool pool;
+    attach_slab(slab, pool);
+    uint8_t* p = pool.alloc(false);
+    assert(p);
+    if (pool.full())
+        unlink_slab(class_head.partial, slab);
+
+    ++class_head.stat.used_num;
+    ++class_head.stat.alloc_times;
+    return ptr_2_offset(p);
+}
+
+template <size_t ALIGN>
+bool UnFixedMemPool<ALIGN>::free(size_t offset_)
+{
+    if (offset_ < m_header->slab_offset || offset_ >= m_header->mem_size)
+        return false;
+    size_t slab = (offset_ - m_header->slab_offset) / m_header->slab_size + 1;
+    SlabHead* head = slab_head(slab);
+    size_t index = head->class_index;
+    if (index == LARGE_HEAD)
+    {
+        // 大块只能从第一个slab的开头回收，后面的slab一个一个还回去
+        if (offset_ != ptr_2_offset(slab_mem(slab)))
+            return false;
+        size_t num = head->next;
+        for (size_t i = 0; i < num; ++i)
+        {
+            slab_head(slab + i)->class_index = CLASS_NUM;
+            link_slab(m_header->free_slab, slab + i);
+        }
+        m_header->free_slab_num += num;
+        m_header->large.slab_num -= num;
+        --m_header->large.used_num;
+        ++m_header->large.free_times;
+        return true;
+    }
+    if (index >= CLASS_NUM)
+        return false;
+
+    // 位图会挡住重复回收和不在节点开头的偏移
+    SlabPool pool;
+    attach_slab(slab, pool);
+    bool was_full = pool.full();
+    uint8_t* p = reinterpret_cast<uint8_t*>(offset_2_ptr(offset_));
+    if (!pool.free(p))
+        return false;
+
+    ClassHead& class_head = m_header->classes[index];
+    --class_head.stat.used_num;
+    ++class_head.stat.free_times;
+    if (pool.empty())
+    {
+        // 整个slab都空了，还回去给别的档位用
+        if (!was_full)
+            unlink_slab(class_head.partial, slab);
+        head->class_index = CLASS_NUM;
+        link_slab(m_header->free_slab, slab);
+        ++m_header->free_slab_num;
+        --class_head.stat.slab_num;
+    }
+    else if (was_full)
+    {
+        link_slab(class_head.partial, slab);
+    }
+    return true;
+}
+
+template <size_t ALIGN>
+void* UnFixedMemPool<ALIGN>::offset_2_ptr(size_t offset_)
+{
+    return reinterpret_cast<uint8_t*>(m_header) + offset_;
+}
+
+template <size_t ALIGN>
+const void* UnFixedMemPool<ALIGN>::offset_2_ptr(size_t offset_) const
+{
+    return reinterpret_cast<const uint8_t*>(m_header) + offset_;
+}
+
+template <size_t ALIGN>
+size_t UnFixedMemPool<ALIGN>::ptr_2_offset(const void* p_) const
+{
+    return reinterpret_cast<const uint8_t*>(p_) - reinterpret_cast<const uint8_t*>(m_header);
+}
+
+template <size_t ALIGN>
+size_t UnFixedMemPool<ALIGN>::max_alloc_size() const
+{
+    for (size_t i = CLASS_NUM; i > 0; --i)
+    {
+        if (m_header->classes[i - 1].stat.nodes_per_slab != 0)
+            return class_size(i - 1);
+    }
+    return 0;
+}
+
+template <size_t ALIGN>
+typename UnFixedMemPool<ALIGN>::SlabHead* UnFixedMemPool<ALIGN>::slab_head(size_t slab_)
+{
+    assert(slab_ > 0 && slab_ <= m_header->slab_num);
+    return reinterpret_cast<SlabHead*>(reinterpret_cast<uint8_t*>(m_header) + sizeof(MemHeader)) + (slab_ - 1);
+}
+
+template <size_t ALIGN>
+uint8_t* UnFixedMemPool<ALIGN>::slab_mem(size_t slab_)
+{
+    return reinterpret_cast<uint8_t*>(m_header) + m_header->slab_offset + (slab_ - 1) * m_header->slab_size;
+}
+
+template <size_t ALIGN>
+void UnFixedMemPool<ALIGN>::attach_slab(size_t slab_, SlabPool& pool_)
+{
+    const UnFixedMemPoolStat& stat = m_header->classes[slab_head(slab_)->class_index].stat;
+    bool ret = pool_.init(slab_mem(slab_), SlabPool::calc_need_size(stat.nodes_per_slab, stat.node_size),
+                          stat.nodes_per_slab, stat.node_size, true);
+    assert(ret);
+    (void)ret;
+}
+
+template <size_t ALIGN>
+void UnFixedMemPool<ALIGN>::unlink_slab(uint32_t& list_, size_t slab_)
+{
+    SlabHead* head = slab_head(slab_);
+    if (head->prev != 0)
+        slab_head(head->prev)->next = head->next;
+    else
+        list_ = head->next;
+    if (head->next != 0)
+        slab_head(head->next)->prev = head->prev;
+    head->prev = 0;
+    head->next = 0;
+}
+
+template <size_t ALIGN>
+void UnFixedMemPool<ALIGN>::link_slab(uint32_t& list_, size_t slab_)
+{
+    SlabHead* head = slab_head(slab_);
+    head->prev = 0;
+    head->next = list_;
+    if (list_ != 0)
+        slab_head(list_)->prev = static_cast<uint32_t>(slab_);
+    list_ = static_cast<uint32_t>(slab_);
+}
+
+template <size_t ALIGN>
+size_t UnFixedMemPool<ALIGN>::alloc_large(size_t slab_num_)
+{
+    // 大块不常有，直接按下标扫一遍找第一段够长的连续空闲slab
+    size_t first = 0;
+    if (slab_num_ <= m_header->free_slab_num)
+    {
+        size_t run = 0;
+        for (size_t slab = 1; slab <= m_header->slab_num; ++slab)
+        {
+            run = slab_head(slab)->class_index == CLASS_NUM ? run + 1 : 0;
+            if (run == slab_num_)
+            {
+                first = slab + 1 - slab_num_;
+                break;
+            }
+        }
+    }
+    if (first == 0)
+    {
+        ++m_header->large.fail_times;
+        return 0;
+    }
+
+    for (size_t slab = first; slab < first + slab_num_; ++slab)
+    {
+        unlink_slab(m_header->free_slab, slab);
+        slab_head(slab)->class_index = slab == first ? LARGE_HEAD : LARGE_BODY;
+    }
+    slab_head(first)->next = static_cast<uint32_t>(slab_num_);
+    m_header->free_slab_num -= slab_num_;
+    m_header->large.slab_num += slab_num_;
+    ++m_header->large.used_num;
+    ++m_header->large.alloc_times;
+    return first;
+}
+
+}  // namespace pepper
+
+#endif
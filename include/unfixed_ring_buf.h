@@ -17,7 +17,36 @@ namespace pepper
 template <size_t MAX_SIZE = 0>
 class UnfixedRingBuf : public inner::UnfixedRingBufData<MAX_SIZE>
 {
+    using Data = inner::UnfixedRingBufData<MAX_SIZE>;
+    using IntType = typename Data::IntType;
+
 public:
+    /// 从队头往队尾遍历的游标，队列有写入或者弹出之后就失效了
+    class Iterator
+    {
+        friend class UnfixedRingBuf;
+        const UnfixedRingBuf *m_ring_buf = nullptr;
+        /// 当前元素ItemHeader的位置
+        IntType m_pos = 0;
+        /// 包括当前元素，还剩多少个元素
+        size_t m_left_num = 0;
+        Iterator(const UnfixedRingBuf *ring_buf_, IntType pos_, size_t left_num_)
+            : m_ring_buf(ring_buf_), m_pos(pos_), m_left_num(left_num_)
+        {
+        }
+
+    public:
+        Iterator() = default;
+        /// 当前元素的数据
+        const uint8_t *data() const;
+        /// 当前元素的数据长度
+        size_t len() const;
+        bool operator==(const Iterator &right_) const;
+        bool operator!=(const Iterator &right_) const;
+        Iterator &operator++();
+        Iterator operator++(int);
+    };
+
     /// 清空队列
     void clear();
     /// 队列是否空
@@ -33,19 +62,31 @@ public:
     /// 队尾入队
     bool push(const uint8_t *data_, size_t len_, bool over_write_ = false);
     bool push(const struct iovec *iov_, size_t iov_cnt_, bool over_write_ = false);
+    /// 在队尾预留len_个字节，返回可以直接写入的地址，失败返回nullptr，写完之后调用commit入队
+    /// 在commit之前不能有其他的写操作，不commit的话预留的这段数据不会入队
+    /// 但是预留的时候已经做了的不会撤销：尾部放不下绕回去的时候会先写一个padding，over_write_ == true 还会弹掉老数据
+    uint8_t *reserve(size_t len_, bool over_write_ = false);
+    /// 把reserve预留的空间入队，len_是实际写入的长度，不能大于预留的长度
+    bool commit(size_t len_);
     /// 队头弹出一个
     void pop();
     /// 获取队头往后数第index_个元素(从0开始计数)，返回该元素的指针，len_表示数据长度
     const uint8_t *front(size_t &len_, size_t index_ = 0) const;
     uint8_t *front(size_t &len_, size_t index_ = 0);
+    /// 队头弹出num_个，start、used和num只修改一次，返回真正弹出的个数
+    size_t pop_n(size_t num_);
+    /// 从队头开始最多处理max_num_个元素，func_(const uint8_t *data, size_t len)返回false表示不处理这个元素了
+    /// 处理完的元素一次性弹出，返回处理了多少个
+    template <typename FUNC>
+    size_t consume(FUNC &&func_, size_t max_num_);
+    /// 遍历的游标
+    const Iterator begin() const;
+    const Iterator end() const;
 
 private:
-    using Data = inner::UnfixedRingBufData<MAX_SIZE>;
-    using IntType = typename Data::IntType;
-
     struct ItemHeader
     {
-        /// 0 表示数据节点，1 表示填充用的
+        /// 0 表示数据节点，1 表示填充用的，2 表示reserve了还没有commit的
         uint8_t m_flag = 0;
         /// 后面的数据长度
         IntType m_len = 0;
@@ -53,13 +94,16 @@ private:
 
     /// 找不到就返回MAX_SIZE
     IntType find_start(size_t index_) const;
-    bool push_impl(const struct iovec *iov_, size_t iov_cnt_, size_t total_len_, size_t need_len_, bool over_write_);
+    /// 保证队尾有need_len_个字节的连续空间，需要的话会补填充节点或者覆盖旧数据
+    bool reserve_impl(size_t need_len_, bool over_write_);
     /// 在尾部补一个节点到补满
     void push_padding();
     /// 把填充用的节点弹出
     void pop_padding();
     /// 跳过buffer尾部不满ItemHeader大小的字节
     IntType need_skip_bytes(IntType cur_pos_) const;
+    /// 下一个元素的位置，会跳过尾部的字节和填充节点
+    IntType next_item(IntType item_start_) const;
 };
 
 template <size_t MAX_SIZE>
@@ -118,10 +162,54 @@ bool UnfixedRingBuf<MAX_SIZE>::push(const struct iovec *iov_, size_t iov_cnt_, b
     for (size_t i = 0; i < iov_cnt_; ++i)
         total_len += iov_[i].iov_len;
 
-    size_t need_len = total_len + sizeof(ItemHeader);
-    if (need_len > Data::get_max_size())
+    uint8_t *begin = reserve(total_len, over_write_);
+    if (begin == nullptr)
+        return false;
+
+    for (size_t i = 0; i < iov_cnt_; ++i)
+    {
+        std::memcpy(begin, iov_[i].iov_base, iov_[i].iov_len);
+        begin += iov_[i].iov_len;
+    }
+    return commit(total_len);
+}
+
+template <size_t MAX_SIZE>
+uint8_t *UnfixedRingBuf<MAX_SIZE>::reserve(size_t len_, bool over_write_)
+{
+    size_t need_len = len_ + sizeof(ItemHeader);
+    if (need_len > Data::get_max_size() || !reserve_impl(need_len, over_write_))
+        return nullptr;
+
+    ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + Data::get_end());
+    item_header->m_len = len_;
+    item_header->m_flag = 2;
+    return reinterpret_cast<uint8_t *>(item_header + 1);
+}
+
+template <size_t MAX_SIZE>
+bool UnfixedRingBuf<MAX_SIZE>::commit(size_t len_)
+{
+    // 队尾的位置一定放得下一个ItemHeader，如果是满的，这里是队头的数据节点，flag不会是2
+    ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + Data::get_end());
+    if (item_header->m_flag != 2 || len_ > item_header->m_len)
         return false;
-    return push_impl(iov_, iov_cnt_, total_len, need_len, over_write_);
+
+    item_header->m_len = len_;
+    item_header->m_flag = 0;
+
+    size_t need_len = len_ + sizeof(ItemHeader);
+    Data::set_end(Data::wrap(Data::get_end() + need_len));
+    Data::incr_used_size(need_len);
+    Data::incr_item_num();
+
+    IntType skip_bytes = need_skip_bytes(Data::get_end());
+    if (skip_bytes > 0)
+    {
+        Data::set_end(Data::wrap(Data::get_end() + skip_bytes));
+        Data::incr_used_size(skip_bytes);
+    }
+    return true;
 }
 
 template <size_t MAX_SIZE>
@@ -136,7 +224,7 @@ void UnfixedRingBuf<MAX_SIZE>::pop()
     ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + Data::get_start());
 
     assert(item_header->m_flag == 0);
-    Data::set_start((Data::get_start() + sizeof(ItemHeader) + item_header->m_len) % Data::get_max_size());
+    Data::set_start(Data::wrap(Data::get_start() + sizeof(ItemHeader) + item_header->m_len));
 
     assert(Data::get_used_size() >= (sizeof(ItemHeader) + item_header->m_len));
     Data::decr_used_size(sizeof(ItemHeader) + item_header->m_len);
@@ -147,7 +235,7 @@ void UnfixedRingBuf<MAX_SIZE>::pop()
     IntType skip_bytes = need_skip_bytes(Data::get_start());
     if (skip_bytes > 0)
     {
-        Data::set_start((Data::get_start() + skip_bytes) % Data::get_max_size());
+        Data::set_start(Data::wrap(Data::get_start() + skip_bytes));
         assert(Data::get_used_size() >= skip_bytes);
         Data::decr_used_size(skip_bytes);
     }
@@ -202,22 +290,7 @@ typename UnfixedRingBuf<MAX_SIZE>::IntType UnfixedRingBuf<MAX_SIZE>::find_start(
     IntType item_start = Data::get_start();
     for (size_t i = 0; i < index_; ++i)
     {
-        const ItemHeader *header = reinterpret_cast<const ItemHeader *>(Data::m_buf + item_start);
-        item_start = (item_start + sizeof(ItemHeader) + header->m_len) % Data::get_max_size();
-
-        IntType skip_bytes = need_skip_bytes(item_start);
-        if (skip_bytes > 0)
-            item_start = (item_start + skip_bytes) % Data::get_max_size();
-        else
-        {
-            if (item_start != Data::get_end())
-            {
-                const ItemHeader *padding_header = reinterpret_cast<const ItemHeader *>(Data::m_buf + item_start);
-                if (padding_header->m_flag == 1)
-                    item_start = (item_start + sizeof(ItemHeader) + padding_header->m_len) % Data::get_max_size();
-            }
-        }
-
+        item_start = next_item(item_start);
         // 找了一圈都找不到，理论上不应该
         if (item_start == Data::get_end())
             return Data::get_max_size();
@@ -226,8 +299,127 @@ typename UnfixedRingBuf<MAX_SIZE>::IntType UnfixedRingBuf<MAX_SIZE>::find_start(
 }
 
 template <size_t MAX_SIZE>
-bool UnfixedRingBuf<MAX_SIZE>::push_impl(const struct iovec *iov_, size_t iov_cnt_, size_t total_len_, size_t need_len_,
-                                         bool over_write_)
+typename UnfixedRingBuf<MAX_SIZE>::IntType UnfixedRingBuf<MAX_SIZE>::next_item(IntType item_start_) const
+{
+    const ItemHeader *header = reinterpret_cast<const ItemHeader *>(Data::m_buf + item_start_);
+    IntType item_start = Data::wrap(item_start_ + sizeof(ItemHeader) + header->m_len);
+
+    IntType skip_bytes = need_skip_bytes(item_start);
+    if (skip_bytes > 0)
+        item_start = Data::wrap(item_start + skip_bytes);
+    else
+    {
+        if (item_start != Data::get_end())
+        {
+            const ItemHeader *padding_header = reinterpret_cast<const ItemHeader *>(Data::m_buf + item_start);
+            if (padding_header->m_flag == 1)
+                item_start = Data::wrap(item_start + sizeof(ItemHeader) + padding_header->m_len);
+        }
+    }
+    return item_start;
+}
+
+template <size_t MAX_SIZE>
+size_t UnfixedRingBuf<MAX_SIZE>::pop_n(size_t num_)
+{
+    if (empty() || num_ == 0)
+        return 0;
+
+    if (num_ >= Data::get_item_num())
+    {
+        // 全部弹出，和pop一样修正一下start和end的位置
+        num_ = Data::get_item_num();
+        clear();
+        return num_;
+    }
+
+    IntType item_start = Data::get_start();
+    for (size_t i = 0; i < num_; ++i)
+        item_start = next_item(item_start);
+
+    // 还有元素剩下，所以不会刚好走了一圈
+    IntType pop_size = Data::wrap(item_start + Data::get_max_size() - Data::get_start());
+    assert(pop_size > 0 && Data::get_used_size() > pop_size);
+    Data::set_start(item_start);
+    Data::decr_used_size(pop_size);
+    Data::set_item_num(Data::get_item_num() - num_);
+    return num_;
+}
+
+template <size_t MAX_SIZE>
+template <typename FUNC>
+size_t UnfixedRingBuf<MAX_SIZE>::consume(FUNC &&func_, size_t max_num_)
+{
+    size_t num = 0;
+    for (auto iter = begin(); iter != end() && num < max_num_; ++iter, ++num)
+    {
+        if (!func_(iter.data(), iter.len()))
+            break;
+    }
+    return pop_n(num);
+}
+
+template <size_t MAX_SIZE>
+const typename UnfixedRingBuf<MAX_SIZE>::Iterator UnfixedRingBuf<MAX_SIZE>::begin() const
+{
+    if (empty())
+        return end();
+    return Iterator(this, Data::get_start(), Data::get_item_num());
+}
+
+template <size_t MAX_SIZE>
+const typename UnfixedRingBuf<MAX_SIZE>::Iterator UnfixedRingBuf<MAX_SIZE>::end() const
+{
+    return Iterator(this, 0, 0);
+}
+
+template <size_t MAX_SIZE>
+const uint8_t *UnfixedRingBuf<MAX_SIZE>::Iterator::data() const
+{
+    return m_ring_buf->m_buf + m_pos + sizeof(ItemHeader);
+}
+
+template <size_t MAX_SIZE>
+size_t UnfixedRingBuf<MAX_SIZE>::Iterator::len() const
+{
+    return reinterpret_cast<const ItemHeader *>(m_ring_buf->m_buf + m_pos)->m_len;
+}
+
+template <size_t MAX_SIZE>
+bool UnfixedRingBuf<MAX_SIZE>::Iterator::operator==(const Iterator &right_) const
+{
+    // 剩下的个数一样就是同一个位置
+    return (m_ring_buf == right_.m_ring_buf) && (m_left_num == right_.m_left_num);
+}
+
+template <size_t MAX_SIZE>
+bool UnfixedRingBuf<MAX_SIZE>::Iterator::operator!=(const Iterator &right_) const
+{
+    return !(*this == right_);
+}
+
+template <size_t MAX_SIZE>
+typename UnfixedRingBuf<MAX_SIZE>::Iterator &UnfixedRingBuf<MAX_SIZE>::Iterator::operator++()
+{
+    assert(m_left_num > 0);
+    --m_left_num;
+    if (m_left_num > 0)
+        m_pos = m_ring_buf->next_item(m_pos);
+    else
+        m_pos = 0;
+    return (*this);
+}
+
+template <size_t MAX_SIZE>
+typename UnfixedRingBuf<MAX_SIZE>::Iterator UnfixedRingBuf<MAX_SIZE>::Iterator::operator++(int)
+{
+    Iterator temp = (*this);
+    ++(*this);
+    return temp;
+}
+
+template <size_t MAX_SIZE>
+bool UnfixedRingBuf<MAX_SIZE>::reserve_impl(size_t need_len_, bool over_write_)
 {
     if (full())
     {
@@ -242,27 +434,7 @@ bool UnfixedRingBuf<MAX_SIZE>::push_impl(const struct iovec *iov_, size_t iov_cn
     {
         // 尾部能插入
         if (Data::get_end() + need_len_ <= Data::get_max_size())
-        {
-            ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + Data::get_end());
-            item_header->m_len = total_len_;
-            item_header->m_flag = 0;
-
-            uint8_t *begin = Data::m_buf + Data::get_end() + sizeof(ItemHeader);
-            for (size_t i = 0; i < iov_cnt_; ++i)
-            {
-                std::memcpy(begin, iov_[i].iov_base, iov_[i].iov_len);
-                begin += iov_[i].iov_len;
-            }
-
-            Data::set_end((Data::get_end() + need_len_) % Data::get_max_size());
-            Data::incr_used_size(need_len_);
-            Data::incr_item_num();
-
-            IntType skip_bytes = need_skip_bytes(Data::get_end());
-            Data::set_end((Data::get_end() + skip_bytes) % Data::get_max_size());
-            Data::incr_used_size(skip_bytes);
             return true;
-        }
 
         // 尾部空间不够，看循环过去start的前面空间够不够
         if (!over_write_ && Data::get_start() < need_len_)
@@ -275,29 +447,13 @@ bool UnfixedRingBuf<MAX_SIZE>::push_impl(const struct iovec *iov_, size_t iov_cn
                 pop();
         }
 
-        return push_impl(iov_, iov_cnt_, total_len_, need_len_, over_write_);
+        return reserve_impl(need_len_, over_write_);
     }
     else
     {
         // 尾部能插入
         if (Data::get_end() + need_len_ <= Data::get_start())
-        {
-            ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + Data::get_end());
-            item_header->m_len = total_len_;
-            item_header->m_flag = 0;
-
-            uint8_t *begin = Data::m_buf + Data::get_end() + sizeof(ItemHeader);
-            for (size_t i = 0; i < iov_cnt_; ++i)
-            {
-                std::memcpy(begin, iov_[i].iov_base, iov_[i].iov_len);
-                begin += iov_[i].iov_len;
-            }
-
-            Data::set_end(Data::get_end() + need_len_);
-            Data::incr_used_size(need_len_);
-            Data::incr_item_num();
             return true;
-        }
 
         // 不能覆盖，那一定放不下了
         if (!over_write_)
@@ -308,7 +464,7 @@ bool UnfixedRingBuf<MAX_SIZE>::push_impl(const struct iovec *iov_, size_t iov_cn
             while (Data::get_end() < Data::get_start() && Data::get_end() + need_len_ > Data::get_start())
                 pop();
             assert(Data::get_start() == 0 || Data::get_end() + need_len_ <= Data::get_start());
-            return push_impl(iov_, iov_cnt_, total_len_, need_len_, over_write_);
+            return reserve_impl(need_len_, over_write_);
         }
 
         do
@@ -319,7 +475,7 @@ bool UnfixedRingBuf<MAX_SIZE>::push_impl(const struct iovec *iov_, size_t iov_cn
         push_padding();
 
         assert(full());
-        return push_impl(iov_, iov_cnt_, total_len_, need_len_, over_write_);
+        return reserve_impl(need_len_, over_write_);
     }
 
     return false;
@@ -347,7 +503,7 @@ void UnfixedRingBuf<MAX_SIZE>::pop_padding()
     ItemHeader *item_header = reinterpret_cast<ItemHeader *>(Data::m_buf + Data::get_start());
     if (item_header->m_flag == 1)
     {
-        Data::set_start((Data::get_start() + sizeof(ItemHeader) + item_header->m_len) % Data::get_max_size());
+        Data::set_start(Data::wrap(Data::get_start() + sizeof(ItemHeader) + item_header->m_len));
         Data::decr_used_size(sizeof(ItemHeader) + item_header->m_len);
         assert(Data::get_used_size() >= 0);
     }
@@ -0,0 +1,24 @@
+/*
+ * * file name: futex.h
+ * * description: futex的简单封装，用的是非private的版本，放在共享内存上可以跨进程等待和唤醒
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _FUTEX_H_
+#define _FUTEX_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace pepper
+{
+/// *addr_ == expected_ 的时候睡眠，直到被唤醒或者超时，timeout_us_ < 0 表示一直等
+/// 被唤醒或者值已经变了返回true，超时返回false
+extern bool futex_wait(std::atomic<uint32_t> *addr_, uint32_t expected_, int64_t timeout_us_ = -1);
+/// 最多唤醒num_个在addr_上等待的线程，返回唤醒的个数
+extern int futex_wake(std::atomic<uint32_t> *addr_, int num_);
+
+}  // namespace pepper
+
+#endif
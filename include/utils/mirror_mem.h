@@ -0,0 +1,52 @@
+/*
+ * * file name: mirror_mem.h
+ * * description: 用memfd创建的一段共享内存，头部映射一次，数据部分背靠背映射两次
+ * *              data()[i] 和 data()[i + size()] 是同一个字节，跨过尾部的读写在虚拟地址上是连续的
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _MIRROR_MEM_H_
+#define _MIRROR_MEM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pepper
+{
+class MirrorMem
+{
+public:
+    MirrorMem() = default;
+    ~MirrorMem();
+    MirrorMem(const MirrorMem &) = delete;
+    MirrorMem &operator=(const MirrorMem &) = delete;
+
+    /// 创建head_size_ + size_大小的memfd并映射，两个大小都会向上取整到页大小
+    bool create(size_t head_size_, size_t size_, const char *name_ = "pepper_mirror");
+    /// 用别的进程传过来的fd按同样的布局映射，fd_会被dup一份，调用者自己的fd_还需要自己关闭
+    bool attach(int fd_, size_t head_size_);
+    /// 解除映射并关闭fd
+    void destroy();
+
+    uint8_t *head() const { return m_addr; }
+    uint8_t *data() const { return m_addr ? m_addr + m_head_size : nullptr; }
+    size_t head_size() const { return m_head_size; }
+    /// 数据部分的实际大小，不包括镜像的部分
+    size_t size() const { return m_size; }
+    int fd() const { return m_fd; }
+
+    static size_t page_align(size_t size_);
+
+private:
+    bool map(int fd_, size_t head_size_, size_t size_);
+
+    uint8_t *m_addr = nullptr;
+    size_t m_head_size = 0;
+    size_t m_size = 0;
+    int m_fd = -1;
+};
+
+}  // namespace pepper
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * * file name: shm_directory.h
+ * * description: 一整块共享内存的目录，按名字记下每个容器的类型、版本、偏移和大小
+ * *              容器的内存从目录后面顺序分，进程挂上来一次之后按名字O(1)找到每个容器
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SHM_DIRECTORY_H_
+#define _SHM_DIRECTORY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "const_var.h"
+
+namespace pepper
+{
+struct ShmDirEntry
+{
+    static const size_t MAX_NAME_LEN = 47;
+
+    /// 空串表示这个槽没有用
+    char name[MAX_NAME_LEN + 1];
+    /// 调用者自己定义的容器类型，挂上来的时候类型不对就不给
+    uint32_t type_tag;
+    /// 容器的版本，结构改了换一个版本号，老的数据就挂不上来了
+    uint32_t version;
+    /// 相对目录开头的偏移
+    size_t offset;
+    size_t size;
+};
+
+/// 开放寻址的哈希表，槽的个数是最大条目数两倍向上取整到2的幂
+/// 容器的内存只分不回收，条目也不能删，整个目录重建的时候init一下就清空了
+/// 不是线程安全的，一般是启动的时候一个进程建好，别的进程挂上来只读
+class ShmDirectory
+{
+public:
+    /// 每块容器内存按缓存行对齐，算总大小的时候每块都要先过一下这个
+    static size_t align_size(size_t size_) { return (size_ + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE; }
+    /// 目录自己要的内存，容器的内存另外加上去
+    static size_t calc_head_size(size_t max_entry_num_);
+
+    ShmDirectory() = default;
+
+    /// 一个进程check_ == false初始化，其他的进程check_ == true挂上去
+    bool init(void* mem_, size_t mem_size_, size_t max_entry_num_, bool check_ = false);
+
+    /// 分一块size_大小的内存登记到name_下面，名字太长、已经有了、条目满了或者内存不够返回nullptr
+    void* create(const char* name_, uint32_t type_tag_, uint32_t version_, size_t size_);
+    /// 按名字找，类型、版本或者大小对不上也返回nullptr
+    void* find(const char* name_, uint32_t type_tag_, uint32_t version_, size_t size_);
+    /// 找不到就建一个，created_告诉调用者容器要init还是check_ == true挂上去
+    void* find_or_create(const char* name_, uint32_t type_tag_, uint32_t version_, size_t size_, bool& created_);
+    /// 不管类型和版本，只按名字找条目，没有返回nullptr
+    const ShmDirEntry* entry(const char* name_) const;
+
+    /// 遍历所有的条目，func_(const ShmDirEntry&)
+    template <typename FUNC>
+    void for_each(FUNC&& func_) const;
+
+    size_t entry_num() const { return m_header->entry_num; }
+    size_t max_entry_num() const { return m_header->max_entry_num; }
+    /// 还能分出去的字节数
+    size_t free_size() const { return m_header->mem_size - m_header->used_size; }
+    void* offset_2_ptr(size_t offset_) { return reinterpret_cast<uint8_t*>(m_header) + offset_; }
+
+private:
+    struct DirHeader
+    {
+        size_t magic_num;
+        size_t mem_size;
+        size_t max_entry_num;
+        size_t slot_num;
+        size_t entry_num;
+        /// 已经分出去的，包括目录自己
+        size_t used_size;
+    };
+
+    static size_t slot_num(size_t max_entry_num_);
+    static uint64_t name_hash(const char* name_);
+    ShmDirEntry* slots() const;
+    /// 找name_所在的槽，没有的话返回第一个空槽
+    ShmDirEntry* find_slot(const char* name_) const;
+
+    ShmDirectory(const ShmDirectory&) = delete;
+    ShmDirectory& operator=(const ShmDirectory&) = delete;
+
+    DirHeader* m_header = nullptr;
+};
+
+template <typename FUNC>
+void ShmDirectory::for_each(FUNC&& func_) const
+{
+    ShmDirEntry* entries = slots();
+    for (size_t i = 0; i < m_header->slot_num; ++i)
+    {
+        if (entries[i].name[0] != '\0')
+            func_(static_cast<const ShmDirEntry&>(entries[i]));
+    }
+}
+
+}  // namespace pepper
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * * file name: shm_segment.h
+ * * description: 共享内存段，memfd或者POSIX shm，可以用大页、绑NUMA节点、多线程预先把页都碰一遍
+ * *              各个容器的init只要一块void*内存，从段里面按各自的calc_need_size/need_mem_size顺序切出来就行
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SHM_SEGMENT_H_
+#define _SHM_SEGMENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "const_var.h"
+
+namespace pepper
+{
+struct ShmSegmentOption
+{
+    enum PageType
+    {
+        /// 普通页
+        NORMAL_PAGE,
+        /// 普通页加madvise(MADV_HUGEPAGE)，要/sys/kernel/mm/transparent_hugepage/shmem_enabled打开才有用
+        TRANSPARENT_HUGE_PAGE,
+        /// hugetlb大页，要先在/proc/sys/vm/nr_hugepages预留好，只有memfd支持
+        HUGE_PAGE_2M,
+        HUGE_PAGE_1G,
+    };
+
+    PageType page_type = TRANSPARENT_HUGE_PAGE;
+    /// 绑到哪个NUMA节点上，-1 不绑
+    int numa_node = -1;
+    /// 映射完用几个线程把所有的页碰一遍，0 不碰，第一次访问的时候再缺页
+    size_t touch_threads = 0;
+};
+
+class ShmSegment
+{
+public:
+    ShmSegment() = default;
+    ~ShmSegment();
+    ShmSegment(const ShmSegment &) = delete;
+    ShmSegment &operator=(const ShmSegment &) = delete;
+
+    /// 创建size_大小的memfd并映射，size_向上取整到页大小，name_只是调试用的名字，别的进程要靠fd挂上来
+    bool create_memfd(const char *name_, size_t size_, const ShmSegmentOption &option_ = ShmSegmentOption());
+    /// 用别的进程传过来的memfd映射，fd_会被dup一份，调用者自己的fd_还需要自己关闭
+    bool attach_memfd(int fd_, const ShmSegmentOption &option_ = ShmSegmentOption());
+    /// 创建名字是name_的POSIX shm，已经存在就失败，不支持hugetlb大页
+    bool create_posix(const char *name_, size_t size_, const ShmSegmentOption &option_ = ShmSegmentOption());
+    /// 按名字挂到已经存在的POSIX shm上
+    bool attach_posix(const char *name_, const ShmSegmentOption &option_ = ShmSegmentOption());
+    /// 删掉POSIX shm的名字，已经映射的进程不受影响
+    static bool unlink_posix(const char *name_);
+    /// 解除映射并关闭fd
+    void destroy();
+
+    /// 按顺序切一块出来，起始地址按align_对齐，剩下的不够返回nullptr
+    /// 只记在本进程里面，挂上来的进程按同样的顺序切同样的大小就能拿到同样的区域
+    void *carve(size_t size_, size_t align_ = CACHE_LINE_SIZE);
+    /// 重新从头开始切
+    void reset_carve() { m_carved = 0; }
+    size_t carved() const { return m_carved; }
+
+    uint8_t *addr() const { return m_addr; }
+    size_t size() const { return m_size; }
+    size_t page_size() const { return m_page_size; }
+    int fd() const { return m_fd; }
+
+private:
+    bool map(int fd_, size_t size_, const ShmSegmentOption &option_);
+    /// 多线程把每一页都写一下，用原子或0，不会改已有的数据
+    void touch(size_t thread_num_);
+
+    uint8_t *m_addr = nullptr;
+    size_t m_size = 0;
+    size_t m_page_size = 0;
+    size_t m_carved = 0;
+    int m_fd = -1;
+};
+
+}  // namespace pepper
+
+#endif
@@ -11,6 +11,10 @@
 #include <type_traits>
 #include "../inner/head.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 namespace pepper
 {
 template <size_t>
@@ -94,6 +98,85 @@ struct PowerOfN<Power, 0>
 template <size_t Num>
 using IsPowOfTwo = std::integral_constant<bool, Num && ((Num & (Num - 1)) == 0)>;
 
+/// 运行时的版本
+inline constexpr bool is_pow_of_two(size_t num_) { return num_ && ((num_ & (num_ - 1)) == 0); }
+
+/// 向下取整到2的幂，0返回0
+inline constexpr size_t floor_pow_of_two(size_t num_)
+{
+    size_t result = num_ == 0 ? 0 : 1;
+    while (result != 0 && (result << 1) != 0 && (result << 1) <= num_)
+        result <<= 1;
+    return result;
+}
+
+/// 向上取整到2的幂，0返回1
+inline constexpr size_t ceil_pow_of_two(size_t num_)
+{
+    size_t result = 1;
+    while (result < num_ && (result << 1) != 0)
+        result <<= 1;
+    return result;
+}
+
+/// 把哈希值的每一位打散，std::hash对整数是原样返回的，只取低位或者高位的时候要先打散一下
+inline constexpr uint64_t mix_hash(uint64_t hash_)
+{
+    hash_ ^= hash_ >> 33;
+    hash_ *= 0xff51afd7ed558ccdULL;
+    hash_ ^= hash_ >> 33;
+    hash_ *= 0xc4ceb9fe1a85ec53ULL;
+    hash_ ^= hash_ >> 33;
+    return hash_;
+}
+
+/// 预取到缓存里面，批量查找的时候先把后面要访问的地址都发出去，多个缓存缺失可以重叠起来
+inline void prefetch_read(const void *addr_) { __builtin_prefetch(addr_, 0, 3); }
+
+/// 位图[begin_, end_)里面第一个是1的位，没有返回end_，有AVX2的时候连续的空字一次跳过256位
+inline size_t find_next_bit(const uint64_t *bits_, size_t begin_, size_t end_)
+{
+    if (begin_ >= end_)
+        return end_;
+    size_t word = begin_ / 64;
+    size_t end_word = (end_ + 63) / 64;
+    uint64_t bits = bits_[word] & (~uint64_t(0) << (begin_ % 64));
+    while (bits == 0)
+    {
+        if (++word >= end_word)
+            return end_;
+#ifdef __AVX2__
+        for (; word + 4 <= end_word; word += 4)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bits_ + word));
+            if (!_mm256_testz_si256(v, v))
+                break;
+        }
+        if (word >= end_word)
+            return end_;
+#endif
+        bits = bits_[word];
+    }
+    size_t pos = word * 64 + __builtin_ctzll(bits);
+    return pos < end_ ? pos : end_;
+}
+
+/// 位图[0, end_)里面最后一个是1的位，没有返回end_
+inline size_t find_prev_bit(const uint64_t *bits_, size_t end_)
+{
+    if (end_ == 0)
+        return end_;
+    size_t word = (end_ - 1) / 64;
+    uint64_t bits = bits_[word] & (~uint64_t(0) >> (63 - (end_ - 1) % 64));
+    while (bits == 0)
+    {
+        if (word == 0)
+            return end_;
+        bits = bits_[--word];
+    }
+    return word * 64 + 63 - __builtin_clzll(bits);
+}
+
 // 根据要表示的数量选择一个合适字节的INT类型
 template <size_t Size>
 struct FixIntType
@@ -244,6 +327,17 @@ struct IsEqual
     bool operator()(const T &x, const T &y) const { return x == y; }
 };
 
+/// 哈希函数或者比较函数声明了is_transparent，表示可以直接接受别的类型的key，查找的时候不用构造KEY
+template <typename T, typename = void>
+struct IsTransparent : std::false_type
+{
+};
+
+template <typename T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>> : std::true_type
+{
+};
+
 //////////////////////////////////////////////////////////////////////////////
 
 /// 获取Key
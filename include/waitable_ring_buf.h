@@ -0,0 +1,150 @@
+/*
+ * * file name: waitable_ring_buf.h
+ * * description: 给init指定大小的队列加上基于futex的阻塞等待，可以跨进程
+ * *              消费者在wait_nonempty里面睡眠，生产者只有在记录了有人睡眠的时候才会唤醒
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _WAITABLE_RING_BUF_H_
+#define _WAITABLE_RING_BUF_H_
+
+#include <chrono>
+#include <climits>
+#include "inner/buf_data.h"
+#include "utils/futex.h"
+
+namespace pepper
+{
+/// RING 是 FixedRingBuf<T>、UnfixedRingBuf<>、SPSCUnfixedRingBuf<>、MPMCFixedRingBuf<T> 这类通过init指定内存的队列
+/// 内存的开头放等待通知头，后面的交给RING::init
+template <typename RING>
+class WaitableRingBuf : public RING
+{
+    using Event = inner::RingBufEvent;
+
+public:
+    static size_t need_mem_size(size_t size_) { return sizeof(Event) + RING::need_mem_size(size_); }
+
+    /// 和RING::init一样，check_ == true 的时候表示挂到已经初始化过的内存上
+    template <typename... Args>
+    bool init(void *mem_, size_t mem_size_, bool check_ = false, Args &&...args_);
+
+    /// 入队成功之后会检查是否需要唤醒消费者
+    template <typename... Args>
+    bool push(Args &&...args_);
+    template <typename... Args>
+    size_t push_bulk(Args &&...args_);
+    template <typename... Args>
+    bool commit(Args &&...args_);
+
+    /// 等到队列不空或者超时，timeout_us_ < 0 表示一直等，队列不空返回true
+    /// 队列本来就不空的时候不会有系统调用
+    bool wait_nonempty(int64_t timeout_us_ = -1) const;
+    /// 直接修改了队列的时候手动通知消费者
+    void notify() const;
+
+private:
+    Event *m_event = nullptr;
+};
+
+template <typename RING>
+template <typename... Args>
+bool WaitableRingBuf<RING>::init(void *mem_, size_t mem_size_, bool check_, Args &&...args_)
+{
+    if (!mem_ || mem_size_ <= sizeof(Event))
+        return false;
+
+    Event *event = reinterpret_cast<Event *>(mem_);
+    if (!check_)
+        new (event) Event();
+    if (!RING::init(reinterpret_cast<uint8_t *>(mem_) + sizeof(Event), mem_size_ - sizeof(Event), check_,
+                    std::forward<Args>(args_)...))
+        return false;
+
+    m_event = event;
+    return true;
+}
+
+template <typename RING>
+template <typename... Args>
+bool WaitableRingBuf<RING>::push(Args &&...args_)
+{
+    if (!RING::push(std::forward<Args>(args_)...))
+        return false;
+    notify();
+    return true;
+}
+
+template <typename RING>
+template <typename... Args>
+size_t WaitableRingBuf<RING>::push_bulk(Args &&...args_)
+{
+    size_t num = RING::push_bulk(std::forward<Args>(args_)...);
+    if (num > 0)
+        notify();
+    return num;
+}
+
+template <typename RING>
+template <typename... Args>
+bool WaitableRingBuf<RING>::commit(Args &&...args_)
+{
+    if (!RING::commit(std::forward<Args>(args_)...))
+        return false;
+    notify();
+    return true;
+}
+
+template <typename RING>
+void WaitableRingBuf<RING>::notify() const
+{
+    // 和wait_nonempty里面的fence配对：要么消费者看到了新数据，要么生产者看到了m_waiters
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_event->m_waiters.load(std::memory_order_relaxed) == 0)
+        return;
+
+    m_event->m_seq.fetch_add(1, std::memory_order_release);
+    futex_wake(&m_event->m_seq, INT_MAX);
+}
+
+template <typename RING>
+bool WaitableRingBuf<RING>::wait_nonempty(int64_t timeout_us_) const
+{
+    if (!RING::empty())
+        return true;
+    if (timeout_us_ == 0)
+        return false;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us_);
+    m_event->m_waiters.fetch_add(1, std::memory_order_relaxed);
+    bool nonempty = false;
+    while (true)
+    {
+        // 先登记等待和读seq，再检查队列，生产者在写完数据之后检查m_waiters
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32_t seq = m_event->m_seq.load(std::memory_order_acquire);
+        if (!RING::empty())
+        {
+            nonempty = true;
+            break;
+        }
+
+        int64_t left_us = -1;
+        if (timeout_us_ > 0)
+        {
+            left_us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now())
+                          .count();
+            if (left_us <= 0)
+                break;
+        }
+        // seq已经变了会马上返回，被信号打断也会返回，重新检查一遍就行
+        futex_wait(&m_event->m_seq, seq, left_us);
+    }
+    m_event->m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    return nonempty;
+}
+
+}  // namespace pepper
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * * file name: futex.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#include "utils/futex.h"
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace pepper
+{
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bits");
+
+bool futex_wait(std::atomic<uint32_t> *addr_, uint32_t expected_, int64_t timeout_us_)
+{
+    struct timespec timeout;
+    struct timespec *timeout_ptr = nullptr;
+    if (timeout_us_ >= 0)
+    {
+        timeout.tv_sec = timeout_us_ / 1000000;
+        timeout.tv_nsec = (timeout_us_ % 1000000) * 1000;
+        timeout_ptr = &timeout;
+    }
+
+    // 不能用FUTEX_WAIT_PRIVATE，否则别的进程唤醒不了
+    long ret = syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr_), FUTEX_WAIT, expected_, timeout_ptr, nullptr, 0);
+    return ret == 0 || errno != ETIMEDOUT;
+}
+
+int futex_wake(std::atomic<uint32_t> *addr_, int num_)
+{
+    long ret = syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr_), FUTEX_WAKE, num_, nullptr, nullptr, 0);
+    return ret < 0 ? 0 : static_cast<int>(ret);
+}
+
+}  // namespace pepper
@@ -0,0 +1,111 @@
+/*
+ * * file name: mirror_mem.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#include "utils/mirror_mem.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace pepper
+{
+MirrorMem::~MirrorMem()
+{
+    destroy();
+}
+
+size_t MirrorMem::page_align(size_t size_)
+{
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (size_ + page_size - 1) / page_size * page_size;
+}
+
+bool MirrorMem::create(size_t head_size_, size_t size_, const char *name_)
+{
+    destroy();
+    head_size_ = page_align(head_size_);
+    size_ = page_align(size_);
+    if (size_ == 0)
+        return false;
+
+    // 老的glibc没有memfd_create的封装，直接走系统调用
+    int fd = static_cast<int>(syscall(SYS_memfd_create, name_, MFD_CLOEXEC));
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, static_cast<off_t>(head_size_ + size_)) != 0 || !map(fd, head_size_, size_))
+    {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+bool MirrorMem::attach(int fd_, size_t head_size_)
+{
+    destroy();
+    head_size_ = page_align(head_size_);
+    struct stat st;
+    if (fd_ < 0 || fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) <= head_size_)
+        return false;
+
+    size_t size = static_cast<size_t>(st.st_size) - head_size_;
+    if (size != page_align(size))
+        return false;
+
+    int fd = fcntl(fd_, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+
+    if (!map(fd, head_size_, size))
+    {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+bool MirrorMem::map(int fd_, size_t head_size_, size_t size_)
+{
+    // 先占一段连续的虚拟地址，再把文件的各个部分用MAP_FIXED盖上去
+    size_t total_size = head_size_ + size_ * 2;
+    void *reserved = mmap(nullptr, total_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED)
+        return false;
+
+    uint8_t *addr = reinterpret_cast<uint8_t *>(reserved);
+    int prot = PROT_READ | PROT_WRITE;
+    if ((head_size_ > 0 && mmap(addr, head_size_, prot, MAP_SHARED | MAP_FIXED, fd_, 0) == MAP_FAILED) ||
+        mmap(addr + head_size_, size_, prot, MAP_SHARED | MAP_FIXED, fd_, head_size_) == MAP_FAILED ||
+        mmap(addr + head_size_ + size_, size_, prot, MAP_SHARED | MAP_FIXED, fd_, head_size_) == MAP_FAILED)
+    {
+        munmap(reserved, total_size);
+        return false;
+    }
+
+    m_addr = addr;
+    m_head_size = head_size_;
+    m_size = size_;
+    m_fd = fd_;
+    return true;
+}
+
+void MirrorMem::destroy()
+{
+    if (m_addr)
+        munmap(m_addr, m_head_size + m_size * 2);
+    if (m_fd >= 0)
+        close(m_fd);
+
+    m_addr = nullptr;
+    m_head_size = 0;
+    m_size = 0;
+    m_fd = -1;
+}
+
+}  // namespace pepper
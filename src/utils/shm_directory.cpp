@@ -0,0 +1,129 @@
+/*
+ * * file name: shm_directory.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#include "utils/shm_directory.h"
+#include <cstring>
+#include "utils/traits_utils.h"
+
+namespace pepper
+{
+static const size_t SHM_DIR_MAGIC_NUM = 0x9E370201;
+
+size_t ShmDirectory::slot_num(size_t max_entry_num_)
+{
+    return ceil_pow_of_two(max_entry_num_ * 2);
+}
+
+size_t ShmDirectory::calc_head_size(size_t max_entry_num_)
+{
+    return align_size(sizeof(DirHeader) + sizeof(ShmDirEntry) * slot_num(max_entry_num_));
+}
+
+uint64_t ShmDirectory::name_hash(const char* name_)
+{
+    // FNV-1a，不用std::hash，不同的程序挂上来算出来的也要一样
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char* p = name_; *p != '\0'; ++p)
+    {
+        hash ^= static_cast<uint8_t>(*p);
+        hash *= 0x100000001b3ULL;
+    }
+    return mix_hash(hash);
+}
+
+ShmDirEntry* ShmDirectory::slots() const
+{
+    return reinterpret_cast<ShmDirEntry*>(m_header + 1);
+}
+
+bool ShmDirectory::init(void* mem_, size_t mem_size_, size_t max_entry_num_, bool check_)
+{
+    if (!mem_ || max_entry_num_ == 0 || mem_size_ < calc_head_size(max_entry_num_))
+        return false;
+
+    DirHeader* header = reinterpret_cast<DirHeader*>(mem_);
+    if (check_)
+    {
+        if (header->magic_num != SHM_DIR_MAGIC_NUM || header->mem_size != mem_size_ ||
+            header->max_entry_num != max_entry_num_)
+            return false;
+        m_header = header;
+        return true;
+    }
+
+    memset(mem_, 0, calc_head_size(max_entry_num_));
+    header->magic_num = SHM_DIR_MAGIC_NUM;
+    header->mem_size = mem_size_;
+    header->max_entry_num = max_entry_num_;
+    header->slot_num = slot_num(max_entry_num_);
+    header->entry_num = 0;
+    header->used_size = calc_head_size(max_entry_num_);
+    m_header = header;
+    return true;
+}
+
+ShmDirEntry* ShmDirectory::find_slot(const char* name_) const
+{
+    // 槽的个数至少是条目数的两倍，一定能碰到空槽停下来
+    size_t mask = m_header->slot_num - 1;
+    ShmDirEntry* entries = slots();
+    for (size_t i = name_hash(name_) & mask;; i = (i + 1) & mask)
+    {
+        if (entries[i].name[0] == '\0' || strcmp(entries[i].name, name_) == 0)
+            return &entries[i];
+    }
+}
+
+const ShmDirEntry* ShmDirectory::entry(const char* name_) const
+{
+    if (!name_ || name_[0] == '\0' || strlen(name_) > ShmDirEntry::MAX_NAME_LEN)
+        return nullptr;
+    const ShmDirEntry* slot = find_slot(name_);
+    return slot->name[0] != '\0' ? slot : nullptr;
+}
+
+void* ShmDirectory::create(const char* name_, uint32_t type_tag_, uint32_t version_, size_t size_)
+{
+    if (!name_ || name_[0] == '\0' || strlen(name_) > ShmDirEntry::MAX_NAME_LEN ||
+        m_header->entry_num >= m_header->max_entry_num || align_size(size_) > free_size() || size_ == 0)
+        return nullptr;
+
+    ShmDirEntry* slot = find_slot(name_);
+    if (slot->name[0] != '\0')
+        return nullptr;
+
+    // 名字最后写，名字在就说明前面的都写好了
+    slot->type_tag = type_tag_;
+    slot->version = version_;
+    slot->offset = m_header->used_size;
+    slot->size = size_;
+    strcpy(slot->name, name_);
+    m_header->used_size += align_size(size_);
+    ++m_header->entry_num;
+    return offset_2_ptr(slot->offset);
+}
+
+void* ShmDirectory::find(const char* name_, uint32_t type_tag_, uint32_t version_, size_t size_)
+{
+    const ShmDirEntry* slot = entry(name_);
+    if (!slot || slot->type_tag != type_tag_ || slot->version != version_ || slot->size != size_)
+        return nullptr;
+    return offset_2_ptr(slot->offset);
+}
+
+void* ShmDirectory::find_or_create(const char* name_, uint32_t type_tag_, uint32_t version_, size_t size_,
+                                   bool& created_)
+{
+    created_ = false;
+    if (entry(name_))
+        return find(name_, type_tag_, version_, size_);
+    void* p = create(name_, type_tag_, version_, size_);
+    created_ = p != nullptr;
+    return p;
+}
+
+}  // namespace pepper
@@ -0,0 +1,227 @@
+/*
+ * * file name: shm_segment.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#include "utils/shm_segment.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+namespace pepper
+{
+namespace
+{
+// 不依赖libnuma和新的内核头文件，用到的几个常量自己定义
+const unsigned int MEMFD_HUGETLB = 0x0004u;
+const unsigned int MEMFD_HUGE_SHIFT = 26;
+const int MEMPOLICY_BIND = 2;
+const unsigned int MEMPOLICY_MF_MOVE = 1u << 1;
+const size_t MAX_NUMA_NODE = 1024;
+const size_t HUGE_PAGE_2M = size_t(1) << 21;
+const size_t HUGE_PAGE_1G = size_t(1) << 30;
+
+size_t option_page_size(const ShmSegmentOption &option_)
+{
+    if (option_.page_type == ShmSegmentOption::HUGE_PAGE_2M)
+        return HUGE_PAGE_2M;
+    if (option_.page_type == ShmSegmentOption::HUGE_PAGE_1G)
+        return HUGE_PAGE_1G;
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+bool is_hugetlb(const ShmSegmentOption &option_)
+{
+    return option_.page_type == ShmSegmentOption::HUGE_PAGE_2M || option_.page_type == ShmSegmentOption::HUGE_PAGE_1G;
+}
+}  // namespace
+
+ShmSegment::~ShmSegment()
+{
+    destroy();
+}
+
+bool ShmSegment::create_memfd(const char *name_, size_t size_, const ShmSegmentOption &option_)
+{
+    destroy();
+    size_t page_size = option_page_size(option_);
+    size_ = (size_ + page_size - 1) / page_size * page_size;
+    if (size_ == 0)
+        return false;
+
+    unsigned int flags = MFD_CLOEXEC;
+    if (is_hugetlb(option_))
+        flags |= MEMFD_HUGETLB | ((page_size == HUGE_PAGE_1G ? 30u : 21u) << MEMFD_HUGE_SHIFT);
+    // 老的glibc没有memfd_create的封装，直接走系统调用
+    int fd = static_cast<int>(syscall(SYS_memfd_create, name_, flags));
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, static_cast<off_t>(size_)) != 0 || !map(fd, size_, option_))
+    {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+bool ShmSegment::attach_memfd(int fd_, const ShmSegmentOption &option_)
+{
+    destroy();
+    struct stat st;
+    if (fd_ < 0 || fstat(fd_, &st) != 0 || st.st_size <= 0)
+        return false;
+
+    int fd = fcntl(fd_, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+
+    if (!map(fd, static_cast<size_t>(st.st_size), option_))
+    {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+bool ShmSegment::create_posix(const char *name_, size_t size_, const ShmSegmentOption &option_)
+{
+    destroy();
+    // /dev/shm是tmpfs，用不了hugetlb，只能走透明大页
+    if (is_hugetlb(option_))
+        return false;
+    size_t page_size = option_page_size(option_);
+    size_ = (size_ + page_size - 1) / page_size * page_size;
+    if (size_ == 0)
+        return false;
+
+    int fd = shm_open(name_, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, static_cast<off_t>(size_)) != 0 || !map(fd, size_, option_))
+    {
+        close(fd);
+        shm_unlink(name_);
+        return false;
+    }
+    return true;
+}
+
+bool ShmSegment::attach_posix(const char *name_, const ShmSegmentOption &option_)
+{
+    destroy();
+    int fd = shm_open(name_, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || !map(fd, static_cast<size_t>(st.st_size), option_))
+    {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+bool ShmSegment::unlink_posix(const char *name_)
+{
+    return shm_unlink(name_) == 0;
+}
+
+bool ShmSegment::map(int fd_, size_t size_, const ShmSegmentOption &option_)
+{
+    // hugetlbfs的文件st_blksize就是大页的大小，挂上来的进程不用知道创建的时候用的什么页
+    struct stat st;
+    if (fstat(fd_, &st) != 0)
+        return false;
+    size_t page_size = static_cast<size_t>(st.st_blksize);
+    if (page_size == 0 || size_ % page_size != 0)
+        return false;
+
+    void *addr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED)
+        return false;
+
+    if (option_.page_type == ShmSegmentOption::TRANSPARENT_HUGE_PAGE)
+        madvise(addr, size_, MADV_HUGEPAGE);
+
+    // 要在缺页之前绑，已经有的页能挪的也挪过去
+    if (option_.numa_node >= 0)
+    {
+        const size_t bits = sizeof(unsigned long) * 8;
+        unsigned long mask[MAX_NUMA_NODE / bits] = {0};
+        size_t node = static_cast<size_t>(option_.numa_node);
+        if (node < MAX_NUMA_NODE)
+            mask[node / bits] = 1ul << (node % bits);
+        if (node >= MAX_NUMA_NODE ||
+            syscall(SYS_mbind, addr, size_, MEMPOLICY_BIND, mask, MAX_NUMA_NODE + 1, MEMPOLICY_MF_MOVE) != 0)
+        {
+            munmap(addr, size_);
+            return false;
+        }
+    }
+
+    m_addr = reinterpret_cast<uint8_t *>(addr);
+    m_size = size_;
+    m_page_size = page_size;
+    m_carved = 0;
+    m_fd = fd_;
+    if (option_.touch_threads > 0)
+        touch(option_.touch_threads);
+    return true;
+}
+
+void ShmSegment::touch(size_t thread_num_)
+{
+    size_t page_num = m_size / m_page_size;
+    if (thread_num_ > page_num)
+        thread_num_ = page_num;
+
+    // 每个线程碰连续的一段，挂上来的时候别的进程可能正在写，只能用原子操作
+    size_t per_thread = (page_num + thread_num_ - 1) / thread_num_;
+    auto worker = [this, page_num, per_thread](size_t index_) {
+        size_t end = (index_ + 1) * per_thread < page_num ? (index_ + 1) * per_thread : page_num;
+        for (size_t i = index_ * per_thread; i < end; ++i)
+            __atomic_fetch_or(m_addr + i * m_page_size, 0, __ATOMIC_RELAXED);
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_num_; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+    for (auto &thread : threads)
+        thread.join();
+}
+
+void *ShmSegment::carve(size_t size_, size_t align_)
+{
+    if (!m_addr || align_ == 0 || (align_ & (align_ - 1)) != 0)
+        return nullptr;
+    size_t begin = (m_carved + align_ - 1) & ~(align_ - 1);
+    if (begin > m_size || size_ > m_size - begin)
+        return nullptr;
+    m_carved = begin + size_;
+    return m_addr + begin;
+}
+
+void ShmSegment::destroy()
+{
+    if (m_addr)
+        munmap(m_addr, m_size);
+    if (m_fd >= 0)
+        close(m_fd);
+
+    m_addr = nullptr;
+    m_size = 0;
+    m_page_size = 0;
+    m_carved = 0;
+    m_fd = -1;
+}
+
+}  // namespace pepper
@@ -8,6 +8,11 @@
 #ifndef _BASE_TEST_STRUCT_H_
 #define _BASE_TEST_STRUCT_H_
 
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
 #include "utils/traits_utils.h"
 
 struct BaseNode
@@ -24,6 +29,35 @@ struct TestNode : public BaseNode
     char d;
 };
 
+/// 定长字符数组的key，查找的时候可以直接用string_view，不用构造一个NameKey
+struct NameKey
+{
+    char name[16];
+
+    NameKey() { memset(name, 0, sizeof(name)); }
+    NameKey(std::string_view name_)
+    {
+        memset(name, 0, sizeof(name));
+        memcpy(name, name_.data(), std::min(name_.size(), sizeof(name)));
+    }
+    std::string_view view() const { return std::string_view(name, strnlen(name, sizeof(name))); }
+};
+
+/// 父子进程共享的匿名内存，死亡测试的子进程写进去的父进程也能看到
+inline uint8_t *map_shared(size_t size_)
+{
+    void *mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return mem == MAP_FAILED ? nullptr : static_cast<uint8_t *>(mem);
+}
+
+/// node_所在的页到结尾都设成只读，节点数组在最后面，往节点里写数据的时候进程就挂了，模拟修改到一半被杀掉
+inline void crash_on_write(uint8_t *mem_, size_t size_, const void *node_)
+{
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    uint8_t *begin = mem_ + (static_cast<const uint8_t *>(node_) - mem_) / page_size * page_size;
+    mprotect(begin, mem_ + size_ - begin, PROT_READ);
+}
+
 namespace std
 {
 template <>
@@ -37,6 +71,14 @@ struct hash<TestNode>
 {
     size_t operator()(const TestNode &t_) const { return hash<uint32_t>{}(t_.a); }
 };
+
+template <>
+struct hash<NameKey>
+{
+    using is_transparent = void;
+    size_t operator()(const NameKey &t_) const { return hash<string_view>{}(t_.view()); }
+    size_t operator()(string_view t_) const { return hash<string_view>{}(t_); }
+};
 }  // namespace std
 
 namespace pepper
@@ -52,6 +94,14 @@ struct IsEqual<TestNode>
 {
     bool operator()(const TestNode &x, const TestNode &y) const { return x.a == y.a; }
 };
+
+template <>
+struct IsEqual<NameKey>
+{
+    using is_transparent = void;
+    bool operator()(const NameKey &x, const NameKey &y) const { return x.view() == y.view(); }
+    bool operator()(const NameKey &x, std::string_view y) const { return x.view() == y; }
+};
 }  // namespace pepper
 
 #endif
@@ -12,7 +12,9 @@
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
+#include <vector>
 #include "base_test_struct.h"
 #include "fixed_mem_pool.h"
 #include "gtest/gtest.h"
@@ -274,4 +276,82 @@ TEST(FixedMemPoolTest, unknow_node_size)
     EXPECT_EQ(mem_pool.size(), count);
 }
 
+// 用位图代替used链表
+TEST(FixedMemPoolTest, used_bitmap)
+{
+    using PoolType = FixedMemPool<uint32_t, alignof(uint32_t), true>;
+    using ListPoolType = FixedMemPool<uint32_t, alignof(uint32_t)>;
+    size_t max_num = 1451;
+    size_t mem_size = PoolType::calc_need_size(max_num);
+    // 每个节点只有8个字节加1位，比used链表省了16个字节
+    EXPECT_LT(mem_size, ListPoolType::calc_need_size(max_num) / 2);
+    std::unique_ptr<uint8_t[]> mem(new uint8_t[mem_size]);
+    PoolType mem_pool;
+    ASSERT_TRUE(mem_pool.init(mem.get(), mem_size, max_num));
+    EXPECT_EQ(mem_pool.node_size(), sizeof(size_t));
+    EXPECT_TRUE(mem_pool.begin() == mem_pool.end());
+
+    std::vector<uint32_t*> nodes;
+    for (uint32_t i = 0; i < max_num; ++i)
+    {
+        auto p = mem_pool.alloc();
+        ASSERT_NE(p, nullptr);
+        *p = i;
+        nodes.push_back(p);
+    }
+    ASSERT_TRUE(mem_pool.full());
+    EXPECT_EQ(mem_pool.alloc(), nullptr);
+
+    // 删掉一部分，重复free要失败，跨过好几个空的字
+    set<uint32_t> live;
+    for (uint32_t i = 0; i < max_num; ++i)
+    {
+        if (i % 3 == 0 || (i > 200 && i < 900))
+        {
+            ASSERT_TRUE(mem_pool.free(nodes[i]));
+            EXPECT_FALSE(mem_pool.free(nodes[i]));
+        }
+        else
+            live.insert(i);
+    }
+    EXPECT_EQ(mem_pool.size(), live.size());
+
+    // 按地址顺序遍历
+    auto check = [&](PoolType& pool_) {
+        std::vector<uint32_t> visited;
+        for (auto& node : pool_)
+            visited.push_back(node);
+        EXPECT_TRUE(std::equal(visited.begin(), visited.end(), live.begin(), live.end()));
+        visited.clear();
+        auto it = pool_.end();
+        while (it != pool_.begin())
+            visited.push_back(*(--it));
+        EXPECT_TRUE(std::equal(visited.begin(), visited.end(), live.rbegin(), live.rend()));
+    };
+    check(mem_pool);
+
+    // 回收的节点重新用上
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        auto p = mem_pool.alloc();
+        ASSERT_NE(p, nullptr);
+        EXPECT_EQ(*p, 0u);
+        *p = static_cast<uint32_t>(mem_pool.ptr_2_int(p) - 1);
+        live.insert(*p);
+    }
+    check(mem_pool);
+
+    PoolType attach_pool;
+    ASSERT_TRUE(attach_pool.init(mem.get(), mem_size, max_num, true));
+    EXPECT_EQ(attach_pool.size(), live.size());
+    check(attach_pool);
+    // 普通的布局挂不上来
+    ListPoolType list_pool;
+    EXPECT_FALSE(list_pool.init(mem.get(), mem_size, max_num, true));
+
+    mem_pool.clear();
+    EXPECT_TRUE(mem_pool.empty());
+    EXPECT_TRUE(mem_pool.begin() == mem_pool.end());
+}
+
 #endif
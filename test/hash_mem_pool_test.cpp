@@ -12,7 +12,9 @@
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
+#include <vector>
 #include "base_test_struct.h"
 #include "gtest/gtest.h"
 #include "hash_mem_pool.h"
@@ -169,4 +171,37 @@ TEST(HashMemPoolTest, hash_mem_pool)
     EXPECT_EQ(mem_pool.size(), 0ul);
 }
 
+// 批量查找和一个一个查的结果要一样
+TEST(HashMemPoolTest, hash_mem_pool_find_batch)
+{
+    size_t max_num = 1000;
+    uint32_t bucket_num = 997;
+    size_t mem_size = HashMap::calc_mem_size(max_num, bucket_num);
+    std::unique_ptr<uint8_t[]> mem(new uint8_t[mem_size]);
+    HashMap mem_pool;
+    ASSERT_TRUE(mem_pool.init(mem.get(), max_num, bucket_num, mem_size));
+
+    for (size_t i = 0; i < max_num; ++i)
+        ASSERT_TRUE(mem_pool.insert(i * 3, TestNode()).second);
+
+    // 个数不是一组的整数倍，一半能找到
+    std::vector<size_t> keys;
+    for (size_t i = 0; i < 301; ++i)
+        keys.push_back(i * 3 + (i % 2));
+    std::vector<size_t> refs(keys.size(), 1);
+    EXPECT_EQ(mem_pool.find_batch(keys.data(), keys.size(), refs.data()), 151u);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        auto iter = mem_pool.find(keys[i]);
+        if (iter == mem_pool.end())
+            EXPECT_EQ(refs[i], 0u);
+        else
+        {
+            EXPECT_EQ(refs[i], mem_pool.ref(&(*iter)));
+            EXPECT_EQ(mem_pool.deref(refs[i])->first, keys[i]);
+        }
+    }
+    EXPECT_EQ(mem_pool.find_batch(keys.data(), 0, refs.data()), 0u);
+}
+
 #endif
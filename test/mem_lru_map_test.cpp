@@ -14,7 +14,10 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
+#include <string>
+#include <vector>
 #include "base_test_struct.h"
 #include "gtest/gtest.h"
 
@@ -678,4 +681,121 @@ TEST(MemLRUMapTest, mem_lru_map_test_0_size)
     EXPECT_EQ(lru_map.size(), 0ul);
 }
 
+// 用string_view查找，带着哈希值插入、查找和删除，active链要保持完整
+TEST(MemLRUMapTest, mem_lru_map_test_transparent)
+{
+    static const size_t MAX_SIZE = 8;
+    MemLRUMap<NameKey, uint32_t, MAX_SIZE> lru_map;
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < MAX_SIZE + 2; ++i)
+        names.push_back("lru_" + std::to_string(i));
+
+    for (uint32_t i = 0; i < MAX_SIZE; ++i)
+    {
+        size_t hash = lru_map.key_hash(std::string_view(names[i]));
+        ASSERT_TRUE(lru_map.find_hashed(std::string_view(names[i]), hash) == lru_map.end());
+        ASSERT_TRUE(lru_map.insert_hashed(NameKey(names[i]), i, hash).second);
+    }
+    ASSERT_TRUE(lru_map.full());
+
+    // 满了之后强制插入会把最久没用的淘汰掉
+    size_t hash = lru_map.key_hash(std::string_view(names[MAX_SIZE]));
+    EXPECT_FALSE(lru_map.insert_hashed(NameKey(names[MAX_SIZE]), MAX_SIZE, hash).second);
+    EXPECT_TRUE(lru_map.insert_hashed(NameKey(names[MAX_SIZE]), MAX_SIZE, hash, true).second);
+    EXPECT_FALSE(lru_map.exist(std::string_view(names[0])));
+    EXPECT_EQ(lru_map.find(std::string_view(names[MAX_SIZE]))->second, MAX_SIZE);
+    EXPECT_EQ(lru_map.begin()->second, MAX_SIZE);
+
+    lru_map.erase_hashed(std::string_view(names[MAX_SIZE]), hash);
+    lru_map.erase(std::string_view(names[1]));
+    EXPECT_EQ(lru_map.size(), MAX_SIZE - 2);
+    EXPECT_TRUE(lru_map.find(std::string_view(names[1])) == lru_map.end());
+    // 按迭代器删不能走到透明key的重载上去
+    lru_map.erase(lru_map.find(std::string_view(names[2])));
+    EXPECT_FALSE(lru_map.exist(std::string_view(names[2])));
+    ASSERT_TRUE(lru_map.insert(NameKey(names[2]), 2).second);
+
+    size_t count = 0;
+    for (auto it = lru_map.begin(); it != lru_map.end(); ++it)
+    {
+        EXPECT_EQ(it->first.view(), names[it->second]);
+        ++count;
+    }
+    EXPECT_EQ(count, MAX_SIZE - 2);
+    count = 0;
+    for (auto it = --lru_map.end(); it != lru_map.end(); --it)
+        ++count;
+    EXPECT_EQ(count, MAX_SIZE - 2);
+}
+
+TEST(MemLRUMapTest, mem_lru_map_test_journal)
+{
+    static const uint32_t MAX_SIZE = 1000;
+    using MapType = MemLRUMap<uint32_t, TestNode, 0, true>;
+    size_t mem_size = MapType::need_mem_size(MAX_SIZE, 997);
+    uint8_t* mem = map_shared(mem_size);
+    ASSERT_NE(mem, nullptr);
+    {
+        MapType lru_map;
+        ASSERT_TRUE(lru_map.init(mem, mem_size, MAX_SIZE, 997));
+        for (uint32_t i = 0; i < MAX_SIZE; ++i)
+        {
+            TestNode node;
+            node.a = i;
+            ASSERT_TRUE(lru_map.insert(i, node).second);
+        }
+        for (uint32_t i = 0; i < MAX_SIZE; i += 3)
+            ASSERT_TRUE(lru_map.active(i) != lru_map.end());
+        const void* node = &lru_map.find(MAX_SIZE - 10)->second;
+        lru_map.erase(MAX_SIZE - 10);
+        std::vector<uint32_t> order;
+        for (auto& it : lru_map)
+            order.push_back(it.first);
+
+        // 子进程插入，表已经改完了，往节点里写数据的时候挂了，淘汰链还没接上
+        EXPECT_DEATH(
+            {
+                crash_on_write(mem, mem_size, node);
+                lru_map.insert(MAX_SIZE, TestNode());
+            },
+            "");
+
+        MapType attach_map;
+        ASSERT_TRUE(attach_map.init(mem, mem_size, MAX_SIZE, 997, true));
+        EXPECT_FALSE(attach_map.recover());
+        EXPECT_EQ(attach_map.size(), MAX_SIZE - 1);
+        EXPECT_FALSE(attach_map.exist(MAX_SIZE));
+
+        // 前后两个方向的淘汰顺序都没变
+        std::vector<uint32_t> recovered;
+        for (auto& it : attach_map)
+        {
+            EXPECT_EQ(it.first, it.second.a);
+            recovered.push_back(it.first);
+        }
+        EXPECT_EQ(recovered, order);
+        recovered.clear();
+        for (auto it = --attach_map.end(); it != attach_map.end(); --it)
+            recovered.push_back(it->first);
+        std::reverse(recovered.begin(), recovered.end());
+        EXPECT_EQ(recovered, order);
+
+        TestNode node_value;
+        node_value.a = MAX_SIZE;
+        ASSERT_TRUE(attach_map.insert(MAX_SIZE, node_value).second);
+        EXPECT_EQ(attach_map.begin()->first, MAX_SIZE);
+        EXPECT_TRUE(attach_map.full());
+        EXPECT_TRUE(attach_map.insert(MAX_SIZE + 1, node_value, true).second);
+        EXPECT_FALSE(attach_map.exist(order.back()));
+    }
+    munmap(mem, mem_size);
+
+    // 固定大小的版本
+    MemLRUMap<uint32_t, TestNode, 100, true> static_map;
+    ASSERT_TRUE(static_map.insert(1, TestNode()).second);
+    ASSERT_TRUE(static_map.active(1) != static_map.end());
+    EXPECT_FALSE(static_map.recover());
+    EXPECT_EQ(static_map.size(), 1u);
+}
+
 #endif
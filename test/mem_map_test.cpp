@@ -13,7 +13,11 @@
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include "base_test_struct.h"
 #include "gtest/gtest.h"
 
@@ -452,4 +456,835 @@ TEST(MemMapTest, mem_map_test_insert)
     }
 }
 
+// 开放寻址版本，随机插入删除和std::map对比，删除多了会有墓碑
+TEST(MemMapTest, flat_mem_map_test_normal)
+{
+    static const size_t MAX_SIZE = 1000;
+    FlatMemMap<uint32_t, TestNode, MAX_SIZE> mem_map;
+    ASSERT_TRUE(mem_map.empty());
+    EXPECT_EQ(mem_map.capacity(), MAX_SIZE);
+    EXPECT_TRUE(mem_map.begin() == mem_map.end());
+
+    map<uint32_t, uint32_t> std_map;
+    uint32_t seed = MAX_SIZE;
+    for (size_t round = 0; round < 50000; ++round)
+    {
+        uint32_t key = rand_r(&seed) % (MAX_SIZE * 2);
+        if (rand_r(&seed) % 3 == 0)
+        {
+            mem_map.erase(key);
+            std_map.erase(key);
+        }
+        else
+        {
+            TestNode node;
+            node.a = key;
+            node.b = round;
+            auto result_pair = mem_map.insert(key, node);
+            if (std_map.count(key) > 0)
+            {
+                ASSERT_FALSE(result_pair.second);
+                EXPECT_EQ(result_pair.first->second.b, std_map[key]);
+            }
+            else if (std_map.size() < MAX_SIZE)
+            {
+                ASSERT_TRUE(result_pair.second);
+                std_map[key] = round;
+            }
+            else
+            {
+                ASSERT_TRUE(mem_map.full());
+                ASSERT_FALSE(result_pair.second);
+                EXPECT_EQ(result_pair.first, mem_map.end());
+            }
+        }
+        ASSERT_EQ(mem_map.size(), std_map.size());
+    }
+
+    for (uint32_t key = 0; key < MAX_SIZE * 2; ++key)
+    {
+        auto iter = mem_map.find(key);
+        auto it = std_map.find(key);
+        ASSERT_EQ(iter != mem_map.end(), it != std_map.end());
+        if (it != std_map.end())
+        {
+            EXPECT_EQ(iter->second.b, it->second);
+        }
+    }
+
+    size_t count = 0;
+    for (auto& it : mem_map)
+    {
+        EXPECT_EQ(it.first, it.second.a);
+        EXPECT_EQ(std_map[it.first], it.second.b);
+        ++count;
+    }
+    EXPECT_EQ(count, std_map.size());
+
+    // 通过迭代器删除
+    while (!mem_map.empty())
+        mem_map.erase(mem_map.begin());
+    EXPECT_EQ(mem_map.size(), 0ul);
+    mem_map.clear();
+    EXPECT_TRUE(mem_map.begin() == mem_map.end());
+}
+
+TEST(MemMapTest, flat_mem_map_test_0_size)
+{
+    static const size_t MAX_SIZE = 100;
+    using MapType = FlatMemMap<uint32_t, TestNode>;
+
+    size_t mem_size = MapType::need_mem_size(MAX_SIZE, 0);
+    std::unique_ptr<char[]> raw_mem(new char[mem_size]);
+    {
+        MapType mem_map;
+        ASSERT_FALSE(mem_map.init(raw_mem.get(), mem_size - 1, MAX_SIZE, 0));
+        ASSERT_TRUE(mem_map.init(raw_mem.get(), mem_size, MAX_SIZE, 0));
+        EXPECT_EQ(mem_map.capacity(), MAX_SIZE);
+        for (uint32_t i = 1; i <= MAX_SIZE; ++i)
+        {
+            TestNode node;
+            node.a = i;
+            node.b = i * 2;
+            ASSERT_TRUE(mem_map.insert(i, node).second);
+        }
+        ASSERT_TRUE(mem_map.full());
+        ASSERT_FALSE(mem_map.insert(MAX_SIZE + 1, TestNode()).second);
+    }
+
+    // 挂到同一块内存上
+    MapType mem_map;
+    ASSERT_TRUE(mem_map.init(raw_mem.get(), mem_size, MAX_SIZE, 0, true));
+    EXPECT_EQ(mem_map.size(), MAX_SIZE);
+    for (uint32_t i = 1; i <= MAX_SIZE; ++i)
+    {
+        auto iter = mem_map.find(i);
+        ASSERT_NE(iter, mem_map.end());
+        EXPECT_EQ(iter->second.b, i * 2);
+    }
+    for (uint32_t i = 1; i <= MAX_SIZE; i += 2)
+        mem_map.erase(i);
+    EXPECT_EQ(mem_map.size(), MAX_SIZE / 2);
+    for (uint32_t i = 1; i <= MAX_SIZE; ++i)
+        EXPECT_EQ(mem_map.exist(i), i % 2 == 0);
+}
+
+// 缓存哈希值的版本，大部分冲突的节点只比较哈希值
+TEST(MemMapTest, hash_cached_mem_map_test)
+{
+    static const size_t MAX_SIZE = 1000;
+    static const size_t BUCKETS_NUM = 97;
+    HashCachedMemMap<uint32_t, TestNode, MAX_SIZE> mem_map;
+    EXPECT_EQ(mem_map.capacity(), MAX_SIZE);
+
+    using MapType = HashCachedMemMap<uint32_t, TestNode>;
+    size_t mem_size = MapType::need_mem_size(MAX_SIZE, BUCKETS_NUM);
+    size_t plain_mem_size = MemMap<uint32_t, TestNode>::need_mem_size(MAX_SIZE, BUCKETS_NUM);
+    EXPECT_GT(mem_size, plain_mem_size);
+    std::unique_ptr<char[]> raw_mem(new char[mem_size]);
+    MapType zero_map;
+    ASSERT_TRUE(zero_map.init(raw_mem.get(), mem_size, MAX_SIZE, BUCKETS_NUM));
+
+    map<uint32_t, uint32_t> std_map;
+    uint32_t seed = MAX_SIZE;
+    for (size_t round = 0; round < 20000; ++round)
+    {
+        uint32_t key = rand_r(&seed) % (MAX_SIZE * 2);
+        if (rand_r(&seed) % 3 == 0)
+        {
+            mem_map.erase(key);
+            zero_map.erase(key);
+            std_map.erase(key);
+        }
+        else if (std_map.size() < MAX_SIZE || std_map.count(key) > 0)
+        {
+            TestNode node;
+            node.a = key;
+            node.b = round;
+            bool inserted = std_map.insert(std::make_pair(key, round)).second;
+            EXPECT_EQ(mem_map.insert(key, node).second, inserted);
+            EXPECT_EQ(zero_map.insert(key, node).second, inserted);
+        }
+        ASSERT_EQ(mem_map.size(), std_map.size());
+        ASSERT_EQ(zero_map.size(), std_map.size());
+    }
+
+    for (uint32_t key = 0; key < MAX_SIZE * 2; ++key)
+    {
+        auto it = std_map.find(key);
+        auto iter = mem_map.find(key);
+        auto zero_iter = zero_map.find(key);
+        ASSERT_EQ(iter != mem_map.end(), it != std_map.end());
+        ASSERT_EQ(zero_iter != zero_map.end(), it != std_map.end());
+        if (it != std_map.end())
+        {
+            EXPECT_EQ(iter->second.b, it->second);
+            EXPECT_EQ(zero_iter->second.b, it->second);
+        }
+    }
+
+    // 迭代的时候用缓存的哈希值找下一个桶
+    size_t count = 0;
+    for (auto& it : zero_map)
+    {
+        EXPECT_EQ(std_map[it.first], it.second.b);
+        ++count;
+    }
+    EXPECT_EQ(count, std_map.size());
+    count = 0;
+    for (auto& it : mem_map)
+    {
+        EXPECT_EQ(std_map[it.first], it.second.b);
+        ++count;
+    }
+    EXPECT_EQ(count, std_map.size());
+
+    MapType attach_map;
+    ASSERT_TRUE(attach_map.init(raw_mem.get(), mem_size, MAX_SIZE, BUCKETS_NUM, true));
+    EXPECT_EQ(attach_map.size(), std_map.size());
+}
+
+// 不同的取桶算法行为要一样，连续的整数key也要能分散到不同的桶
+template <typename BUCKET, size_t MAX_SIZE = 1000>
+static void check_bucket_mode()
+{
+    static const size_t BUCKETS_NUM = MAX_SIZE;
+    using StaticMap = MemMap<uint32_t, TestNode, MAX_SIZE,
+                             inner::MemHashTable<inner::HashTablePolicy<uint32_t, TestNode, MAX_SIZE, std::hash<uint32_t>,
+                                                                        IsEqual<uint32_t>, false, BUCKET>>>;
+    using ZeroMap = MemMap<uint32_t, TestNode, 0,
+                           inner::MemHashTable<inner::HashTablePolicy<uint32_t, TestNode, 0, std::hash<uint32_t>,
+                                                                      IsEqual<uint32_t>, false, BUCKET>>>;
+    std::unique_ptr<StaticMap> static_map(new StaticMap());
+    size_t mem_size = ZeroMap::need_mem_size(MAX_SIZE, BUCKETS_NUM);
+    std::unique_ptr<char[]> raw_mem(new char[mem_size]);
+    ZeroMap zero_map;
+    ASSERT_TRUE(zero_map.init(raw_mem.get(), mem_size, MAX_SIZE, BUCKETS_NUM));
+
+    for (uint32_t i = 0; i < MAX_SIZE; ++i)
+    {
+        TestNode node;
+        node.a = i * 8;
+        ASSERT_TRUE(static_map->insert(i * 8, node).second);
+        ASSERT_TRUE(zero_map.insert(i * 8, node).second);
+    }
+    EXPECT_FALSE(zero_map.insert(MAX_SIZE * 8, TestNode()).second);
+
+    size_t count = 0;
+    for (auto& it : zero_map)
+    {
+        EXPECT_EQ(it.first, it.second.a);
+        ++count;
+    }
+    EXPECT_EQ(count, MAX_SIZE);
+    count = 0;
+    for (auto& it : *static_map)
+    {
+        EXPECT_EQ(it.first, it.second.a);
+        ++count;
+    }
+    EXPECT_EQ(count, MAX_SIZE);
+
+    for (uint32_t i = 0; i < MAX_SIZE; i += 2)
+    {
+        static_map->erase(i * 8);
+        zero_map.erase(i * 8);
+    }
+    for (uint32_t i = 0; i < MAX_SIZE * 8; ++i)
+    {
+        bool exist = i % 16 == 8;
+        EXPECT_EQ(static_map->find(i) != static_map->end(), exist);
+        EXPECT_EQ(zero_map.find(i) != zero_map.end(), exist);
+    }
+
+    ZeroMap attach_map;
+    ASSERT_TRUE(attach_map.init(raw_mem.get(), mem_size, MAX_SIZE, BUCKETS_NUM, true));
+    EXPECT_EQ(attach_map.size(), MAX_SIZE / 2);
+}
+
+TEST(MemMapTest, mem_map_test_bucket_mode)
+{
+    check_bucket_mode<inner::ModBucket>();
+    check_bucket_mode<inner::Pow2Bucket>();
+    check_bucket_mode<inner::FastRangeBucket>();
+    // 向上取整之后的桶数量256超过了MAX_SIZE的下标类型uint8_t
+    check_bucket_mode<inner::Pow2Bucket, 200>();
+
+    // 2的幂的桶数量是修正过的，申请的内存要按修正之后的算
+    EXPECT_EQ(inner::Pow2Bucket::buckets_num(1000), 1024u);
+    size_t hit[64] = {0};
+    for (size_t i = 0; i < 64 * 16; ++i)
+    {
+        ++hit[inner::Pow2Bucket::bucket(i * 64, 64)];
+        ++hit[inner::FastRangeBucket::bucket(i * 64, 64)];
+    }
+    for (size_t num : hit)
+    {
+        EXPECT_GT(num, 8u);
+        EXPECT_LT(num, 64u);
+    }
+}
+
+// 用string_view直接查char数组的key，以及调用者自己带着哈希值的接口
+template <typename MAP>
+static void check_transparent_find()
+{
+    std::unique_ptr<MAP> mem_map(new MAP());
+    for (uint32_t i = 0; i < 50; ++i)
+    {
+        std::string name = "name_" + std::to_string(i);
+        ASSERT_TRUE(mem_map->insert(NameKey(name), i).second);
+    }
+
+    for (uint32_t i = 0; i < 50; ++i)
+    {
+        std::string name = "name_" + std::to_string(i);
+        std::string_view view = name;
+        auto iter = mem_map->find(view);
+        ASSERT_TRUE(iter != mem_map->end());
+        EXPECT_EQ(iter->second, i);
+        EXPECT_TRUE(mem_map->exist(view));
+
+        size_t hash = mem_map->key_hash(view);
+        EXPECT_EQ(hash, mem_map->key_hash(NameKey(view)));
+        EXPECT_TRUE(mem_map->find_hashed(view, hash) == iter);
+        EXPECT_FALSE(mem_map->insert_hashed(NameKey(view), i + 1, hash).second);
+    }
+    EXPECT_TRUE(mem_map->find(std::string_view("name_50")) == mem_map->end());
+
+    // 先查不到再插入，哈希值只算一次
+    std::string_view new_name = "name_50";
+    size_t hash = mem_map->key_hash(new_name);
+    ASSERT_TRUE(mem_map->find_hashed(new_name, hash) == mem_map->end());
+    ASSERT_TRUE(mem_map->insert_hashed(NameKey(new_name), 50, hash).second);
+    EXPECT_EQ(mem_map->find(new_name)->second, 50u);
+
+    mem_map->erase_hashed(new_name, hash);
+    EXPECT_FALSE(mem_map->exist(new_name));
+    mem_map->erase(std::string_view("name_0"));
+    EXPECT_FALSE(mem_map->exist(std::string_view("name_0")));
+    EXPECT_EQ(mem_map->size(), 49u);
+    // 按迭代器删不能走到透明key的重载上去
+    mem_map->erase(mem_map->find(std::string_view("name_1")));
+    EXPECT_FALSE(mem_map->exist(std::string_view("name_1")));
+    EXPECT_EQ(mem_map->size(), 48u);
+}
+
+TEST(MemMapTest, mem_map_test_transparent)
+{
+    check_transparent_find<MemMap<NameKey, uint32_t, 100>>();
+    check_transparent_find<FlatMemMap<NameKey, uint32_t, 100>>();
+    check_transparent_find<HashCachedMemMap<NameKey, uint32_t, 100>>();
+
+    // 0 size的版本
+    using MapType = MemMap<NameKey, uint32_t>;
+    size_t mem_size = MapType::need_mem_size(100, 97);
+    std::unique_ptr<char[]> raw_mem(new char[mem_size]);
+    MapType mem_map;
+    ASSERT_TRUE(mem_map.init(raw_mem.get(), mem_size, 100, 97));
+    ASSERT_TRUE(mem_map.insert(NameKey("abc"), 1).second);
+    EXPECT_EQ(mem_map.find(std::string_view("abc"))->second, 1u);
+    EXPECT_TRUE(mem_map.find(std::string_view("abd")) == mem_map.end());
+}
+
+// 批量查找和一个一个查的结果要一样
+template <typename MAP>
+static void check_find_batch(MAP& mem_map_)
+{
+    for (uint32_t i = 0; i < mem_map_.capacity(); ++i)
+    {
+        TestNode node;
+        node.a = i * 3;
+        ASSERT_TRUE(mem_map_.insert(i * 3, node).second);
+    }
+
+    // 个数不是一组的整数倍，一半能找到
+    std::vector<uint32_t> keys;
+    for (uint32_t i = 0; i < 301; ++i)
+        keys.push_back(i * 3 + (i % 2));
+    std::vector<typename MAP::Iterator> iters(keys.size());
+    EXPECT_EQ(mem_map_.find_batch(keys.data(), keys.size(), iters.data()), 151u);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        EXPECT_TRUE(iters[i] == mem_map_.find(keys[i]));
+        if (iters[i] != mem_map_.end())
+        {
+            EXPECT_EQ(iters[i]->second.a, keys[i]);
+        }
+    }
+}
+
+TEST(MemMapTest, mem_map_test_find_batch)
+{
+    std::unique_ptr<MemMap<uint32_t, TestNode, 1000>> mem_map(new MemMap<uint32_t, TestNode, 1000>());
+    check_find_batch(*mem_map);
+    std::unique_ptr<FlatMemMap<uint32_t, TestNode, 1000>> flat_map(new FlatMemMap<uint32_t, TestNode, 1000>());
+    check_find_batch(*flat_map);
+
+    using MapType = MemMap<uint32_t, TestNode>;
+    size_t mem_size = MapType::need_mem_size(1000, 997);
+    std::unique_ptr<char[]> raw_mem(new char[mem_size]);
+    MapType zero_map;
+    ASSERT_TRUE(zero_map.init(raw_mem.get(), mem_size, 1000, 997));
+    check_find_batch(zero_map);
+}
+
+// 批量导入之后和一个一个插入的结果一样，后面还能正常增删
+template <typename MAP>
+static void check_build(MAP& mem_map_)
+{
+    using NodeType = typename MAP::NodeType;
+    size_t max_num = mem_map_.capacity();
+    std::vector<NodeType> nodes;
+    std::map<uint32_t, uint32_t> std_map;
+    for (uint32_t i = 0; i < max_num; ++i)
+    {
+        // 一部分key重复，先出现的留下
+        uint32_t key = i % 5 == 4 ? i - 1 : i;
+        TestNode node;
+        node.a = key;
+        node.b = i;
+        nodes.push_back({key, node});
+        std_map.insert(std::make_pair(key, i));
+    }
+    EXPECT_EQ(mem_map_.build(nodes.begin(), nodes.end()), std_map.size());
+    EXPECT_EQ(mem_map_.size(), std_map.size());
+    for (auto& it : std_map)
+    {
+        auto iter = mem_map_.find(it.first);
+        ASSERT_TRUE(iter != mem_map_.end());
+        EXPECT_EQ(iter->second.b, it.second);
+    }
+    size_t count = 0;
+    for (auto& it : mem_map_)
+    {
+        EXPECT_EQ(std_map[it.first], it.second.b);
+        ++count;
+    }
+    EXPECT_EQ(count, std_map.size());
+
+    // 表不是空的时候一个一个插入
+    for (uint32_t i = 0; i < max_num; i += 2)
+    {
+        mem_map_.erase(i);
+        std_map.erase(i);
+    }
+    EXPECT_EQ(mem_map_.build(nodes.begin(), nodes.begin() + 10), 4u);
+    for (size_t i = 0; i < 10; ++i)
+        std_map.insert(std::make_pair(nodes[i].first, nodes[i].second.b));
+    EXPECT_EQ(mem_map_.size(), std_map.size());
+    for (auto& it : std_map)
+        EXPECT_TRUE(mem_map_.exist(it.first));
+
+    // 不查重，放不下的丢掉
+    mem_map_.clear();
+    nodes.clear();
+    for (uint32_t i = 0; i < max_num + 10; ++i)
+        nodes.push_back({i, TestNode()});
+    EXPECT_EQ(mem_map_.build(nodes.begin(), nodes.end(), false), max_num);
+    EXPECT_TRUE(mem_map_.full());
+    count = 0;
+    for (uint32_t i = 0; i < max_num + 10; ++i)
+        count += mem_map_.exist(i) ? 1 : 0;
+    EXPECT_EQ(count, max_num);
+}
+
+template <typename MAP>
+void check_compact(MAP& mem_map_, bool sort_by_bucket_)
+{
+    size_t max_num = mem_map_.capacity();
+    std::map<uint32_t, uint32_t> std_map;
+    for (uint32_t i = 0; i < max_num; ++i)
+    {
+        TestNode node;
+        node.b = i;
+        ASSERT_TRUE(mem_map_.insert(i, node).second);
+        std_map[i] = i;
+    }
+    // 删掉一部分再插回来一部分，空闲链表被打乱
+    srand(17);
+    for (uint32_t i = 0; i < max_num; ++i)
+    {
+        uint32_t key = static_cast<uint32_t>(rand() % max_num);
+        mem_map_.erase(key);
+        std_map.erase(key);
+    }
+    for (uint32_t i = 0; i < max_num / 4; ++i)
+    {
+        TestNode node;
+        node.b = i;
+        if (mem_map_.insert(max_num + i, node).second)
+            std_map[max_num + i] = i;
+    }
+    ASSERT_EQ(mem_map_.size(), std_map.size());
+
+    EXPECT_GT(mem_map_.compact(sort_by_bucket_), 0u);
+    EXPECT_EQ(mem_map_.compact(sort_by_bucket_), 0u);
+    EXPECT_EQ(mem_map_.size(), std_map.size());
+    for (auto& it : std_map)
+    {
+        auto iter = mem_map_.find(it.first);
+        ASSERT_TRUE(iter != mem_map_.end());
+        EXPECT_EQ(iter->second.b, it.second);
+    }
+    size_t count = 0;
+    for (auto& it : mem_map_)
+    {
+        EXPECT_EQ(std_map[it.first], it.second.b);
+        ++count;
+    }
+    EXPECT_EQ(count, std_map.size());
+
+    // 整理之后剩下的空间都还能用
+    uint32_t key = static_cast<uint32_t>(max_num * 2);
+    while (mem_map_.size() < max_num)
+        ASSERT_TRUE(mem_map_.insert(key++, TestNode()).second);
+    EXPECT_FALSE(mem_map_.insert(key, TestNode()).second);
+    for (auto& it : std_map)
+        EXPECT_TRUE(mem_map_.exist(it.first));
+}
+
+TEST(MemMapTest, mem_map_test_compact)
+{
+    for (bool sort_by_bucket : {false, true})
+    {
+        std::unique_ptr<MemMap<uint32_t, TestNode, 1000>> mem_map(new MemMap<uint32_t, TestNode, 1000>());
+        check_compact(*mem_map, sort_by_bucket);
+        std::unique_ptr<HashCachedMemMap<uint32_t, TestNode, 1000>> cached_map(
+            new HashCachedMemMap<uint32_t, TestNode, 1000>());
+        check_compact(*cached_map, sort_by_bucket);
+        std::unique_ptr<FlatMemMap<uint32_t, TestNode, 1000>> flat_map(new FlatMemMap<uint32_t, TestNode, 1000>());
+        check_compact(*flat_map, sort_by_bucket);
+        std::unique_ptr<LiveBitmapMemMap<uint32_t, TestNode, 1000>> live_map(
+            new LiveBitmapMemMap<uint32_t, TestNode, 1000>());
+        check_compact(*live_map, sort_by_bucket);
+
+        using MapType = MemMap<uint32_t, TestNode>;
+        size_t mem_size = MapType::need_mem_size(1000, 331);
+        std::unique_ptr<char[]> raw_mem(new char[mem_size]);
+        MapType zero_map;
+        ASSERT_TRUE(zero_map.init(raw_mem.get(), mem_size, 1000, 331));
+        check_compact(zero_map, sort_by_bucket);
+
+        using LiveMapType = LiveBitmapMemMap<uint32_t, TestNode>;
+        size_t live_mem_size = LiveMapType::need_mem_size(1000, 331);
+        std::unique_ptr<char[]> live_mem(new char[live_mem_size]);
+        LiveMapType zero_live_map;
+        ASSERT_TRUE(zero_live_map.init(live_mem.get(), live_mem_size, 1000, 331));
+        check_compact(zero_live_map, sort_by_bucket);
+    }
+}
+
+template <typename MAP>
+void check_for_each(MAP& mem_map_)
+{
+    size_t max_num = mem_map_.capacity();
+    std::map<uint32_t, uint32_t> std_map;
+    auto check = [&]() {
+        std::map<uint32_t, uint32_t> visited;
+        const MAP& const_map = mem_map_;
+        const_map.for_each([&](const typename MAP::NodeType& node_) {
+            EXPECT_TRUE(visited.insert(std::make_pair(node_.first, node_.second.b)).second);
+        });
+        EXPECT_TRUE(visited == std_map);
+    };
+    check();
+
+    for (uint32_t i = 0; i < max_num; ++i)
+    {
+        TestNode node;
+        node.b = i;
+        ASSERT_TRUE(mem_map_.insert(i, node).second);
+        std_map[i] = i;
+    }
+    check();
+
+    // 删掉的槽位要跳过，空闲链上的槽位重新用上之后又能遍历到
+    for (uint32_t i = 0; i < max_num; i += 3)
+    {
+        mem_map_.erase(i);
+        std_map.erase(i);
+    }
+    check();
+    for (uint32_t i = 0; i < max_num / 6; ++i)
+    {
+        ASSERT_TRUE(mem_map_.insert(max_num + i, TestNode()).second);
+        std_map[max_num + i] = 0;
+    }
+    check();
+
+    // 非const的版本可以改值
+    mem_map_.for_each([](typename MAP::NodeType& node_) { node_.second.b += 1; });
+    for (auto& it : std_map)
+        it.second += 1;
+    check();
+
+    mem_map_.compact(true);
+    check();
+    mem_map_.clear();
+    std_map.clear();
+    check();
+}
+
+TEST(MemMapTest, mem_map_test_for_each)
+{
+    std::unique_ptr<MemMap<uint32_t, TestNode, 1000>> mem_map(new MemMap<uint32_t, TestNode, 1000>());
+    check_for_each(*mem_map);
+    std::unique_ptr<HashCachedMemMap<uint32_t, TestNode, 1000>> cached_map(
+        new HashCachedMemMap<uint32_t, TestNode, 1000>());
+    check_for_each(*cached_map);
+    std::unique_ptr<FlatMemMap<uint32_t, TestNode, 1000>> flat_map(new FlatMemMap<uint32_t, TestNode, 1000>());
+    check_for_each(*flat_map);
+    std::unique_ptr<LiveBitmapMemMap<uint32_t, TestNode, 1000>> live_map(
+        new LiveBitmapMemMap<uint32_t, TestNode, 1000>());
+    check_for_each(*live_map);
+
+    using MapType = MemMap<uint32_t, TestNode>;
+    size_t mem_size = MapType::need_mem_size(1000, 331);
+    std::unique_ptr<char[]> raw_mem(new char[mem_size]);
+    MapType zero_map;
+    ASSERT_TRUE(zero_map.init(raw_mem.get(), mem_size, 1000, 331));
+    check_for_each(zero_map);
+
+    // 位图只有开了才占内存
+    using LiveMapType = LiveBitmapMemMap<uint32_t, TestNode>;
+    EXPECT_GT(LiveMapType::need_mem_size(1000, 331), mem_size);
+    using StaticLiveMapType = LiveBitmapMemMap<uint32_t, TestNode, 1000>;
+    using StaticMapType = MemMap<uint32_t, TestNode, 1000>;
+    EXPECT_GT(sizeof(StaticLiveMapType), sizeof(StaticMapType));
+
+    size_t live_mem_size = LiveMapType::need_mem_size(1000, 331);
+    std::unique_ptr<char[]> live_mem(new char[live_mem_size]);
+    LiveMapType zero_live_map;
+    ASSERT_TRUE(zero_live_map.init(live_mem.get(), live_mem_size, 1000, 331));
+    check_for_each(zero_live_map);
+
+    // 重新挂上来位图还在
+    LiveMapType attach_map;
+    ASSERT_TRUE(attach_map.init(live_mem.get(), live_mem_size, 1000, 331, true));
+    for (uint32_t i = 0; i < 100; ++i)
+        ASSERT_TRUE(zero_live_map.insert(i, TestNode()).second);
+    size_t count = 0;
+    attach_map.for_each([&](const LiveMapType::NodeType&) { ++count; });
+    EXPECT_EQ(count, 100u);
+}
+
+TEST(MemMapTest, mem_map_test_build)
+{
+    std::unique_ptr<MemMap<uint32_t, TestNode, 1000>> mem_map(new MemMap<uint32_t, TestNode, 1000>());
+    check_build(*mem_map);
+    std::unique_ptr<HashCachedMemMap<uint32_t, TestNode, 1000>> cached_map(
+        new HashCachedMemMap<uint32_t, TestNode, 1000>());
+    check_build(*cached_map);
+    std::unique_ptr<FlatMemMap<uint32_t, TestNode, 1000>> flat_map(new FlatMemMap<uint32_t, TestNode, 1000>());
+    check_build(*flat_map);
+
+    using MapType = MemMap<uint32_t, TestNode>;
+    size_t mem_size = MapType::need_mem_size(1000, 331);
+    std::unique_ptr<char[]> raw_mem(new char[mem_size]);
+    MapType zero_map;
+    ASSERT_TRUE(zero_map.init(raw_mem.get(), mem_size, 1000, 331));
+    check_build(zero_map);
+}
+
+static const uint32_t JOURNAL_NUM = 1000;
+
+// 插入的子进程写节点的时候挂了，恢复出来和插入之前一样，后面还能正常增删
+template <typename MAP>
+static void check_journal_recovered(MAP& mem_map_, size_t size_)
+{
+    EXPECT_EQ(mem_map_.size(), size_);
+    EXPECT_FALSE(mem_map_.exist(JOURNAL_NUM));
+    size_t count = 0;
+    for (auto& it : mem_map_)
+    {
+        EXPECT_EQ(it.first, it.second.a);
+        ++count;
+    }
+    EXPECT_EQ(count, size_);
+    for (uint32_t i = 0; i < JOURNAL_NUM; i += 5)
+    {
+        TestNode node;
+        node.a = i;
+        ASSERT_TRUE(mem_map_.insert(i, node).second);
+    }
+    TestNode node;
+    node.a = JOURNAL_NUM;
+    ASSERT_TRUE(mem_map_.insert(JOURNAL_NUM, node).second);
+    EXPECT_EQ(mem_map_.size(), JOURNAL_NUM + 1);
+    EXPECT_EQ(mem_map_.find(JOURNAL_NUM)->second.a, JOURNAL_NUM);
+}
+
+// 插满之后每5个删一个，插入的时候要从空闲链上摘节点，返回最后删的节点，子进程就是往这个节点写
+template <typename MAP>
+static const void* prepare_journal(MAP& mem_map_)
+{
+    for (uint32_t i = 0; i < JOURNAL_NUM; ++i)
+    {
+        TestNode node;
+        node.a = i;
+        EXPECT_TRUE(mem_map_.insert(i, node).second);
+    }
+    const void* node = nullptr;
+    for (uint32_t i = 0; i < JOURNAL_NUM; i += 5)
+    {
+        node = &mem_map_.find(i)->second;
+        mem_map_.erase(i);
+    }
+    return node;
+}
+
+TEST(MemMapTest, mem_map_test_journal)
+{
+    using MapType = JournaledMemMap<uint32_t, TestNode>;
+    size_t mem_size = MapType::need_mem_size(JOURNAL_NUM + 1, JOURNAL_NUM);
+    uint8_t* mem = map_shared(mem_size);
+    ASSERT_NE(mem, nullptr);
+    {
+        MapType mem_map;
+        ASSERT_TRUE(mem_map.init(mem, mem_size, JOURNAL_NUM + 1, JOURNAL_NUM));
+        const void* node = prepare_journal(mem_map);
+        size_t size = mem_map.size();
+        EXPECT_DEATH(
+            {
+                crash_on_write(mem, mem_size, node);
+                mem_map.insert(JOURNAL_NUM, TestNode());
+            },
+            "");
+
+        // 动态大小的挂上来的时候就恢复了
+        MapType attach_map;
+        ASSERT_TRUE(attach_map.init(mem, mem_size, JOURNAL_NUM + 1, JOURNAL_NUM, true));
+        EXPECT_FALSE(attach_map.recover());
+        check_journal_recovered(attach_map, size);
+    }
+    munmap(mem, mem_size);
+
+    // 固定大小的整个对象放在共享内存里面，挂上来之后自己调recover
+    using StaticMapType = JournaledMemMap<uint32_t, TestNode, JOURNAL_NUM + 1>;
+    mem = map_shared(sizeof(StaticMapType));
+    ASSERT_NE(mem, nullptr);
+    {
+        StaticMapType* mem_map = new (mem) StaticMapType();
+        const void* node = prepare_journal(*mem_map);
+        size_t size = mem_map->size();
+        EXPECT_DEATH(
+            {
+                crash_on_write(mem, sizeof(StaticMapType), node);
+                mem_map->insert(JOURNAL_NUM, TestNode());
+            },
+            "");
+        EXPECT_TRUE(mem_map->recover());
+        EXPECT_FALSE(mem_map->recover());
+        check_journal_recovered(*mem_map, size);
+
+        // 没调recover的话下一次修改开始之前也会先撤销
+        node = &mem_map->find(0)->second;
+        mem_map->erase(0);
+        size = mem_map->size();
+        EXPECT_DEATH(
+            {
+                crash_on_write(mem, sizeof(StaticMapType), node);
+                mem_map->insert(JOURNAL_NUM + 1, TestNode());
+            },
+            "");
+        TestNode value;
+        value.a = JOURNAL_NUM + 2;
+        ASSERT_TRUE(mem_map->insert(JOURNAL_NUM + 2, value).second);
+        EXPECT_FALSE(mem_map->recover());
+        EXPECT_EQ(mem_map->size(), size + 1);
+        EXPECT_FALSE(mem_map->exist(JOURNAL_NUM + 1));
+        size_t count = 0;
+        for (auto& it : *mem_map)
+        {
+            EXPECT_EQ(it.first, it.second.a);
+            ++count;
+        }
+        EXPECT_EQ(count, size + 1);
+    }
+    munmap(mem, sizeof(StaticMapType));
+}
+
+// 日志和被改的字段要在同一块内存里面
+struct JournalTestData
+{
+    inner::UndoJournal journal;
+    uint32_t a = 0;
+    uint64_t b = 0;
+};
+
+TEST(MemMapTest, mem_map_test_journal_guard)
+{
+    JournalTestData data;
+    // 抛了异常里外两层改的都撤销掉
+    try
+    {
+        inner::UndoJournal::Guard guard(data.journal);
+        data.journal.set(data.a, 1);
+        inner::UndoJournal::Guard inner_guard(data.journal);
+        data.journal.set(data.b, 2);
+        throw std::runtime_error("journal");
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+    EXPECT_EQ(data.a, 0u);
+    EXPECT_EQ(data.b, 0u);
+    EXPECT_EQ(data.journal.m_num, 0u);
+
+    // 里面那层的异常接住了的话只撤销里面那层，外面那层照常提交
+    {
+        inner::UndoJournal::Guard guard(data.journal);
+        data.journal.set(data.a, 1);
+        try
+        {
+            inner::UndoJournal::Guard inner_guard(data.journal);
+            data.journal.set(data.b, 2);
+            throw std::runtime_error("journal");
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+        EXPECT_EQ(data.b, 0u);
+    }
+    EXPECT_EQ(data.a, 1u);
+    EXPECT_EQ(data.journal.m_num, 0u);
+
+    // 不在Guard里面直接写，不记日志
+    data.journal.set(data.b, 3);
+    EXPECT_EQ(data.b, 3u);
+    EXPECT_EQ(data.journal.m_num, 0u);
+
+    // 一次修改记的字段太多，直接挂掉
+    EXPECT_DEATH(
+        {
+            inner::UndoJournal::Guard guard(data.journal);
+            for (uint32_t i = 0; i <= inner::UndoJournal::MAX_ENTRY_NUM; ++i)
+                data.journal.set(data.a, i);
+        },
+        "UndoJournal overflow");
+
+    // 改到一半挂了留下的日志，下一次修改开始之前先撤销掉
+    uint8_t* mem = map_shared(sizeof(JournalTestData));
+    ASSERT_NE(mem, nullptr);
+    JournalTestData* shared = new (mem) JournalTestData();
+    EXPECT_DEATH(
+        {
+            inner::UndoJournal::Guard guard(shared->journal);
+            shared->journal.set(shared->a, 5);
+            abort();
+        },
+        "");
+    EXPECT_EQ(shared->a, 5u);
+    EXPECT_EQ(shared->journal.m_num, 1u);
+    {
+        inner::UndoJournal::Guard guard(shared->journal);
+        EXPECT_EQ(shared->a, 0u);
+        shared->journal.set(shared->b, 6);
+    }
+    EXPECT_EQ(shared->b, 6u);
+    EXPECT_EQ(shared->journal.m_num, 0u);
+    munmap(mem, sizeof(JournalTestData));
+}
+
 #endif
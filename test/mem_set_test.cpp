@@ -13,6 +13,7 @@
 #include <iostream>
 #include <map>
 #include <set>
+#include <vector>
 #include "base_test_struct.h"
 #include "gtest/gtest.h"
 #include "mem_set.h"
@@ -464,4 +465,109 @@ TEST(MemSetTest, mem_set_test_insert)
 }
 */
 
+TEST(MemSetTest, flat_mem_set_test)
+{
+    static const size_t MAX_SIZE = 1027;
+    FlatMemSet<TestNode, MAX_SIZE> mem_set;
+    ASSERT_TRUE(mem_set.empty());
+    EXPECT_EQ(mem_set.capacity(), MAX_SIZE);
+
+    for (size_t i = 1; i < MAX_SIZE + 1; ++i)
+    {
+        TestNode node;
+        node.a = i;
+        node.b = i * 3;
+        ASSERT_TRUE(mem_set.insert(node).second);
+        ASSERT_FALSE(mem_set.insert(node).second);
+    }
+    ASSERT_TRUE(mem_set.full());
+
+    set<uint32_t> key_set;
+    for (auto& it : mem_set)
+    {
+        EXPECT_EQ(it.b, it.a * 3);
+        ASSERT_TRUE(key_set.insert(it.a).second);
+    }
+    EXPECT_EQ(key_set.size(), MAX_SIZE);
+
+    // 删除一半再插回来，复用删除掉的槽位
+    for (size_t i = 1; i < MAX_SIZE + 1; i += 2)
+    {
+        TestNode node;
+        node.a = i;
+        mem_set.erase(node);
+        ASSERT_FALSE(mem_set.exist(node));
+    }
+    EXPECT_EQ(mem_set.size(), MAX_SIZE / 2);
+    for (size_t i = 1; i < MAX_SIZE + 1; i += 2)
+    {
+        TestNode node;
+        node.a = i;
+        node.b = i * 3;
+        ASSERT_TRUE(mem_set.insert(node).second);
+    }
+    ASSERT_TRUE(mem_set.full());
+    for (size_t i = 1; i < MAX_SIZE + 1; ++i)
+    {
+        TestNode node;
+        node.a = i;
+        auto iter = mem_set.find(node);
+        ASSERT_NE(iter, mem_set.end());
+        EXPECT_EQ(iter->b, i * 3);
+    }
+}
+
+TEST(MemSetTest, mem_set_test_find_batch)
+{
+    static const size_t MAX_SIZE = 100;
+    MemSet<uint32_t, MAX_SIZE> mem_set;
+    for (uint32_t i = 0; i < MAX_SIZE; ++i)
+        ASSERT_TRUE(mem_set.insert(i * 2).second);
+
+    std::vector<uint32_t> values;
+    for (uint32_t i = 0; i < 50; ++i)
+        values.push_back(i);
+    std::vector<MemSet<uint32_t, MAX_SIZE>::Iterator> iters(values.size());
+    EXPECT_EQ(mem_set.find_batch(values.data(), values.size(), iters.data()), 25u);
+    for (size_t i = 0; i < values.size(); ++i)
+        EXPECT_TRUE(iters[i] == mem_set.find(values[i]));
+}
+
+TEST(MemSetTest, mem_set_test_build)
+{
+    static const size_t MAX_SIZE = 100;
+    MemSet<uint32_t, MAX_SIZE> mem_set;
+    std::vector<uint32_t> values;
+    for (uint32_t i = 0; i < MAX_SIZE; ++i)
+        values.push_back(i / 2);
+    EXPECT_EQ(mem_set.build(values.begin(), values.end()), MAX_SIZE / 2);
+    for (uint32_t i = 0; i < MAX_SIZE; ++i)
+        EXPECT_EQ(mem_set.exist(i), i < MAX_SIZE / 2);
+}
+
+template <typename SET>
+void check_for_each(SET& mem_set_)
+{
+    size_t max_size = mem_set_.capacity();
+    for (uint32_t i = 0; i < max_size; ++i)
+        ASSERT_TRUE(mem_set_.insert(i).second);
+    for (uint32_t i = 0; i < max_size; i += 3)
+        mem_set_.erase(i);
+
+    std::set<uint32_t> visited;
+    mem_set_.for_each([&](const uint32_t& value_) { EXPECT_TRUE(visited.insert(value_).second); });
+    EXPECT_EQ(visited.size(), mem_set_.size());
+    for (uint32_t i = 0; i < max_size; ++i)
+        EXPECT_EQ(visited.count(i) != 0, i % 3 != 0);
+}
+
+TEST(MemSetTest, mem_set_test_for_each)
+{
+    static const size_t MAX_SIZE = 200;
+    MemSet<uint32_t, MAX_SIZE> mem_set;
+    check_for_each(mem_set);
+    LiveBitmapMemSet<uint32_t, MAX_SIZE> live_set;
+    check_for_each(live_set);
+}
+
 #endif
@@ -0,0 +1,127 @@
+/*
+ * * file name: migrating_mem_map_test.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _MIGRATING_MEM_MAP_TEST_H_
+#define _MIGRATING_MEM_MAP_TEST_H_
+
+#include "migrating_mem_map.h"
+#include <map>
+#include <memory>
+#include "base_test_struct.h"
+#include "gtest/gtest.h"
+#include "mem_map.h"
+
+using namespace pepper;
+
+TEST(MigratingMemMapTest, migrating_mem_map_normal)
+{
+    static const size_t OLD_MAX_NUM = 100;
+    static const size_t OLD_BUCKETS_NUM = 97;
+    static const size_t NEW_MAX_NUM = 400;
+    static const size_t NEW_BUCKETS_NUM = 397;
+    using OldMap = MemMap<uint32_t, TestNode>;
+    using MapType = MigratingMemMap<uint32_t, TestNode>;
+
+    // 旧表已经满了
+    size_t old_mem_size = OldMap::need_mem_size(OLD_MAX_NUM, OLD_BUCKETS_NUM);
+    std::unique_ptr<char[]> old_mem(new char[old_mem_size]);
+    OldMap old_map;
+    ASSERT_TRUE(old_map.init(old_mem.get(), old_mem_size, OLD_MAX_NUM, OLD_BUCKETS_NUM));
+    std::map<uint32_t, uint32_t> std_map;
+    for (uint32_t i = 0; i < OLD_MAX_NUM; ++i)
+    {
+        TestNode node;
+        node.a = i;
+        node.b = i * 2;
+        ASSERT_TRUE(old_map.insert(i, node).second);
+        std_map[i] = node.b;
+    }
+    ASSERT_TRUE(old_map.full());
+
+    size_t new_mem_size = MapType::need_mem_size(NEW_MAX_NUM, NEW_BUCKETS_NUM);
+    std::unique_ptr<char[]> new_mem(new char[new_mem_size]);
+    MapType mem_map;
+    // 新表放不下旧表的数据
+    ASSERT_FALSE(mem_map.init(old_mem.get(), old_mem_size, OLD_MAX_NUM, OLD_BUCKETS_NUM, new_mem.get(),
+                              MapType::need_mem_size(OLD_MAX_NUM - 1, NEW_BUCKETS_NUM), OLD_MAX_NUM - 1,
+                              NEW_BUCKETS_NUM));
+    ASSERT_TRUE(mem_map.init(old_mem.get(), old_mem_size, OLD_MAX_NUM, OLD_BUCKETS_NUM, new_mem.get(), new_mem_size,
+                             NEW_MAX_NUM, NEW_BUCKETS_NUM));
+    mem_map.set_step_per_op(1);
+    EXPECT_EQ(mem_map.size(), OLD_MAX_NUM);
+    EXPECT_EQ(mem_map.capacity(), NEW_MAX_NUM);
+    EXPECT_FALSE(mem_map.finished());
+
+    // 查找是只读的，不会顺带搬桶
+    for (uint32_t i = 0; i < OLD_MAX_NUM; ++i)
+    {
+        TestNode* value = mem_map.find(i);
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->b, std_map[i]);
+        EXPECT_TRUE(mem_map.exist(i));
+    }
+    EXPECT_EQ(old_map.size(), OLD_MAX_NUM);
+
+    // 边搬边读写
+    for (uint32_t i = 0; i < OLD_MAX_NUM; ++i)
+    {
+        TestNode node;
+        node.a = i + OLD_MAX_NUM;
+        node.b = i;
+        ASSERT_TRUE(mem_map.insert(node.a, node));
+        ASSERT_FALSE(mem_map.insert(i, node));
+        std_map[node.a] = node.b;
+        if (i % 3 == 0)
+        {
+            ASSERT_TRUE(mem_map.erase(i));
+            ASSERT_FALSE(mem_map.erase(i));
+            std_map.erase(i);
+        }
+        for (uint32_t j = 0; j < OLD_MAX_NUM * 2; j += 7)
+        {
+            const TestNode* value = mem_map.find(j);
+            auto it = std_map.find(j);
+            ASSERT_EQ(value != nullptr, it != std_map.end());
+            if (value)
+            {
+                EXPECT_EQ(value->b, it->second);
+            }
+        }
+    }
+    EXPECT_EQ(mem_map.size(), std_map.size());
+
+    // 另外一个进程中途挂上来
+    MapType attach_map;
+    ASSERT_TRUE(attach_map.init(old_mem.get(), old_mem_size, OLD_MAX_NUM, OLD_BUCKETS_NUM, new_mem.get(),
+                                new_mem_size, NEW_MAX_NUM, NEW_BUCKETS_NUM, true));
+    EXPECT_EQ(attach_map.size(), std_map.size());
+
+    while (!attach_map.finished())
+        ASSERT_GT(attach_map.step(8), 0u);
+    EXPECT_TRUE(mem_map.finished());
+    EXPECT_EQ(old_map.size(), 0u);
+
+    size_t count = 0;
+    mem_map.for_each([&](const MapType::NodeType& node_) {
+        EXPECT_EQ(std_map[node_.first], node_.second.b);
+        ++count;
+    });
+    EXPECT_EQ(count, std_map.size());
+
+    // 搬完之后新的那块内存就是一个普通的MemMap
+    MemMap<uint32_t, TestNode> new_map;
+    ASSERT_TRUE(new_map.init(new_mem.get(), new_mem_size, NEW_MAX_NUM, NEW_BUCKETS_NUM, true));
+    EXPECT_EQ(new_map.size(), std_map.size());
+    for (auto& it : std_map)
+    {
+        auto iter = new_map.find(it.first);
+        ASSERT_TRUE(iter != new_map.end());
+        EXPECT_EQ(iter->second.b, it.second);
+    }
+}
+
+#endif
@@ -9,15 +9,22 @@
 #define _RING_BUFFER_TEST_H_
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
+#include <thread>
 #include <vector>
 #include "base_test_struct.h"
 #include "fixed_ring_buf.h"
 #include "gtest/gtest.h"
+#include "mirror_ring_buf.h"
+#include "mpmc_fixed_ring_buf.h"
+#include "spsc_unfixed_ring_buf.h"
 #include "unfixed_ring_buf.h"
+#include "waitable_ring_buf.h"
 
 using namespace pepper;
 using std::map;
@@ -516,4 +523,893 @@ TEST(RingBufferTest, un_fixed_ring_buffer_0)
     }
 }
 
+// 测试单生产者单消费者的不定长队列
+TEST(RingBufferTest, spsc_un_fixed_ring_buffer_1024)
+{
+    static const size_t MAX_SIZE = 1024;
+    SPSCUnfixedRingBuf<MAX_SIZE> ring_buf;
+
+    ASSERT_TRUE(ring_buf.empty());
+    EXPECT_EQ(ring_buf.size(), 0ul);
+    EXPECT_EQ(ring_buf.capacity(), MAX_SIZE);
+    EXPECT_EQ(ring_buf.get_num(), 0ul);
+
+    size_t len = 0;
+    EXPECT_EQ(ring_buf.front(len), nullptr);
+
+    // 一直插入到满，然后一边弹出一边插入，覆盖回绕和填充的情况
+    size_t push_index = 1;
+    size_t pop_index = 1;
+    for (size_t round = 0; round < 8; ++round)
+    {
+        while (true)
+        {
+            TestNode node;
+            node.base = push_index;
+            node.a = push_index;
+            node.c = push_index * 3;
+            size_t node_len = push_index % 3 == 0 ? sizeof(TestNode) : sizeof(BaseNode);
+            if (!ring_buf.push(reinterpret_cast<uint8_t*>(&node), node_len))
+                break;
+            ++push_index;
+        }
+
+        EXPECT_EQ(ring_buf.get_num(), push_index - pop_index);
+        ASSERT_FALSE(ring_buf.empty());
+
+        size_t pop_num = ring_buf.get_num() / 2 + 1;
+        for (size_t i = 0; i < pop_num; ++i)
+        {
+            auto data = ring_buf.front(len);
+            ASSERT_NE(data, nullptr);
+            const BaseNode* node = reinterpret_cast<const BaseNode*>(data);
+            EXPECT_EQ(node->base, pop_index);
+            if (pop_index % 3 == 0)
+            {
+                EXPECT_EQ(len, sizeof(TestNode));
+                EXPECT_EQ(reinterpret_cast<const TestNode*>(data)->c, pop_index * 3);
+            }
+            else
+                EXPECT_EQ(len, sizeof(BaseNode));
+            ring_buf.pop();
+            ++pop_index;
+        }
+    }
+
+    while (!ring_buf.empty())
+    {
+        auto data = ring_buf.front(len);
+        ASSERT_NE(data, nullptr);
+        EXPECT_EQ(reinterpret_cast<const BaseNode*>(data)->base, pop_index);
+        ring_buf.pop();
+        ++pop_index;
+    }
+    EXPECT_EQ(pop_index, push_index);
+    EXPECT_EQ(ring_buf.get_num(), 0ul);
+    EXPECT_EQ(ring_buf.size(), 0ul);
+
+    uint8_t big_data[MAX_SIZE] = {0};
+    ASSERT_FALSE(ring_buf.push(big_data, MAX_SIZE));
+}
+
+// 队列空了写位置也不会回到开头，跨过buffer结尾的数据包在空队列上也要能写进去
+template <typename RING_BUF>
+void check_spsc_wrap_empty(RING_BUF& ring_buf_)
+{
+    size_t max_size = ring_buf_.capacity();
+    std::vector<uint8_t> data(max_size);
+    // 加上头部超过一半的直接拒绝
+    EXPECT_FALSE(ring_buf_.push(data.data(), max_size / 2));
+    size_t max_len = max_size / 2;
+    while (!ring_buf_.push(data.data(), max_len))
+        --max_len;
+    ring_buf_.pop();
+    ASSERT_TRUE(ring_buf_.empty());
+
+    // 每次都是空队列，写位置转好几圈，每个位置上写最大的包都会跨过结尾
+    for (size_t i = 0; i < 100; ++i)
+    {
+        size_t len = i % 2 == 0 ? max_len : (i * 97) % max_len + 1;
+        for (size_t j = 0; j < len; ++j)
+            data[j] = static_cast<uint8_t>(i + j);
+        ASSERT_TRUE(ring_buf_.push(data.data(), len));
+        size_t front_len = 0;
+        const uint8_t* front = ring_buf_.front(front_len);
+        ASSERT_NE(front, nullptr);
+        ASSERT_EQ(front_len, len);
+        EXPECT_EQ(memcmp(front, data.data(), len), 0);
+        ring_buf_.pop();
+        ASSERT_TRUE(ring_buf_.empty());
+    }
+}
+
+TEST(RingBufferTest, spsc_un_fixed_ring_buffer_wrap_empty)
+{
+    static const size_t MAX_SIZE = 1024;
+    SPSCUnfixedRingBuf<MAX_SIZE> ring_buf;
+    check_spsc_wrap_empty(ring_buf);
+
+    size_t mem_size = SPSCUnfixedRingBuf<>::need_mem_size(MAX_SIZE);
+    std::unique_ptr<uint8_t[]> mem(new uint8_t[mem_size]);
+    SPSCUnfixedRingBuf<> dynamic_ring_buf;
+    ASSERT_TRUE(dynamic_ring_buf.init(mem.get(), mem_size));
+    check_spsc_wrap_empty(dynamic_ring_buf);
+}
+
+// 测试单生产者单消费者的不定长队列特化版本，一个线程写一个线程读
+TEST(RingBufferTest, spsc_un_fixed_ring_buffer_0)
+{
+    static const size_t MAX_SIZE = 4096;
+    static const size_t TOTAL_NUM = 200000;
+
+    size_t mem_size = SPSCUnfixedRingBuf<>::need_mem_size(MAX_SIZE);
+    auto p = new uint8_t[mem_size];
+    SPSCUnfixedRingBuf<> producer_buf;
+    ASSERT_TRUE(producer_buf.init(p, mem_size));
+    EXPECT_EQ(producer_buf.capacity(), MAX_SIZE);
+
+    // 另外一个对象挂到同一块内存上，模拟另外一个进程
+    SPSCUnfixedRingBuf<> consumer_buf;
+    ASSERT_TRUE(consumer_buf.init(p, mem_size, true));
+
+    std::thread producer([&producer_buf]() {
+        uint8_t data[256];
+        for (size_t i = 0; i < TOTAL_NUM;)
+        {
+            size_t len = sizeof(uint32_t) + i % (sizeof(data) - sizeof(uint32_t));
+            uint32_t value = i;
+            memcpy(data, &value, sizeof(value));
+            memset(data + sizeof(value), static_cast<uint8_t>(i), len - sizeof(value));
+            if (producer_buf.push(data, len))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    size_t error_num = 0;
+    for (size_t i = 0; i < TOTAL_NUM;)
+    {
+        size_t len = 0;
+        auto data = consumer_buf.front(len);
+        if (data == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint32_t value = 0;
+        memcpy(&value, data, sizeof(value));
+        if (value != i || len != sizeof(uint32_t) + i % (256 - sizeof(uint32_t)))
+            ++error_num;
+        for (size_t j = sizeof(value); j < len; ++j)
+        {
+            if (data[j] != static_cast<uint8_t>(i))
+                ++error_num;
+        }
+        consumer_buf.pop();
+        ++i;
+    }
+    producer.join();
+
+    EXPECT_EQ(error_num, 0ul);
+    ASSERT_TRUE(consumer_buf.empty());
+    EXPECT_EQ(consumer_buf.get_num(), 0ul);
+    delete[] p;
+}
+
+// 测试不定长队列的reserve和commit
+TEST(RingBufferTest, un_fixed_ring_buffer_reserve)
+{
+    static const size_t MAX_SIZE = 1024;
+    UnfixedRingBuf<MAX_SIZE> ring_buf;
+
+    // 没有reserve不能commit
+    ASSERT_FALSE(ring_buf.commit(0));
+
+    size_t push_index = 1;
+    size_t pop_index = 1;
+    for (size_t round = 0; round < 16; ++round)
+    {
+        while (true)
+        {
+            // 预留的比实际写的多
+            uint8_t* data = ring_buf.reserve(sizeof(TestNode) * 2);
+            if (data == nullptr)
+                break;
+            TestNode node;
+            node.base = push_index;
+            node.c = push_index * 3;
+            memcpy(data, &node, sizeof(node));
+            ASSERT_FALSE(ring_buf.commit(sizeof(TestNode) * 2 + 1));
+            ASSERT_TRUE(ring_buf.commit(sizeof(TestNode)));
+            ASSERT_FALSE(ring_buf.commit(sizeof(TestNode)));
+            ++push_index;
+        }
+
+        EXPECT_EQ(ring_buf.get_num(), push_index - pop_index);
+        size_t pop_num = ring_buf.get_num() / 2 + 1;
+        for (size_t i = 0; i < pop_num; ++i)
+        {
+            size_t len = 0;
+            auto data = ring_buf.front(len);
+            ASSERT_NE(data, nullptr);
+            EXPECT_EQ(len, sizeof(TestNode));
+            EXPECT_EQ(reinterpret_cast<const TestNode*>(data)->base, pop_index);
+            EXPECT_EQ(reinterpret_cast<const TestNode*>(data)->c, pop_index * 3);
+            ring_buf.pop();
+            ++pop_index;
+        }
+    }
+
+    // 覆盖写的reserve
+    size_t base_index = 0;
+    for (size_t i = 1; i <= MAX_SIZE; ++i)
+    {
+        uint8_t* data = ring_buf.reserve(sizeof(BaseNode), true);
+        ASSERT_NE(data, nullptr);
+        BaseNode node;
+        node.base = i;
+        memcpy(data, &node, sizeof(node));
+        ASSERT_TRUE(ring_buf.commit(sizeof(node)));
+        base_index = i;
+    }
+
+    size_t num = ring_buf.get_num();
+    for (size_t i = 0; i < num; ++i)
+    {
+        size_t len = 0;
+        auto data = ring_buf.front(len, i);
+        ASSERT_NE(data, nullptr);
+        EXPECT_EQ(reinterpret_cast<const BaseNode*>(data)->base, base_index - num + 1 + i);
+    }
+}
+
+// 测试单生产者单消费者队列的reserve和commit
+TEST(RingBufferTest, spsc_un_fixed_ring_buffer_reserve)
+{
+    static const size_t MAX_SIZE = 1000;
+    size_t mem_size = SPSCUnfixedRingBuf<>::need_mem_size(MAX_SIZE);
+    auto p = new uint8_t[mem_size];
+    SPSCUnfixedRingBuf<> ring_buf;
+    ASSERT_TRUE(ring_buf.init(p, mem_size));
+    ASSERT_FALSE(ring_buf.commit(0));
+
+    size_t push_index = 1;
+    size_t pop_index = 1;
+    for (size_t round = 0; round < 16; ++round)
+    {
+        while (true)
+        {
+            size_t reserve_len = sizeof(TestNode) + 3 + push_index % 7;
+            uint8_t* data = ring_buf.reserve(reserve_len);
+            if (data == nullptr)
+                break;
+            // reserve了还没有commit，消费者看不到
+            ASSERT_EQ(ring_buf.get_num(), push_index - pop_index);
+            TestNode node;
+            node.base = push_index;
+            node.c = push_index * 3;
+            memcpy(data, &node, sizeof(node));
+            ASSERT_FALSE(ring_buf.commit(reserve_len + 1));
+            ASSERT_TRUE(ring_buf.commit(sizeof(TestNode) + push_index % 3));
+            ++push_index;
+        }
+
+        size_t pop_num = ring_buf.get_num() / 2 + 1;
+        for (size_t i = 0; i < pop_num; ++i)
+        {
+            size_t len = 0;
+            auto data = ring_buf.front(len);
+            ASSERT_NE(data, nullptr);
+            EXPECT_EQ(len, sizeof(TestNode) + pop_index % 3);
+            EXPECT_EQ(reinterpret_cast<const TestNode*>(data)->base, pop_index);
+            EXPECT_EQ(reinterpret_cast<const TestNode*>(data)->c, pop_index * 3);
+            ring_buf.pop();
+            ++pop_index;
+        }
+    }
+    delete[] p;
+}
+
+// 测试不定长队列的遍历和批量弹出
+TEST(RingBufferTest, un_fixed_ring_buffer_batch)
+{
+    static const size_t MAX_SIZE = 1024;
+    UnfixedRingBuf<> ring_buf;
+    auto p = new uint8_t[MAX_SIZE];
+    ASSERT_TRUE(ring_buf.init(p, MAX_SIZE));
+    ASSERT_TRUE(ring_buf.begin() == ring_buf.end());
+    EXPECT_EQ(ring_buf.pop_n(1), 0ul);
+
+    size_t push_index = 1;
+    size_t pop_index = 1;
+    for (size_t round = 0; round < 16; ++round)
+    {
+        while (true)
+        {
+            TestNode node;
+            node.base = push_index;
+            size_t node_len = push_index % 3 == 0 ? sizeof(TestNode) : sizeof(BaseNode);
+            if (!ring_buf.push(reinterpret_cast<uint8_t*>(&node), node_len))
+                break;
+            ++push_index;
+        }
+
+        // 游标遍历和front的结果一致
+        size_t index = 0;
+        for (auto iter = ring_buf.begin(); iter != ring_buf.end(); ++iter, ++index)
+        {
+            size_t len = 0;
+            auto data = ring_buf.front(len, index);
+            EXPECT_EQ(iter.data(), data);
+            EXPECT_EQ(iter.len(), len);
+            EXPECT_EQ(reinterpret_cast<const BaseNode*>(iter.data())->base, pop_index + index);
+        }
+        EXPECT_EQ(index, ring_buf.get_num());
+
+        // 批量处理一部分，回调返回false的那个不弹出
+        size_t stop_index = pop_index + ring_buf.get_num() / 3;
+        size_t num = ring_buf.consume(
+            [&pop_index, stop_index](const uint8_t* data_, size_t len_) {
+                auto node = reinterpret_cast<const BaseNode*>(data_);
+                if (node->base == stop_index)
+                    return false;
+                EXPECT_EQ(node->base, pop_index);
+                EXPECT_EQ(len_, pop_index % 3 == 0 ? sizeof(TestNode) : sizeof(BaseNode));
+                ++pop_index;
+                return true;
+            },
+            push_index);
+        EXPECT_EQ(pop_index, stop_index);
+        EXPECT_EQ(ring_buf.get_num(), push_index - pop_index);
+
+        size_t len = 0;
+        auto data = ring_buf.front(len);
+        ASSERT_NE(data, nullptr);
+        EXPECT_EQ(reinterpret_cast<const BaseNode*>(data)->base, pop_index);
+
+        num = ring_buf.get_num() / 2;
+        EXPECT_EQ(ring_buf.pop_n(num), num);
+        pop_index += num;
+        data = ring_buf.front(len);
+        ASSERT_NE(data, nullptr);
+        EXPECT_EQ(reinterpret_cast<const BaseNode*>(data)->base, pop_index);
+    }
+
+    size_t left_num = ring_buf.get_num();
+    EXPECT_EQ(ring_buf.pop_n(left_num + 10), left_num);
+    ASSERT_TRUE(ring_buf.empty());
+    EXPECT_EQ(ring_buf.size(), 0ul);
+    delete[] p;
+}
+
+// 测试单生产者单消费者队列的批量处理
+TEST(RingBufferTest, spsc_un_fixed_ring_buffer_consume)
+{
+    static const size_t MAX_SIZE = 1024;
+    SPSCUnfixedRingBuf<MAX_SIZE> ring_buf;
+
+    size_t push_index = 1;
+    size_t pop_index = 1;
+    for (size_t round = 0; round < 16; ++round)
+    {
+        while (true)
+        {
+            TestNode node;
+            node.base = push_index;
+            size_t node_len = push_index % 3 == 0 ? sizeof(TestNode) : sizeof(BaseNode);
+            if (!ring_buf.push(reinterpret_cast<uint8_t*>(&node), node_len))
+                break;
+            ++push_index;
+        }
+
+        size_t max_num = ring_buf.get_num() / 2 + 1;
+        size_t num = ring_buf.consume(
+            [&pop_index](const uint8_t* data_, size_t len_) {
+                EXPECT_EQ(reinterpret_cast<const BaseNode*>(data_)->base, pop_index);
+                EXPECT_EQ(len_, pop_index % 3 == 0 ? sizeof(TestNode) : sizeof(BaseNode));
+                ++pop_index;
+                return true;
+            },
+            max_num);
+        EXPECT_EQ(num, max_num);
+        EXPECT_EQ(ring_buf.get_num(), push_index - pop_index);
+    }
+
+    size_t num = ring_buf.consume([](const uint8_t*, size_t) { return true; }, push_index);
+    EXPECT_EQ(num, push_index - pop_index);
+    ASSERT_TRUE(ring_buf.empty());
+    EXPECT_EQ(ring_buf.get_num(), 0ul);
+}
+
+// 测试多生产者多消费者的定长队列
+TEST(RingBufferTest, mpmc_fixed_ring_buffer_1024)
+{
+    static const size_t MAX_SIZE = 1024;
+    auto ring_buf = new MPMCFixedRingBuf<TestNode, MAX_SIZE>();
+
+    ASSERT_TRUE(ring_buf->empty());
+    ASSERT_FALSE(ring_buf->full());
+    EXPECT_EQ(ring_buf->capacity(), MAX_SIZE);
+
+    TestNode node;
+    ASSERT_FALSE(ring_buf->pop(node));
+
+    // 单线程多轮写满读空，覆盖序号回绕的情况
+    for (size_t round = 0; round < 3; ++round)
+    {
+        for (size_t i = 1; i <= MAX_SIZE; ++i)
+        {
+            node.a = i;
+            node.c = i + round;
+            ASSERT_TRUE(ring_buf->push(node));
+        }
+        ASSERT_TRUE(ring_buf->full());
+        EXPECT_EQ(ring_buf->size(), MAX_SIZE);
+        ASSERT_FALSE(ring_buf->push(node));
+
+        for (size_t i = 1; i <= MAX_SIZE / 2; ++i)
+        {
+            ASSERT_TRUE(ring_buf->pop(node));
+            EXPECT_EQ(node.a, i);
+            EXPECT_EQ(node.c, i + round);
+        }
+        EXPECT_EQ(ring_buf->size(), MAX_SIZE - MAX_SIZE / 2);
+
+        for (size_t i = MAX_SIZE / 2 + 1; i <= MAX_SIZE; ++i)
+        {
+            ASSERT_TRUE(ring_buf->pop(node));
+            EXPECT_EQ(node.a, i);
+        }
+        ASSERT_TRUE(ring_buf->empty());
+        ASSERT_FALSE(ring_buf->pop(node));
+    }
+    delete ring_buf;
+}
+
+// 测试多生产者多消费者的定长队列特化版本，多个线程同时读写
+TEST(RingBufferTest, mpmc_fixed_ring_buffer_0)
+{
+    static const size_t MAX_SIZE = 100;
+    static const size_t THREAD_NUM = 4;
+    static const size_t NUM_PER_THREAD = 20000;
+
+    size_t mem_size = MPMCFixedRingBuf<TestNode>::need_mem_size(MAX_SIZE);
+    auto p = new uint8_t[mem_size];
+    MPMCFixedRingBuf<TestNode> ring_buf;
+    ASSERT_TRUE(ring_buf.init(p, mem_size));
+    EXPECT_EQ(ring_buf.capacity(), MAX_SIZE);
+
+    MPMCFixedRingBuf<TestNode> reinit_ring_buf;
+    ASSERT_TRUE(reinit_ring_buf.init(p, mem_size, true));
+
+    vector<std::thread> threads;
+    for (size_t t = 0; t < THREAD_NUM; ++t)
+    {
+        threads.emplace_back([&ring_buf, t]() {
+            for (size_t i = 0; i < NUM_PER_THREAD;)
+            {
+                TestNode node;
+                node.a = t;
+                node.b = i;
+                node.c = t * NUM_PER_THREAD + i;
+                if (ring_buf.push(node))
+                    ++i;
+                else
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    // 每个消费者记录自己拿到的数据，最后合起来校验
+    vector<vector<size_t>> pop_values(THREAD_NUM);
+    for (size_t t = 0; t < THREAD_NUM; ++t)
+    {
+        threads.emplace_back([&reinit_ring_buf, &pop_values, t]() {
+            vector<size_t> last_b(THREAD_NUM, 0);
+            while (pop_values[t].size() < NUM_PER_THREAD)
+            {
+                TestNode node;
+                if (!reinit_ring_buf.pop(node))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // 同一个生产者的数据，同一个消费者看到的顺序是递增的
+                EXPECT_TRUE(node.b >= last_b[node.a]);
+                last_b[node.a] = node.b;
+                pop_values[t].push_back(node.c);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    vector<size_t> all_values;
+    for (auto& values : pop_values)
+        all_values.insert(all_values.end(), values.begin(), values.end());
+    std::sort(all_values.begin(), all_values.end());
+    ASSERT_EQ(all_values.size(), THREAD_NUM * NUM_PER_THREAD);
+    for (size_t i = 0; i < all_values.size(); ++i)
+        ASSERT_EQ(all_values[i], i);
+
+    ASSERT_TRUE(ring_buf.empty());
+    delete[] p;
+}
+
+// 测试定长队列的批量读写
+TEST(RingBufferTest, fixed_ring_buffer_bulk)
+{
+    static const size_t MAX_SIZE = 1000;
+    FixedRingBuf<TestNode> ring_buf;
+    size_t mem_size = FixedRingBuf<TestNode>::need_mem_size(MAX_SIZE);
+    auto p = new uint8_t[mem_size];
+    ASSERT_TRUE(ring_buf.init(p, mem_size));
+
+    struct iovec spans[2];
+    EXPECT_EQ(ring_buf.readable_spans(spans), 0ul);
+    EXPECT_EQ(ring_buf.writable_spans(spans), 1ul);
+    EXPECT_EQ(spans[0].iov_len, sizeof(TestNode) * MAX_SIZE);
+
+    vector<TestNode> values(MAX_SIZE * 2);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i].a = i % MAX_SIZE;
+
+    size_t push_index = 0;
+    size_t pop_index = 0;
+    vector<TestNode> pop_values(MAX_SIZE);
+    for (size_t round = 0; round < 20; ++round)
+    {
+        size_t push_num = 300 + round * 17;
+        size_t free_num = ring_buf.capacity() - ring_buf.size();
+        size_t num = ring_buf.push_bulk(values.data() + push_index % MAX_SIZE, push_num);
+        EXPECT_EQ(num, std::min(push_num, free_num));
+        push_index += num;
+        EXPECT_EQ(ring_buf.size(), push_index - pop_index);
+
+        // 可读的段和front是同一块内存
+        size_t span_num = ring_buf.readable_spans(spans);
+        ASSERT_TRUE(span_num >= 1 && span_num <= 2);
+        EXPECT_EQ(spans[0].iov_base, &ring_buf.front(0));
+        size_t total_len = 0;
+        for (size_t i = 0; i < span_num; ++i)
+            total_len += spans[i].iov_len;
+        EXPECT_EQ(total_len, ring_buf.size() * sizeof(TestNode));
+
+        size_t pop_num = 250 + round * 13;
+        num = ring_buf.pop_bulk(pop_values.data(), pop_num);
+        EXPECT_EQ(num, std::min(pop_num, push_index - pop_index));
+        for (size_t i = 0; i < num; ++i)
+            EXPECT_EQ(pop_values[i].a, (pop_index + i) % MAX_SIZE);
+        pop_index += num;
+    }
+
+    // 直接往可写的段里面写
+    ring_buf.clear();
+    ASSERT_TRUE(ring_buf.push(values[0]));
+    ring_buf.pop();
+    size_t span_num = ring_buf.writable_spans(spans);
+    ASSERT_EQ(span_num, 2ul);
+    size_t index = 0;
+    for (size_t i = 0; i < span_num; ++i)
+    {
+        auto nodes = reinterpret_cast<TestNode*>(spans[i].iov_base);
+        for (size_t j = 0; j < spans[i].iov_len / sizeof(TestNode); ++j)
+            nodes[j] = values[index++];
+    }
+    ASSERT_FALSE(ring_buf.commit(MAX_SIZE + 1));
+    ASSERT_TRUE(ring_buf.commit(MAX_SIZE));
+    ASSERT_TRUE(ring_buf.full());
+    for (size_t i = 0; i < MAX_SIZE; ++i)
+        EXPECT_EQ(ring_buf.front(i).a, i);
+
+    EXPECT_EQ(ring_buf.pop_n(10), 10ul);
+    EXPECT_EQ(ring_buf.front(0).a, 10u);
+    EXPECT_EQ(ring_buf.pop_n(MAX_SIZE), MAX_SIZE - 10);
+    ASSERT_TRUE(ring_buf.empty());
+    delete[] p;
+}
+
+TEST(RingBufferTest, ring_buffer_pow_of_two)
+{
+    static const size_t MAX_SIZE = 1000;
+    static const size_t POW_SIZE = 512;
+    static_assert(IsPowOfTwo<POW_SIZE>::value, "");
+    EXPECT_EQ(floor_pow_of_two(MAX_SIZE), POW_SIZE);
+    EXPECT_EQ(floor_pow_of_two(POW_SIZE), POW_SIZE);
+    EXPECT_EQ(floor_pow_of_two(1), 1ul);
+    EXPECT_EQ(floor_pow_of_two(0), 0ul);
+
+    // 定长队列，容量向下取整到2的幂，多绕几圈
+    {
+        size_t mem_size = FixedRingBuf<TestNode>::need_mem_size(MAX_SIZE);
+        // 头部还是原来的4个字段，老的共享内存还能挂上来
+        EXPECT_EQ(mem_size, sizeof(size_t) * 4 + sizeof(TestNode) * MAX_SIZE);
+        auto p = new uint8_t[mem_size];
+        FixedRingBuf<TestNode> ring_buf;
+        ASSERT_TRUE(ring_buf.init(p, mem_size, false, true));
+        EXPECT_EQ(ring_buf.capacity(), POW_SIZE);
+
+        TestNode node;
+        size_t pop_index = 0;
+        for (size_t i = 0; i < POW_SIZE * 5; ++i)
+        {
+            node.a = i;
+            if (ring_buf.full())
+            {
+                EXPECT_EQ(ring_buf.front(0).a, pop_index);
+                EXPECT_EQ(ring_buf.back(0).a, i - 1);
+                ring_buf.pop();
+                ++pop_index;
+            }
+            ASSERT_TRUE(ring_buf.push(node));
+        }
+        EXPECT_EQ(ring_buf.size(), POW_SIZE);
+
+        // 挂上去的时候容量从头里面读出来，mask每个进程自己算
+        FixedRingBuf<TestNode> reinit_ring_buf;
+        ASSERT_TRUE(reinit_ring_buf.init(p, mem_size, true));
+        EXPECT_EQ(reinit_ring_buf.capacity(), POW_SIZE);
+        EXPECT_EQ(reinit_ring_buf.front(0).a, pop_index);
+        delete[] p;
+    }
+
+    // 变长队列
+    {
+        size_t mem_size = MAX_SIZE * sizeof(TestNode);
+        auto p = new uint8_t[mem_size];
+        UnfixedRingBuf<> ring_buf;
+        ASSERT_TRUE(ring_buf.init(p, mem_size, false, true));
+        EXPECT_TRUE(is_pow_of_two(ring_buf.capacity()));
+
+        TestNode node;
+        size_t pop_index = 0;
+        for (size_t i = 0; i < MAX_SIZE * 5; ++i)
+        {
+            node.a = i;
+            while (!ring_buf.push(reinterpret_cast<const uint8_t *>(&node), sizeof(TestNode) - i % 7))
+            {
+                size_t len = 0;
+                auto front = reinterpret_cast<const TestNode *>(ring_buf.front(len));
+                ASSERT_TRUE(front != nullptr);
+                EXPECT_EQ(front->a, pop_index);
+                EXPECT_EQ(len, sizeof(TestNode) - pop_index % 7);
+                ring_buf.pop();
+                ++pop_index;
+            }
+        }
+
+        UnfixedRingBuf<> reinit_ring_buf;
+        ASSERT_TRUE(reinit_ring_buf.init(p, mem_size, true));
+        EXPECT_EQ(reinit_ring_buf.capacity(), ring_buf.capacity());
+        delete[] p;
+    }
+
+    // spsc变长队列
+    {
+        size_t mem_size = SPSCUnfixedRingBuf<>::need_mem_size(MAX_SIZE * sizeof(TestNode));
+        auto p = new uint8_t[mem_size];
+        SPSCUnfixedRingBuf<> ring_buf;
+        ASSERT_TRUE(ring_buf.init(p, mem_size, false, true));
+        EXPECT_TRUE(is_pow_of_two(ring_buf.capacity()));
+
+        TestNode node;
+        size_t pop_index = 0;
+        for (size_t i = 0; i < MAX_SIZE * 5; ++i)
+        {
+            node.a = i;
+            while (!ring_buf.push(reinterpret_cast<const uint8_t *>(&node), sizeof(TestNode) - i % 7))
+            {
+                size_t len = 0;
+                auto front = reinterpret_cast<const TestNode *>(ring_buf.front(len));
+                ASSERT_TRUE(front != nullptr);
+                EXPECT_EQ(front->a, pop_index);
+                EXPECT_EQ(len, sizeof(TestNode) - pop_index % 7);
+                ring_buf.pop();
+                ++pop_index;
+            }
+        }
+
+        SPSCUnfixedRingBuf<> reinit_ring_buf;
+        ASSERT_TRUE(reinit_ring_buf.init(p, mem_size, true));
+        EXPECT_EQ(reinit_ring_buf.capacity(), ring_buf.capacity());
+        delete[] p;
+    }
+
+    // mpmc定长队列
+    {
+        size_t mem_size = MPMCFixedRingBuf<TestNode>::need_mem_size(MAX_SIZE);
+        auto p = new uint8_t[mem_size];
+        MPMCFixedRingBuf<TestNode> ring_buf;
+        ASSERT_TRUE(ring_buf.init(p, mem_size, false, true));
+        EXPECT_EQ(ring_buf.capacity(), POW_SIZE);
+
+        TestNode node;
+        size_t pop_index = 0;
+        for (size_t i = 0; i < POW_SIZE * 5; ++i)
+        {
+            node.a = i;
+            if (ring_buf.full())
+            {
+                ASSERT_TRUE(ring_buf.pop(node));
+                EXPECT_EQ(node.a, pop_index++);
+                node.a = i;
+            }
+            ASSERT_TRUE(ring_buf.push(node));
+        }
+        EXPECT_FALSE(ring_buf.push(node));
+
+        MPMCFixedRingBuf<TestNode> reinit_ring_buf;
+        ASSERT_TRUE(reinit_ring_buf.init(p, mem_size, true));
+        EXPECT_EQ(reinit_ring_buf.capacity(), POW_SIZE);
+        delete[] p;
+    }
+}
+
+TEST(RingBufferTest, mirror_ring_buffer)
+{
+    MirrorRingBuf ring_buf;
+    ASSERT_TRUE(ring_buf.init(1000));
+    // 向上取整到页大小
+    size_t max_size = ring_buf.capacity();
+    ASSERT_TRUE(max_size >= 1000 && max_size % 4096 == 0);
+    ASSERT_TRUE(ring_buf.empty());
+    ASSERT_FALSE(ring_buf.full());
+
+    // 另外一个进程通过fd挂上来看到的是同一个队列
+    MirrorRingBuf reader;
+    ASSERT_TRUE(reader.attach(ring_buf.fd()));
+    EXPECT_EQ(reader.capacity(), max_size);
+
+    vector<uint8_t> data(max_size);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 7 + 3);
+
+    // 各种长度绕很多圈，每个元素都是一段连续的内存，不会有填充
+    size_t push_index = 0;
+    size_t pop_index = 0;
+    size_t used_size = 0;
+    size_t header_size = 0;
+    for (size_t round = 0; round < 2000; ++round)
+    {
+        size_t len = 1 + (push_index * 131) % 300;
+        if (!ring_buf.push(data.data() + push_index % 100, len))
+        {
+            ASSERT_FALSE(reader.empty());
+            size_t front_len = 0;
+            const uint8_t *front = reader.front(front_len);
+            ASSERT_TRUE(front != nullptr);
+            ASSERT_EQ(front_len, 1 + (pop_index * 131) % 300);
+            EXPECT_EQ(memcmp(front, data.data() + pop_index % 100, front_len), 0);
+            reader.pop();
+            ++pop_index;
+            continue;
+        }
+        if (header_size == 0)
+            header_size = ring_buf.size() - len;
+        used_size += len + header_size;
+        ++push_index;
+        // 没有填充，占用的空间刚好是数据和头的大小
+        size_t expect_size = 0;
+        for (size_t i = pop_index; i < push_index; ++i)
+            expect_size += 1 + (i * 131) % 300 + header_size;
+        ASSERT_EQ(ring_buf.size(), expect_size);
+        ASSERT_EQ(ring_buf.get_num(), push_index - pop_index);
+    }
+    EXPECT_GT(used_size, max_size * 10);
+
+    // 按下标取的元素也是连续的
+    for (size_t i = 0; i < ring_buf.get_num(); ++i)
+    {
+        size_t len = 0;
+        const uint8_t *item = ring_buf.front(len, i);
+        ASSERT_TRUE(item != nullptr);
+        EXPECT_EQ(len, 1 + ((pop_index + i) * 131) % 300);
+        EXPECT_EQ(memcmp(item, data.data() + (pop_index + i) % 100, len), 0);
+    }
+    size_t len = 0;
+    EXPECT_TRUE(ring_buf.front(len, ring_buf.get_num()) == nullptr);
+
+    // 刚好填满整个容量
+    ring_buf.clear();
+    ASSERT_TRUE(ring_buf.push(data.data(), 100));
+    ring_buf.pop();
+    uint8_t *item = ring_buf.reserve(max_size - header_size);
+    ASSERT_TRUE(item != nullptr);
+    memcpy(item, data.data(), max_size - header_size);
+    ASSERT_TRUE(ring_buf.commit(max_size - header_size));
+    ASSERT_TRUE(ring_buf.full());
+    EXPECT_EQ(ring_buf.size(), max_size);
+    ASSERT_FALSE(ring_buf.push(data.data(), 0));
+    ASSERT_TRUE(ring_buf.push(data.data(), 1, true));
+    EXPECT_EQ(ring_buf.get_num(), 1ul);
+
+    ring_buf.clear();
+    for (size_t i = 0; i < 10; ++i)
+        ASSERT_TRUE(ring_buf.push(data.data(), i));
+    EXPECT_EQ(reader.pop_n(3), 3ul);
+    const uint8_t *front = reader.front(len);
+    ASSERT_TRUE(front != nullptr);
+    EXPECT_EQ(len, 3ul);
+    EXPECT_EQ(reader.pop_n(100), 7ul);
+    EXPECT_TRUE(ring_buf.empty());
+}
+
+TEST(RingBufferTest, waitable_ring_buffer)
+{
+    static const size_t MAX_SIZE = 1024;
+    static const size_t TOTAL_NUM = 20000;
+
+    // 没有数据的时候等待超时
+    {
+        using RingBuf = WaitableRingBuf<FixedRingBuf<TestNode>>;
+        size_t mem_size = RingBuf::need_mem_size(MAX_SIZE);
+        auto p = new uint8_t[mem_size];
+        RingBuf ring_buf;
+        ASSERT_TRUE(ring_buf.init(p, mem_size));
+        EXPECT_EQ(ring_buf.capacity(), MAX_SIZE);
+        EXPECT_FALSE(ring_buf.wait_nonempty(0));
+
+        auto begin = std::chrono::steady_clock::now();
+        EXPECT_FALSE(ring_buf.wait_nonempty(20000));
+        EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(20));
+
+        TestNode node;
+        node.a = 1;
+        ASSERT_TRUE(ring_buf.push(node));
+        EXPECT_TRUE(ring_buf.wait_nonempty(0));
+
+        RingBuf reinit_ring_buf;
+        ASSERT_TRUE(reinit_ring_buf.init(p, mem_size, true));
+        EXPECT_TRUE(reinit_ring_buf.wait_nonempty());
+        EXPECT_EQ(reinit_ring_buf.front().a, 1u);
+        delete[] p;
+    }
+
+    // 一个线程写一个线程阻塞读
+    using RingBuf = WaitableRingBuf<SPSCUnfixedRingBuf<>>;
+    size_t mem_size = RingBuf::need_mem_size(MAX_SIZE);
+    auto p = new uint8_t[mem_size];
+    RingBuf producer_buf;
+    ASSERT_TRUE(producer_buf.init(p, mem_size));
+    RingBuf consumer_buf;
+    ASSERT_TRUE(consumer_buf.init(p, mem_size, true));
+
+    std::thread producer([&producer_buf]() {
+        for (uint32_t i = 0; i < TOTAL_NUM;)
+        {
+            if (producer_buf.push(reinterpret_cast<const uint8_t *>(&i), sizeof(i)))
+            {
+                // 时不时停一下，让消费者真正睡下去
+                if (i % 1000 == 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                ++i;
+            }
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    size_t error_num = 0;
+    for (uint32_t i = 0; i < TOTAL_NUM; ++i)
+    {
+        ASSERT_TRUE(consumer_buf.wait_nonempty(5000000));
+        size_t len = 0;
+        auto data = consumer_buf.front(len);
+        ASSERT_TRUE(data != nullptr);
+        uint32_t value = 0;
+        memcpy(&value, data, sizeof(value));
+        if (value != i || len != sizeof(value))
+            ++error_num;
+        consumer_buf.pop();
+    }
+    producer.join();
+
+    EXPECT_EQ(error_num, 0ul);
+    EXPECT_TRUE(consumer_buf.empty());
+    delete[] p;
+}
+
 #endif
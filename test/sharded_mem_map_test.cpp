@@ -0,0 +1,173 @@
+/*
+ * * file name: sharded_mem_map_test.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SHARDED_MEM_MAP_TEST_H_
+#define _SHARDED_MEM_MAP_TEST_H_
+
+#include "sharded_mem_map.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "base_test_struct.h"
+#include "gtest/gtest.h"
+
+using namespace pepper;
+
+TEST(ShardedMemMapTest, sharded_mem_map_normal)
+{
+    static const size_t SHARD_NUM = 8;
+    static const size_t MAX_NUM_PER_SHARD = 256;
+    static const size_t BUCKETS_PER_SHARD = 251;
+    using MapType = ShardedMemMap<uint32_t, TestNode>;
+
+    size_t mem_size = MapType::need_mem_size(SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD);
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    MapType sharded_map;
+    ASSERT_FALSE(sharded_map.init(raw_mem.get(), mem_size - 1, SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD));
+    ASSERT_TRUE(sharded_map.init(raw_mem.get(), mem_size, SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD));
+    EXPECT_EQ(sharded_map.shard_num(), SHARD_NUM);
+    EXPECT_EQ(sharded_map.capacity(), SHARD_NUM * MAX_NUM_PER_SHARD);
+    EXPECT_EQ(sharded_map.size(), 0ul);
+
+    // 分片之间要比较均匀
+    static const uint32_t NUM = 1000;
+    std::vector<size_t> shard_count(SHARD_NUM, 0);
+    for (uint32_t i = 1; i <= NUM; ++i)
+    {
+        TestNode node;
+        node.a = i;
+        node.b = i * 3;
+        ASSERT_TRUE(sharded_map.insert(i, node));
+        ASSERT_FALSE(sharded_map.insert(i, node));
+        ++shard_count[sharded_map.shard_index(i)];
+    }
+    EXPECT_EQ(sharded_map.size(), NUM);
+    for (size_t count : shard_count)
+    {
+        EXPECT_GT(count, NUM / SHARD_NUM / 2);
+        EXPECT_LT(count, NUM / SHARD_NUM * 2);
+    }
+
+    TestNode node;
+    for (uint32_t i = 1; i <= NUM; ++i)
+    {
+        ASSERT_TRUE(sharded_map.find(i, node));
+        EXPECT_EQ(node.b, i * 3);
+    }
+    EXPECT_FALSE(sharded_map.find(NUM + 1, node));
+    EXPECT_FALSE(sharded_map.exist(NUM + 1));
+
+    // 覆盖和原地修改
+    node.b = 7;
+    ASSERT_TRUE(sharded_map.assign(1, node));
+    ASSERT_TRUE(sharded_map.assign(NUM + 1, node));
+    ASSERT_TRUE(sharded_map.update(2, [](TestNode& value_) { value_.b = 9; }));
+    ASSERT_FALSE(sharded_map.update(NUM + 2, [](TestNode& value_) { value_.b = 9; }));
+    ASSERT_TRUE(sharded_map.find(1, node));
+    EXPECT_EQ(node.b, 7u);
+    ASSERT_TRUE(sharded_map.find(2, node));
+    EXPECT_EQ(node.b, 9u);
+    EXPECT_EQ(sharded_map.size(), NUM + 1);
+
+    for (uint32_t i = 1; i <= NUM; i += 2)
+        ASSERT_TRUE(sharded_map.erase(i));
+    ASSERT_FALSE(sharded_map.erase(1));
+    EXPECT_EQ(sharded_map.size(), NUM / 2 + 1);
+
+    // 另外一个对象挂到同一块内存上，模拟另外一个进程
+    MapType attach_map;
+    ASSERT_FALSE(attach_map.init(raw_mem.get(), mem_size, SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD - 1, true));
+    ASSERT_TRUE(attach_map.init(raw_mem.get(), mem_size, SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD, true));
+    EXPECT_EQ(attach_map.size(), NUM / 2 + 1);
+    for (uint32_t i = 1; i <= NUM; ++i)
+        EXPECT_EQ(attach_map.exist(i), i % 2 == 0);
+
+    attach_map.clear();
+    EXPECT_EQ(sharded_map.size(), 0ul);
+}
+
+// 多个线程同时读写，读到的值一定是某一次完整写入的值
+TEST(ShardedMemMapTest, sharded_mem_map_concurrent)
+{
+    static const size_t SHARD_NUM = 16;
+    static const size_t MAX_NUM_PER_SHARD = 128;
+    static const size_t BUCKETS_PER_SHARD = 127;
+    static const uint32_t KEY_NUM = 512;
+    static const size_t WRITE_NUM = 20000;
+    using MapType = ShardedMemMap<uint32_t, TestNode>;
+
+    size_t mem_size = MapType::need_mem_size(SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD);
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    MapType writer_map;
+    ASSERT_TRUE(writer_map.init(raw_mem.get(), mem_size, SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD));
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> error_num{0};
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < 2; ++t)
+    {
+        readers.emplace_back([&]() {
+            MapType reader_map;
+            if (!reader_map.init(raw_mem.get(), mem_size, SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD, true))
+            {
+                ++error_num;
+                return;
+            }
+
+            TestNode node;
+            uint32_t key = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                key = (key + 1) % KEY_NUM;
+                if (reader_map.find(key, node) && (node.a != key || node.c != node.b * 2ul))
+                    ++error_num;
+                if (key == 0)
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < 2; ++t)
+    {
+        writers.emplace_back([&, t]() {
+            MapType map;
+            if (!map.init(raw_mem.get(), mem_size, SHARD_NUM, MAX_NUM_PER_SHARD, BUCKETS_PER_SHARD, true))
+            {
+                ++error_num;
+                return;
+            }
+
+            for (size_t i = 0; i < WRITE_NUM; ++i)
+            {
+                uint32_t key = (i * 7 + t) % KEY_NUM;
+                TestNode node;
+                node.a = key;
+                node.b = i;
+                node.c = node.b * 2ul;
+                if (i % 3 == 0)
+                    map.erase(key);
+                else
+                    map.assign(key, node);
+                if (i % 256 == 0)
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    for (auto& writer : writers)
+        writer.join();
+    stop = true;
+    for (auto& reader : readers)
+        reader.join();
+
+    EXPECT_EQ(error_num.load(), 0ul);
+    EXPECT_LE(writer_map.size(), KEY_NUM);
+}
+
+#endif
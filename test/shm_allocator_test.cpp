@@ -0,0 +1,136 @@
+/*
+ * * file name: shm_allocator_test.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SHM_ALLOCATOR_TEST_H_
+#define _SHM_ALLOCATOR_TEST_H_
+
+#include "shm_allocator.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace pepper;
+
+TEST(ShmAllocatorTest, offset_ptr_normal)
+{
+    int values[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    OffsetPtr<int> p;
+    EXPECT_FALSE(p);
+    EXPECT_TRUE(p == nullptr);
+    p = values;
+    EXPECT_EQ(*p, 0);
+    EXPECT_EQ(p[3], 3);
+    OffsetPtr<int> q = p + 5;
+    EXPECT_EQ(*q, 5);
+    EXPECT_EQ(q - p, 5);
+    EXPECT_TRUE(p < q);
+    EXPECT_EQ(*(--q), 4);
+    EXPECT_EQ(*(q++), 4);
+    EXPECT_EQ(*q, 5);
+
+    // 拷贝到别的地方还是指向同一个地址
+    std::unique_ptr<OffsetPtr<int>> copy(new OffsetPtr<int>(q));
+    EXPECT_EQ(copy->get(), &values[5]);
+    OffsetPtr<const int> const_p = *copy;
+    EXPECT_EQ(const_p.get(), &values[5]);
+    OffsetPtr<void> void_p = q;
+    EXPECT_EQ(static_cast<OffsetPtr<int>>(void_p).get(), &values[5]);
+
+    // 指针和目标一起搬走，指向搬走之后的目标
+    struct Block
+    {
+        int value = 42;
+        OffsetPtr<int> ptr;
+    };
+    Block block;
+    block.ptr = &block.value;
+    Block moved;
+    memcpy(static_cast<void*>(&moved), &block, sizeof(Block));
+    moved.value = 7;
+    EXPECT_EQ(moved.ptr.get(), &moved.value);
+    EXPECT_EQ(*moved.ptr, 7);
+}
+
+TEST(ShmAllocatorTest, shm_allocator_relocate)
+{
+    using PoolType = UnFixedMemPool<>;
+    using IntVector = std::vector<int, ShmAllocator<int>>;
+    using ShmString = std::basic_string<char, std::char_traits<char>, ShmAllocator<char>>;
+    using StringVector = std::vector<ShmString, ShmAllocator<ShmString>>;
+    struct Root
+    {
+        explicit Root(void* pool_mem_)
+            : numbers(ShmAllocator<int>(pool_mem_)), names(ShmAllocator<ShmString>(pool_mem_))
+        {
+        }
+        IntVector numbers;
+        StringVector names;
+    };
+
+    static const size_t SLAB_NUM = 64;
+    static const size_t SLAB_SIZE = 16384;
+    size_t mem_size = PoolType::calc_need_size(SLAB_NUM, SLAB_SIZE);
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    PoolType pool;
+    ASSERT_TRUE(pool.init(raw_mem.get(), mem_size, SLAB_NUM, SLAB_SIZE));
+
+    // 容器对象自己也放在池子里面
+    size_t root_offset = pool.alloc(sizeof(Root));
+    ASSERT_NE(root_offset, 0u);
+    Root* root = new (pool.offset_2_ptr(root_offset)) Root(raw_mem.get());
+    for (int i = 0; i < 500; ++i)
+        root->numbers.push_back(i);
+    ShmAllocator<char> char_alloc(raw_mem.get());
+    for (int i = 0; i < 20; ++i)
+    {
+        root->names.emplace_back(char_alloc);
+        // 短的在string对象里面，长的在池子里面
+        root->names.back().assign(i % 2 == 0 ? 3 : 100, static_cast<char>('a' + i));
+    }
+
+    // 整块内存拷到别的地址，相当于重启之后映射到了不同的地址
+    std::unique_ptr<uint8_t[]> moved_mem(new uint8_t[mem_size]);
+    memcpy(moved_mem.get(), raw_mem.get(), mem_size);
+    memset(raw_mem.get(), 0, mem_size);
+    PoolType moved_pool;
+    ASSERT_TRUE(moved_pool.init(moved_mem.get(), mem_size, SLAB_NUM, SLAB_SIZE, true));
+    Root* moved_root = static_cast<Root*>(moved_pool.offset_2_ptr(root_offset));
+    EXPECT_EQ(moved_root->numbers.get_allocator().pool_mem(), moved_mem.get());
+    ASSERT_EQ(moved_root->numbers.size(), 500u);
+    for (int i = 0; i < 500; ++i)
+        EXPECT_EQ(moved_root->numbers[i], i);
+    ASSERT_EQ(moved_root->names.size(), 20u);
+    for (int i = 0; i < 20; ++i)
+    {
+        const ShmString& name = moved_root->names[i];
+        EXPECT_EQ(std::string(name.data(), name.size()), std::string(i % 2 == 0 ? 3 : 100, static_cast<char>('a' + i)));
+    }
+
+    // 搬过去之后还能接着改，内存从新的池子里面申请，vector大了之后是整slab分的
+    for (int i = 500; i < 2000; ++i)
+        moved_root->numbers.push_back(i);
+    moved_root->names.erase(moved_root->names.begin(), moved_root->names.begin() + 10);
+    EXPECT_EQ(moved_root->numbers.back(), 1999);
+    EXPECT_EQ(moved_root->names.front()[0], 'a' + 10);
+    EXPECT_EQ(moved_pool.large_stat().used_num, 1u);
+
+    // 全部析构之后只剩下root自己
+    moved_root->~Root();
+    EXPECT_TRUE(moved_pool.free(root_offset));
+    for (size_t i = 0; i < PoolType::CLASS_NUM; ++i)
+        EXPECT_EQ(moved_pool.stat(i).used_num, 0u);
+    EXPECT_EQ(moved_pool.large_stat().used_num, 0u);
+    EXPECT_EQ(moved_pool.free_slab_num(), SLAB_NUM);
+
+    // 池子放不下抛异常
+    ShmAllocator<int> int_alloc(moved_mem.get());
+    EXPECT_THROW(int_alloc.allocate(SLAB_NUM * SLAB_SIZE), std::bad_alloc);
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * * file name: shm_directory_test.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SHM_DIRECTORY_TEST_H_
+#define _SHM_DIRECTORY_TEST_H_
+
+#include "utils/shm_directory.h"
+#include <memory>
+#include <set>
+#include <string>
+#include "fixed_mem_pool.h"
+#include "unfixed_mem_pool.h"
+#include "utils/shm_segment.h"
+#include "gtest/gtest.h"
+
+using namespace pepper;
+
+TEST(ShmDirectoryTest, shm_directory_normal)
+{
+    using FixedPool = FixedMemPool<uint64_t>;
+    using UnFixedPool = UnFixedMemPool<>;
+    static const uint32_t FIXED_TAG = 1;
+    static const uint32_t UNFIXED_TAG = 2;
+    static const size_t MAX_ENTRY = 10;
+    static const size_t FIXED_NUM = 100;
+    size_t fixed_size = FixedPool::calc_need_size(FIXED_NUM);
+    size_t unfixed_size = UnFixedPool::calc_need_size(4, 4096);
+    size_t mem_size = ShmDirectory::calc_head_size(MAX_ENTRY) + ShmDirectory::align_size(fixed_size) * MAX_ENTRY +
+                      ShmDirectory::align_size(unfixed_size);
+
+    ShmSegment segment;
+    ASSERT_TRUE(segment.create_memfd("pepper_dir_test", mem_size));
+    ShmDirectory dir;
+    ASSERT_FALSE(dir.init(segment.addr(), mem_size, MAX_ENTRY, true));
+    ASSERT_TRUE(dir.init(segment.addr(), segment.size(), MAX_ENTRY));
+
+    // 一个进程把所有的容器建好
+    for (size_t i = 0; i < MAX_ENTRY - 1; ++i)
+    {
+        std::string name = "fixed_" + std::to_string(i);
+        bool created = false;
+        void* mem = dir.find_or_create(name.c_str(), FIXED_TAG, 1, fixed_size, created);
+        ASSERT_NE(mem, nullptr);
+        EXPECT_TRUE(created);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(mem) % CACHE_LINE_SIZE, 0u);
+        FixedPool pool;
+        ASSERT_TRUE(pool.init(mem, fixed_size, FIXED_NUM));
+        *pool.alloc() = i;
+    }
+    void* unfixed_mem = dir.create("unfixed", UNFIXED_TAG, 1, unfixed_size);
+    ASSERT_NE(unfixed_mem, nullptr);
+    UnFixedPool unfixed_pool;
+    ASSERT_TRUE(unfixed_pool.init(unfixed_mem, unfixed_size, 4, 4096));
+    EXPECT_EQ(dir.entry_num(), MAX_ENTRY);
+
+    // 满了、重名、名字太长都建不了
+    EXPECT_EQ(dir.create("more", FIXED_TAG, 1, 8), nullptr);
+    EXPECT_EQ(dir.create("unfixed", UNFIXED_TAG, 1, 8), nullptr);
+    EXPECT_EQ(dir.create(std::string(ShmDirEntry::MAX_NAME_LEN + 1, 'a').c_str(), FIXED_TAG, 1, 8), nullptr);
+
+    // 别的进程挂上来一次，按名字找到每个容器
+    ShmSegment attached;
+    ASSERT_TRUE(attached.attach_memfd(segment.fd()));
+    ShmDirectory attached_dir;
+    ASSERT_TRUE(attached_dir.init(attached.addr(), attached.size(), MAX_ENTRY, true));
+    EXPECT_EQ(attached_dir.entry_num(), MAX_ENTRY);
+    for (size_t i = 0; i < MAX_ENTRY - 1; ++i)
+    {
+        std::string name = "fixed_" + std::to_string(i);
+        bool created = true;
+        void* mem = attached_dir.find_or_create(name.c_str(), FIXED_TAG, 1, fixed_size, created);
+        ASSERT_NE(mem, nullptr);
+        EXPECT_FALSE(created);
+        FixedPool pool;
+        ASSERT_TRUE(pool.init(mem, fixed_size, FIXED_NUM, true));
+        EXPECT_EQ(*pool.int_2_ptr(1), i);
+    }
+    EXPECT_NE(attached_dir.find("unfixed", UNFIXED_TAG, 1, unfixed_size), nullptr);
+
+    // 类型、版本、大小对不上都不给
+    EXPECT_EQ(attached_dir.find("unfixed", FIXED_TAG, 1, unfixed_size), nullptr);
+    EXPECT_EQ(attached_dir.find("unfixed", UNFIXED_TAG, 2, unfixed_size), nullptr);
+    EXPECT_EQ(attached_dir.find("unfixed", UNFIXED_TAG, 1, unfixed_size + 1), nullptr);
+    EXPECT_EQ(attached_dir.find("nothing", UNFIXED_TAG, 1, unfixed_size), nullptr);
+    const ShmDirEntry* entry = attached_dir.entry("unfixed");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->type_tag, UNFIXED_TAG);
+    EXPECT_EQ(entry->size, unfixed_size);
+
+    // 各个容器的内存不能重叠
+    std::set<std::pair<size_t, size_t>> ranges;
+    attached_dir.for_each(
+        [&](const ShmDirEntry& entry_) { ranges.insert(std::make_pair(entry_.offset, entry_.size)); });
+    ASSERT_EQ(ranges.size(), MAX_ENTRY);
+    size_t last_end = ShmDirectory::calc_head_size(MAX_ENTRY);
+    for (auto& range : ranges)
+    {
+        EXPECT_GE(range.first, last_end);
+        last_end = range.first + range.second;
+    }
+    EXPECT_LE(last_end, attached.size());
+}
+
+TEST(ShmDirectoryTest, shm_directory_no_space)
+{
+    static const size_t MAX_ENTRY = 4;
+    size_t mem_size = ShmDirectory::calc_head_size(MAX_ENTRY) + 256;
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    ShmDirectory dir;
+    ASSERT_FALSE(dir.init(raw_mem.get(), ShmDirectory::calc_head_size(MAX_ENTRY) - 1, MAX_ENTRY));
+    ASSERT_TRUE(dir.init(raw_mem.get(), mem_size, MAX_ENTRY));
+    EXPECT_EQ(dir.free_size(), 256u);
+
+    // 每块按缓存行对齐
+    EXPECT_NE(dir.create("a", 0, 0, 1), nullptr);
+    EXPECT_EQ(dir.free_size(), 256u - CACHE_LINE_SIZE);
+    EXPECT_EQ(dir.create("b", 0, 0, 256), nullptr);
+    EXPECT_EQ(dir.create("c", 0, 0, 0), nullptr);
+    EXPECT_NE(dir.create("b", 0, 0, 192), nullptr);
+    EXPECT_EQ(dir.free_size(), 0u);
+    EXPECT_EQ(dir.entry_num(), 2u);
+    EXPECT_EQ(dir.entry("c"), nullptr);
+
+    // 重新init就清空了
+    ASSERT_TRUE(dir.init(raw_mem.get(), mem_size, MAX_ENTRY));
+    EXPECT_EQ(dir.entry_num(), 0u);
+    EXPECT_EQ(dir.entry("a"), nullptr);
+}
+
+#endif
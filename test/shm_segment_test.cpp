@@ -0,0 +1,109 @@
+/*
+ * * file name: shm_segment_test.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _SHM_SEGMENT_TEST_H_
+#define _SHM_SEGMENT_TEST_H_
+
+#include "utils/shm_segment.h"
+#include <unistd.h>
+#include <string>
+#include "fixed_mem_pool.h"
+#include "unfixed_mem_pool.h"
+#include "gtest/gtest.h"
+
+using namespace pepper;
+
+TEST(ShmSegmentTest, shm_segment_memfd)
+{
+    using FixedPool = FixedMemPool<uint64_t>;
+    using UnFixedPool = UnFixedMemPool<>;
+    static const size_t FIXED_NUM = 1000;
+    static const size_t SLAB_NUM = 16;
+    static const size_t SLAB_SIZE = 4096;
+    size_t fixed_size = FixedPool::calc_need_size(FIXED_NUM);
+    size_t unfixed_size = UnFixedPool::calc_need_size(SLAB_NUM, SLAB_SIZE);
+
+    ShmSegmentOption option;
+    option.touch_threads = 4;
+    ShmSegment segment;
+    ASSERT_TRUE(segment.create_memfd("pepper_test", fixed_size + unfixed_size + 1, option));
+    EXPECT_GE(segment.size(), fixed_size + unfixed_size + 1);
+    EXPECT_EQ(segment.size() % segment.page_size(), 0u);
+    EXPECT_GE(segment.fd(), 0);
+
+    // 按容器要的大小顺序切出来
+    void* fixed_mem = segment.carve(fixed_size);
+    void* unfixed_mem = segment.carve(unfixed_size);
+    ASSERT_NE(fixed_mem, nullptr);
+    ASSERT_NE(unfixed_mem, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(unfixed_mem) % CACHE_LINE_SIZE, 0u);
+    EXPECT_EQ(segment.carve(segment.size()), nullptr);
+    EXPECT_EQ(segment.carve(1, 3), nullptr);
+
+    FixedPool fixed_pool;
+    UnFixedPool unfixed_pool;
+    ASSERT_TRUE(fixed_pool.init(fixed_mem, fixed_size, FIXED_NUM));
+    ASSERT_TRUE(unfixed_pool.init(unfixed_mem, unfixed_size, SLAB_NUM, SLAB_SIZE));
+    uint64_t* value = fixed_pool.alloc();
+    ASSERT_NE(value, nullptr);
+    *value = 12345;
+    size_t offset = unfixed_pool.alloc(100);
+    ASSERT_NE(offset, 0u);
+    memset(unfixed_pool.offset_2_ptr(offset), 'x', 100);
+
+    // 别的进程拿到fd之后映射到别的地址，按同样的顺序切就能挂上去
+    ShmSegment attached;
+    option.page_type = ShmSegmentOption::NORMAL_PAGE;
+    ASSERT_TRUE(attached.attach_memfd(segment.fd(), option));
+    EXPECT_EQ(attached.size(), segment.size());
+    EXPECT_NE(attached.addr(), segment.addr());
+    FixedPool attached_fixed;
+    UnFixedPool attached_unfixed;
+    ASSERT_TRUE(attached_fixed.init(attached.carve(fixed_size), fixed_size, FIXED_NUM, true));
+    ASSERT_TRUE(attached_unfixed.init(attached.carve(unfixed_size), unfixed_size, SLAB_NUM, SLAB_SIZE, true));
+    EXPECT_EQ(*attached_fixed.int_2_ptr(fixed_pool.ptr_2_int(value)), 12345u);
+    EXPECT_EQ(static_cast<const char*>(attached_unfixed.offset_2_ptr(offset))[99], 'x');
+
+    attached.reset_carve();
+    EXPECT_EQ(attached.carved(), 0u);
+    attached.destroy();
+    EXPECT_EQ(attached.addr(), nullptr);
+    EXPECT_FALSE(attached.attach_memfd(-1));
+
+    // 不存在的NUMA节点绑不上
+    option.numa_node = 1 << 20;
+    EXPECT_FALSE(attached.create_memfd("pepper_test", 4096, option));
+}
+
+TEST(ShmSegmentTest, shm_segment_posix)
+{
+    std::string name = "/pepper_shm_segment_test_" + std::to_string(getpid());
+    ShmSegment::unlink_posix(name.c_str());
+
+    ShmSegmentOption huge_option;
+    huge_option.page_type = ShmSegmentOption::HUGE_PAGE_2M;
+    ShmSegment segment;
+    EXPECT_FALSE(segment.create_posix(name.c_str(), 4096, huge_option));
+    ASSERT_TRUE(segment.create_posix(name.c_str(), 10000));
+    EXPECT_FALSE(ShmSegment().create_posix(name.c_str(), 10000));
+    segment.addr()[segment.size() - 1] = 'z';
+
+    ShmSegmentOption option;
+    option.touch_threads = 2;
+    ShmSegment attached;
+    ASSERT_TRUE(attached.attach_posix(name.c_str(), option));
+    EXPECT_EQ(attached.size(), segment.size());
+    EXPECT_EQ(attached.addr()[attached.size() - 1], 'z');
+
+    // 名字删了之后已经映射的还能用，按名字挂不上了
+    EXPECT_TRUE(ShmSegment::unlink_posix(name.c_str()));
+    attached.addr()[0] = 'a';
+    EXPECT_EQ(segment.addr()[0], 'a');
+    EXPECT_FALSE(ShmSegment().attach_posix(name.c_str()));
+}
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * * file name: thread_cached_mem_pool_test.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _THREAD_CACHED_MEM_POOL_TEST_H_
+#define _THREAD_CACHED_MEM_POOL_TEST_H_
+
+#include "thread_cached_mem_pool.h"
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+#include "base_test_struct.h"
+#include "gtest/gtest.h"
+
+using namespace pepper;
+
+TEST(ThreadCachedMemPoolTest, thread_cached_mem_pool_normal)
+{
+    static const size_t MAX_NUM = 1000;
+    using PoolType = ThreadCachedMemPool<TestNode>;
+
+    size_t mem_size = PoolType::calc_need_size(MAX_NUM);
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    PoolType pool;
+    ASSERT_FALSE(pool.init(raw_mem.get(), mem_size - 1, MAX_NUM));
+    ASSERT_TRUE(pool.init(raw_mem.get(), mem_size, MAX_NUM));
+    EXPECT_EQ(pool.capacity(), MAX_NUM);
+    EXPECT_EQ(pool.node_size(), sizeof(TestNode));
+
+    std::vector<TestNode*> nodes;
+    {
+        PoolType::LocalCache cache(pool);
+        for (size_t i = 0; i < MAX_NUM; ++i)
+        {
+            TestNode* p = cache.alloc();
+            ASSERT_NE(p, nullptr);
+            EXPECT_EQ(p->a, 0u);
+            p->a = static_cast<uint32_t>(i);
+            nodes.push_back(p);
+        }
+        EXPECT_EQ(cache.alloc(), nullptr);
+        std::set<TestNode*> unique_nodes(nodes.begin(), nodes.end());
+        EXPECT_EQ(unique_nodes.size(), MAX_NUM);
+
+        // 回收的时候本地最多留两批，多了的还给中央链表
+        for (TestNode* p : nodes)
+            ASSERT_TRUE(cache.free(p));
+        EXPECT_LE(cache.cached(), PoolType::BATCH_NUM * 2);
+        EXPECT_FALSE(cache.free(nullptr));
+    }
+
+    // 另外一个线程的缓存从中央链表把所有节点都拿回来
+    PoolType attach_pool;
+    ASSERT_TRUE(attach_pool.init(raw_mem.get(), mem_size, MAX_NUM, true));
+    PoolType::LocalCache cache(attach_pool);
+    std::set<TestNode*> unique_nodes;
+    for (size_t i = 0; i < MAX_NUM; ++i)
+    {
+        TestNode* p = cache.alloc(false);
+        ASSERT_NE(p, nullptr);
+        EXPECT_TRUE(unique_nodes.insert(p).second);
+        EXPECT_EQ(attach_pool.int_2_ptr(attach_pool.ptr_2_int(p)), p);
+    }
+    EXPECT_EQ(cache.alloc(), nullptr);
+    for (TestNode* p : unique_nodes)
+        cache.free(p);
+}
+
+TEST(ThreadCachedMemPoolTest, thread_cached_mem_pool_concurrent)
+{
+    static const size_t MAX_NUM = 4096;
+    static const size_t THREAD_NUM = 4;
+    static const size_t LOOP_NUM = 20000;
+    using PoolType = ThreadCachedMemPool<TestNode>;
+
+    size_t mem_size = PoolType::calc_need_size(MAX_NUM);
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    PoolType pool;
+    ASSERT_TRUE(pool.init(raw_mem.get(), mem_size, MAX_NUM));
+
+    // 每个线程申请的节点写上自己的编号，还回去之前检查没有被别人改过，有两个线程拿到同一个节点就会发现
+    std::atomic<size_t> error_num{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREAD_NUM; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            PoolType::LocalCache cache(pool);
+            std::vector<TestNode*> holding;
+            uint32_t seed = static_cast<uint32_t>(t + 1);
+            for (size_t i = 0; i < LOOP_NUM; ++i)
+            {
+                if (holding.empty() || (rand_r(&seed) % 3 != 0 && holding.size() < MAX_NUM / THREAD_NUM))
+                {
+                    TestNode* p = cache.alloc(false);
+                    if (!p)
+                        continue;
+                    p->a = static_cast<uint32_t>(t);
+                    p->b = static_cast<uint32_t>(i);
+                    holding.push_back(p);
+                }
+                else
+                {
+                    size_t pos = rand_r(&seed) % holding.size();
+                    TestNode* p = holding[pos];
+                    if (p->a != t)
+                        ++error_num;
+                    holding[pos] = holding.back();
+                    holding.pop_back();
+                    cache.free(p);
+                }
+            }
+            for (TestNode* p : holding)
+            {
+                if (p->a != t)
+                    ++error_num;
+                cache.free(p);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(error_num.load(), 0u);
+
+    // 所有的缓存都还回去了，一个线程能拿到全部的节点
+    PoolType::LocalCache cache(pool);
+    std::set<TestNode*> unique_nodes;
+    for (size_t i = 0; i < MAX_NUM; ++i)
+    {
+        TestNode* p = cache.alloc(false);
+        ASSERT_NE(p, nullptr);
+        EXPECT_TRUE(unique_nodes.insert(p).second);
+    }
+    EXPECT_EQ(cache.alloc(), nullptr);
+}
+
+#endif
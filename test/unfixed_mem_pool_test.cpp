@@ -0,0 +1,203 @@
+/*
+ * * file name: unfixed_mem_pool_test.cpp
+ * * description: ...
+ * * author: snow
+ * * create time:2026 10 18
+ * */
+
+#ifndef _UNFIXED_MEM_POOL_TEST_H_
+#define _UNFIXED_MEM_POOL_TEST_H_
+
+#include "unfixed_mem_pool.h"
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace pepper;
+
+TEST(UnFixedMemPoolTest, unfixed_mem_pool_size_class)
+{
+    using PoolType = UnFixedMemPool<>;
+    for (size_t i = 0; i < PoolType::CLASS_NUM; ++i)
+    {
+        size_t size = PoolType::class_size(i);
+        EXPECT_EQ(PoolType::class_index(size), i);
+        if (i > 0)
+        {
+            EXPECT_GT(size, PoolType::class_size(i - 1));
+            EXPECT_EQ(PoolType::class_index(PoolType::class_size(i - 1) + 1), i);
+        }
+    }
+    EXPECT_EQ(PoolType::class_index(0), 0u);
+    EXPECT_EQ(PoolType::class_size(PoolType::CLASS_NUM - 1), 16384u);
+    EXPECT_EQ(PoolType::class_index(16385), PoolType::CLASS_NUM);
+    // 64字节以上浪费的不超过节点的20%
+    for (size_t bytes = 65; bytes <= 16384; ++bytes)
+    {
+        size_t size = PoolType::class_size(PoolType::class_index(bytes));
+        EXPECT_LT((size - bytes) * 5, size);
+    }
+}
+
+TEST(UnFixedMemPoolTest, unfixed_mem_pool_normal)
+{
+    static const size_t SLAB_NUM = 256;
+    static const size_t SLAB_SIZE = 16384;
+    using PoolType = UnFixedMemPool<>;
+
+    size_t mem_size = PoolType::calc_need_size(SLAB_NUM, SLAB_SIZE);
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    PoolType pool;
+    ASSERT_FALSE(pool.init(raw_mem.get(), mem_size, SLAB_NUM, SLAB_SIZE - 1));
+    ASSERT_TRUE(pool.init(raw_mem.get(), mem_size, SLAB_NUM, SLAB_SIZE));
+    EXPECT_EQ(pool.free_slab_num(), SLAB_NUM);
+    // 一个slab放不下4个的档位不能用
+    EXPECT_EQ(pool.max_alloc_size(), 3584u);
+
+    // 各种大小混着申请，每块写上自己的偏移
+    std::map<size_t, size_t> blocks;
+    uint32_t seed = 1;
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        size_t bytes = rand_r(&seed) % 1000 + 1;
+        size_t offset = pool.alloc(bytes);
+        ASSERT_NE(offset, 0u);
+        EXPECT_EQ(offset % alignof(size_t), 0u);
+        memset(pool.offset_2_ptr(offset), static_cast<int>(offset & 0xff), bytes);
+        ASSERT_TRUE(blocks.insert(std::make_pair(offset, bytes)).second);
+    }
+    size_t used_num = 0;
+    for (size_t i = 0; i < PoolType::CLASS_NUM; ++i)
+    {
+        used_num += pool.stat(i).used_num;
+        EXPECT_LE(pool.stat(i).used_num, pool.stat(i).slab_num * pool.stat(i).nodes_per_slab);
+    }
+    EXPECT_EQ(used_num, blocks.size());
+    // 块之间不能重叠
+    size_t last_end = 0;
+    for (auto& it : blocks)
+    {
+        EXPECT_GE(it.first, last_end);
+        last_end = it.first + it.second;
+    }
+
+    // 整块内存搬到别的地址，偏移还能用
+    std::unique_ptr<uint8_t[]> moved_mem(new uint8_t[mem_size]);
+    memcpy(moved_mem.get(), raw_mem.get(), mem_size);
+    PoolType moved_pool;
+    ASSERT_TRUE(moved_pool.init(moved_mem.get(), mem_size, SLAB_NUM, SLAB_SIZE, true));
+    for (auto& it : blocks)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(moved_pool.offset_2_ptr(it.first));
+        for (size_t i = 0; i < it.second; ++i)
+            ASSERT_EQ(p[i], it.first & 0xff);
+    }
+
+    // 全部回收，重复回收和乱给的偏移都要失败
+    size_t first_offset = blocks.begin()->first;
+    EXPECT_FALSE(moved_pool.free(first_offset + 1));
+    for (auto& it : blocks)
+        ASSERT_TRUE(moved_pool.free(it.first));
+    EXPECT_FALSE(moved_pool.free(first_offset));
+    EXPECT_FALSE(moved_pool.free(0));
+    EXPECT_EQ(moved_pool.free_slab_num(), SLAB_NUM);
+    for (size_t i = 0; i < PoolType::CLASS_NUM; ++i)
+    {
+        EXPECT_EQ(moved_pool.stat(i).used_num, 0u);
+        EXPECT_EQ(moved_pool.stat(i).slab_num, 0u);
+        EXPECT_EQ(moved_pool.stat(i).alloc_times, moved_pool.stat(i).free_times);
+    }
+}
+
+TEST(UnFixedMemPoolTest, unfixed_mem_pool_slab_reuse)
+{
+    static const size_t SLAB_NUM = 4;
+    static const size_t SLAB_SIZE = 4096;
+    using PoolType = UnFixedMemPool<>;
+
+    size_t mem_size = PoolType::calc_need_size(SLAB_NUM, SLAB_SIZE);
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    PoolType pool;
+    ASSERT_TRUE(pool.init(raw_mem.get(), mem_size, SLAB_NUM, SLAB_SIZE));
+
+    // 小块把所有的slab都占满
+    size_t small_index = PoolType::class_index(32);
+    std::vector<size_t> offsets;
+    for (size_t offset = pool.alloc(32); offset != 0; offset = pool.alloc(32))
+        offsets.push_back(offset);
+    EXPECT_EQ(offsets.size(), pool.stat(small_index).nodes_per_slab * SLAB_NUM);
+    EXPECT_EQ(pool.stat(small_index).fail_times, 1u);
+    EXPECT_EQ(pool.free_slab_num(), 0u);
+    EXPECT_EQ(pool.alloc(500), 0u);
+
+    // 一个slab空了就可以给别的档位用
+    size_t per_slab = pool.stat(small_index).nodes_per_slab;
+    for (size_t i = 0; i < per_slab; ++i)
+        ASSERT_TRUE(pool.free(offsets[i]));
+    EXPECT_EQ(pool.free_slab_num(), 1u);
+    size_t big = pool.alloc(500);
+    ASSERT_NE(big, 0u);
+    EXPECT_EQ(pool.stat(PoolType::class_index(500)).slab_num, 1u);
+
+    // 满的slab回收一个之后又能申请
+    ASSERT_TRUE(pool.free(offsets.back()));
+    EXPECT_EQ(pool.alloc(32), offsets.back());
+
+    pool.clear();
+    EXPECT_EQ(pool.free_slab_num(), SLAB_NUM);
+    EXPECT_FALSE(pool.free(big));
+}
+
+TEST(UnFixedMemPoolTest, unfixed_mem_pool_large)
+{
+    static const size_t SLAB_NUM = 8;
+    static const size_t SLAB_SIZE = 4096;
+    using PoolType = UnFixedMemPool<>;
+
+    size_t mem_size = PoolType::calc_need_size(SLAB_NUM, SLAB_SIZE);
+    std::unique_ptr<uint8_t[]> raw_mem(new uint8_t[mem_size]);
+    PoolType pool;
+    ASSERT_TRUE(pool.init(raw_mem.get(), mem_size, SLAB_NUM, SLAB_SIZE));
+    EXPECT_EQ(pool.alloc(SLAB_SIZE * (SLAB_NUM + 1)), 0u);
+    EXPECT_EQ(pool.alloc(~size_t(0)), 0u);
+    EXPECT_EQ(pool.large_stat().fail_times, 2u);
+
+    // 大块按整slab向上取整，占连续的slab
+    size_t first = pool.alloc(SLAB_SIZE + 1);
+    ASSERT_NE(first, 0u);
+    EXPECT_EQ(pool.free_slab_num(), SLAB_NUM - 2);
+    size_t small = pool.alloc(32);
+    ASSERT_NE(small, 0u);
+    size_t second = pool.alloc(SLAB_SIZE * 3);
+    ASSERT_NE(second, 0u);
+    EXPECT_GE(second, first + SLAB_SIZE * 2);
+    memset(pool.offset_2_ptr(second), 0xab, SLAB_SIZE * 3);
+    EXPECT_EQ(pool.large_stat().used_num, 2u);
+    EXPECT_EQ(pool.large_stat().slab_num, 5u);
+    EXPECT_EQ(pool.free_slab_num(), SLAB_NUM - 6);
+
+    // 大块只能从开头回收
+    EXPECT_FALSE(pool.free(first + 8));
+    EXPECT_FALSE(pool.free(first + SLAB_SIZE));
+    ASSERT_TRUE(pool.free(first));
+    EXPECT_FALSE(pool.free(first));
+    EXPECT_EQ(pool.free_slab_num(), SLAB_NUM - 4);
+
+    // 空闲的slab够数但是不连续，申请不到，小块还回去之后就连起来了
+    EXPECT_EQ(pool.alloc(SLAB_SIZE * 3), 0u);
+    EXPECT_EQ(pool.large_stat().fail_times, 3u);
+    ASSERT_TRUE(pool.free(small));
+    size_t third = pool.alloc(SLAB_SIZE * 3);
+    EXPECT_EQ(third, first);
+
+    ASSERT_TRUE(pool.free(second));
+    ASSERT_TRUE(pool.free(third));
+    EXPECT_EQ(pool.free_slab_num(), SLAB_NUM);
+    EXPECT_EQ(pool.large_stat().used_num, 0u);
+    EXPECT_EQ(pool.large_stat().slab_num, 0u);
+    EXPECT_EQ(pool.large_stat().alloc_times, pool.large_stat().free_times);
+}
+
+#endif